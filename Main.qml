@@ -5,6 +5,7 @@ import QtQuick.Controls 2.15
 import QtQuick.Layouts
 import QtQuick.Controls.Fusion
 import QtQuick.Dialogs
+import MJComCore 1.0
 
 ApplicationWindow {
     id: root
@@ -14,15 +15,16 @@ ApplicationWindow {
     title: qsTr("通信助手")
 
     property int maxLines: 100 // 接收区最大行数
-    property int scriptcurrentLines: 0
-    property string bufferText: ""
     property bool autoScroll: true
-    property real lastScrollPosition: 0
-    property bool displayHex: true  // 显示模式：true为HEX，false为ASCII
     property bool sendHex: true     // 发送模式：true为HEX，false为ASCII
     property int connectionMode: 0   // 连接模式：0=串口,1=TCP客户端,2=TCP服务器,3=UDP
     property bool isConnected: false // 连接状态
     property string statusMessage: "未连接" // 状态消息
+    property int periodicFrameId: -1 // 定时发送帧ID
+    property bool fileTransferActive: false // 是否正在发送文件
+    property var chartColors: ["#1a5fb4", "#c01c28", "#26a269", "#e66100", "#613583", "#865e3c"] // 曲线颜色
+    property var pollValues: ({})    // 轮询标签的最新值，只在变化时更新
+    property int pollValueRevision: 0
 
     // 文件选择框
     FileDialog {
@@ -61,39 +63,80 @@ ApplicationWindow {
         }
     }
 
-    function getCurrentDateTime() {
-        var now = new Date();
-        return now.toLocaleString(Qt.locale(), "yyyy-MM-dd hh:mm:ss");
+    FileDialog {
+        id: spillFileDialog
+        title: "脚本输出写入文件"
+        fileMode: FileDialog.SaveFile
+        nameFilters: ["日志 (*.log *.txt)", "所有文件 (*)"]
+
+        onAccepted: {
+            var rawPath = selectedFile.toString();
+            var localPath = rawPath.replace(/^(file:\/{3})|(qrc:\/{3})/, ""); // 移除 URL 前缀
+            localPath = decodeURIComponent(localPath); // 处理特殊字符
+            scriptOutput.spillFile = localPath;
+        }
+        onRejected: spillCheckBox.checked = false
     }
 
-    Timer {
-        id: updateTimer
-        interval: 100 // 100ms更新
-        repeat: true
-        running: true
-        onTriggered: {
-            if (bufferText !== "") {
-                var scrollAtBottom = isScrollAtBottom()
-                var currentPosition = scrollView.ScrollBar.vertical.position
-
-                receiveArea.append(bufferText)
-                trimOldData()
-
-                if (autoScroll || scrollAtBottom) {
-                    forceRefresh()
-                } else {
-                    // 保持滚动位置
-                    scrollView.ScrollBar.vertical.position = currentPosition
-                }
+    FileDialog {
+        id: captureFileDialog
+        title: "录制收发数据"
+        fileMode: FileDialog.SaveFile
+        nameFilters: ["CSV (*.csv)", "列式文件 (*.mjcol)"]
+
+        onAccepted: {
+            var localPath = exportPath(selectedFile);
+            if (serial.startCapture(localPath, exportFormat(localPath))) {
+                captureCheckBox.captureFile = localPath;
+            } else {
+                captureCheckBox.checked = false;
+                appendScriptOutput("录制失败：" + localPath);
+            }
+        }
+        onRejected: captureCheckBox.checked = false
+    }
+
+    FileDialog {
+        id: exportTagsDialog
+        title: "导出标签历史"
+        fileMode: FileDialog.SaveFile
+        nameFilters: ["CSV (*.csv)", "列式文件 (*.mjcol)"]
+
+        onAccepted: {
+            var localPath = exportPath(selectedFile);
+            if (!serial.exportTags(localPath, exportFormat(localPath), chartModel.tags)) {
+                appendScriptOutput("导出失败：" + localPath);
+            }
+        }
+    }
+
+    FileDialog {
+        id: sendFileDialog
+        title: "选择要发送的文件"
+        nameFilters: ["所有文件 (*)", "固件 (*.bin *.hex)"]
+        onAccepted: {
+            var filePath = sendFileDialog.selectedFile.toString();
+
+            if (Qt.platform.os === "windows") {
+                filePath = filePath.replace("file:///", "");
+            } else {
+                filePath = filePath.replace("file://", "");
+            }
+            filePath = decodeURIComponent(filePath);
 
-                bufferText = ""
+            var protocols = ["raw", "xmodem", "ymodem"];
+            if (serial.startFileTransfer(filePath, protocols[fileProtocolSelector.currentIndex])) {
+                fileTransferBar.value = 0;
+                fileTransferActive = true;
             }
         }
     }
 
-    function isScrollAtBottom() {
-        var scrollBar = scrollView.ScrollBar.vertical
-        return (scrollBar.position + scrollBar.size >= 0.99)
+    // 接收区最大行数同步到收发记录模型
+    Binding {
+        target: trafficModel
+        property: "maxRows"
+        value: maxLines
     }
 
     // 主布局：左侧配置区域，右侧分为数据收发区域和脚本区域
@@ -300,6 +343,51 @@ ApplicationWindow {
                                 font.pixelSize: 12
                             }
                         }
+
+                        // RTU 分帧和低延迟
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 0
+
+                            CheckBox {
+                                text: "RTU分帧"
+                                font.pixelSize: 12
+                                onCheckedChanged: serial.setRtuFraming(checked)
+                            }
+
+                            CheckBox {
+                                text: "低延迟"
+                                font.pixelSize: 12
+                                onCheckedChanged: serial.setSerialLowLatency(checked)
+                            }
+                        }
+
+                        // 虚拟串口(伪终端)：回环、Modbus从站或脚本设备
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 4
+
+                            CheckBox {
+                                text: "虚拟串口"
+                                font.pixelSize: 12
+                                onCheckedChanged: {
+                                    if (checked) {
+                                        checked = serial.createVirtualSerial(virtualModeSelector.currentText) !== "";
+                                    } else {
+                                        serial.closeVirtualSerial();
+                                    }
+                                    portSelector.model = serial.scanPorts();
+                                }
+                            }
+
+                            ComboBox {
+                                id: virtualModeSelector
+                                Layout.fillWidth: true
+                                implicitHeight: 24
+                                model: ["echo", "modbus", "script"]
+                                font.pixelSize: 12
+                            }
+                        }
                     }
                 }
 
@@ -470,14 +558,15 @@ ApplicationWindow {
                                 font.pixelSize: 12
                             }
 
+                            // 只改变模型的显示模式，接收区只重新格式化可见行
                             RadioButton {
                                 id: displayHexRadio
                                 text: "HEX"
-                                checked: displayHex
+                                checked: trafficModel.displayMode === TrafficModel.Hex
                                 font.pixelSize: 12
                                 onCheckedChanged: {
                                     if (checked) {
-                                        displayHex = true
+                                        trafficModel.displayMode = TrafficModel.Hex
                                     }
                                 }
                             }
@@ -485,11 +574,49 @@ ApplicationWindow {
                             RadioButton {
                                 id: displayAsciiRadio
                                 text: "ASCII"
-                                checked: !displayHex
+                                checked: trafficModel.displayMode === TrafficModel.Ascii
+                                font.pixelSize: 12
+                                onCheckedChanged: {
+                                    if (checked) {
+                                        trafficModel.displayMode = TrafficModel.Ascii
+                                    }
+                                }
+                            }
+
+                            RadioButton {
+                                id: displayMixedRadio
+                                text: "混合"
+                                checked: trafficModel.displayMode === TrafficModel.Mixed
                                 font.pixelSize: 12
                                 onCheckedChanged: {
                                     if (checked) {
-                                        displayHex = false
+                                        trafficModel.displayMode = TrafficModel.Mixed
+                                    }
+                                }
+                            }
+                        }
+
+                        // 协议解析：解析出的帧以摘要行插入接收区
+                        RowLayout {
+                            Layout.fillWidth: true
+
+                            Label {
+                                text: "解析:"
+                                font.pixelSize: 12
+                            }
+
+                            ComboBox {
+                                id: dissectorSelector
+                                Layout.fillWidth: true
+                                implicitHeight: 24
+                                font.pixelSize: 12
+                                model: ["none"].concat(serial.getDissectorNames())
+                                onActivated: serial.setDissector(currentText === "none" ? "" : currentText)
+                                // 脚本注册的解析器在下拉时刷新
+                                onPressedChanged: {
+                                    if (pressed) {
+                                        model = ["none"].concat(serial.getDissectorNames())
+                                        currentIndex = Math.max(0, model.indexOf(serial.getDissector()))
                                     }
                                 }
                             }
@@ -669,8 +796,6 @@ ApplicationWindow {
                                     autoScroll = checked
                                     if (autoScroll) {
                                         forceRefresh()
-                                    } else {
-                                        lastScrollPosition = scrollView.ScrollBar.vertical.position
                                     }
                                 }
                             }
@@ -713,18 +838,71 @@ ApplicationWindow {
                                 font.pixelSize: 12
                                 validator: IntValidator {
                                     bottom: 10
-                                    top: 1000
+                                    top: 100000
                                 }
                                 onEditingFinished: {
                                     if (acceptableInput) {
                                         maxLines = parseInt(text)
-                                        trimOldData()
                                     } else {
                                         text = maxLines.toString()
                                     }
                                 }
                             }
                         }
+
+                        // 接收区刷新：每个周期批量插入一次，0 为逐条插入
+                        RowLayout {
+                            Layout.fillWidth: true
+                            Label {
+                                text: "刷新(ms):"
+                                font.pixelSize: 12
+                            }
+                            TextField {
+                                id: updateIntervalField
+                                Layout.preferredWidth: 50
+                                implicitHeight: 24
+                                text: trafficModel.updateInterval.toString()
+                                font.pixelSize: 12
+                                validator: IntValidator {
+                                    bottom: 0
+                                    top: 1000
+                                }
+                                onEditingFinished: {
+                                    if (acceptableInput) {
+                                        trafficModel.updateInterval = parseInt(text)
+                                    } else {
+                                        text = trafficModel.updateInterval.toString()
+                                    }
+                                }
+                            }
+                            CheckBox {
+                                text: "合并"
+                                checked: trafficModel.mergeAdjacent
+                                font.pixelSize: 12
+                                onCheckedChanged: trafficModel.mergeAdjacent = checked
+                            }
+                        }
+
+                        // 录制：收发数据在后台写入 CSV 或 .mjcol 列式文件
+                        RowLayout {
+                            Layout.fillWidth: true
+                            CheckBox {
+                                id: captureCheckBox
+                                text: "录制到文件"
+                                checked: false
+                                font.pixelSize: 12
+                                property string captureFile: ""
+                                ToolTip.visible: hovered && checked
+                                ToolTip.text: captureFile
+                                onClicked: {
+                                    if (checked) {
+                                        captureFileDialog.open()
+                                    } else {
+                                        serial.stopCapture()
+                                    }
+                                }
+                            }
+                        }
                     }
                 }
 
@@ -761,6 +939,14 @@ ApplicationWindow {
                         text: "Lua脚本"
                         font.pixelSize: 13
                     }
+                    TabButton {
+                        text: "曲线"
+                        font.pixelSize: 13
+                    }
+                    TabButton {
+                        text: "历史"
+                        font.pixelSize: 13
+                    }
                 }
 
                 // 视图切换
@@ -780,22 +966,41 @@ ApplicationWindow {
                             title: "接收区"
                             padding: 6
 
-                            ScrollView {
-                                id: scrollView
+                            Rectangle {
                                 anchors.fill: parent
-                                clip: true
-                                ScrollBar.vertical.policy: ScrollBar.AsNeeded
+                                color: "#f8f9fa"
 
-                                TextArea {
-                                    id: receiveArea
-                                    width: scrollView.width
-                                    readOnly: true
-                                    wrapMode: TextArea.Wrap
-                                    textFormat: TextEdit.PlainText
-                                    font.family: "Courier New"
-                                    font.pixelSize: 12
-                                    background: Rectangle {
-                                        color: "#f8f9fa"
+                                // 只为可见行创建委托，行文本由模型按需格式化
+                                ListView {
+                                    id: receiveList
+                                    anchors.fill: parent
+                                    anchors.margins: 4
+                                    clip: true
+                                    model: trafficModel
+                                    boundsBehavior: Flickable.StopAtBounds
+                                    ScrollBar.vertical: ScrollBar {
+                                        policy: ScrollBar.AsNeeded
+                                    }
+
+                                    property bool followTail: true // 停在底部时跟随新数据
+
+                                    delegate: Text {
+                                        width: receiveList.width - 12
+                                        text: (model.direction === TrafficModel.Received ? "[接收] "
+                                               : model.direction === TrafficModel.Sent ? "[发送] " : "[解析] ")
+                                              + model.time + " " + model.text
+                                        color: model.direction === TrafficModel.Decoded ? "#1a5fb4" : "black"
+                                        wrapMode: Text.WrapAnywhere
+                                        textFormat: Text.PlainText
+                                        font.family: "Courier New"
+                                        font.pixelSize: 12
+                                    }
+
+                                    onMovementEnded: followTail = atYEnd
+                                    onCountChanged: {
+                                        if (autoScroll || followTail) {
+                                            Qt.callLater(forceRefresh)
+                                        }
                                     }
                                 }
                             }
@@ -804,7 +1009,7 @@ ApplicationWindow {
                         // 发送数据区域
                         GroupBox {
                             Layout.fillWidth: true
-                            Layout.preferredHeight: 150
+                            Layout.preferredHeight: 210
                             title: "发送区"
                             padding: 6
 
@@ -827,6 +1032,132 @@ ApplicationWindow {
                                     }
                                 }
 
+                                // 定时发送
+                                RowLayout {
+                                    Layout.fillWidth: true
+                                    spacing: 6
+
+                                    CheckBox {
+                                        id: periodicCheckBox
+                                        text: "定时发送"
+                                        font.pixelSize: 12
+                                        enabled: isConnected
+                                        onCheckedChanged: {
+                                            if (checked) {
+                                                let data = sendArea.text.trim();
+                                                if (data === "" || !periodField.acceptableInput) {
+                                                    checked = false;
+                                                    return;
+                                                }
+                                                serial.clearPeriodicFrames();
+                                                periodicFrameId = serial.addPeriodicFrame(data, sendHex, parseFloat(periodField.text), 0);
+                                                serial.startPeriodicSend();
+                                            } else {
+                                                serial.stopPeriodicSend();
+                                                serial.clearPeriodicFrames();
+                                                periodicFrameId = -1;
+                                            }
+                                        }
+                                    }
+
+                                    TextField {
+                                        id: periodField
+                                        implicitHeight: 24
+                                        implicitWidth: 70
+                                        text: "1000"
+                                        font.pixelSize: 12
+                                        enabled: !periodicCheckBox.checked
+                                        validator: DoubleValidator {
+                                            bottom: 0.1
+                                            top: 3600000
+                                        }
+                                    }
+
+                                    Label {
+                                        text: "ms"
+                                        font.pixelSize: 12
+                                    }
+
+                                    Label {
+                                        id: periodicStatsLabel
+                                        Layout.fillWidth: true
+                                        font.pixelSize: 11
+                                        color: "#6c757d"
+                                        elide: Text.ElideRight
+                                    }
+
+                                    Timer {
+                                        interval: 500
+                                        repeat: true
+                                        running: periodicCheckBox.checked
+                                        onTriggered: {
+                                            let stats = serial.getPeriodicStats();
+                                            if (stats.length > 0) {
+                                                let s = stats[0];
+                                                periodicStatsLabel.text = "次数:" + s.samples
+                                                        + " 抖动(us) 均值:" + s.meanUs.toFixed(1)
+                                                        + " 最大:" + s.maxUs.toFixed(1)
+                                                        + " 标准差:" + s.stddevUs.toFixed(1)
+                                                        + " 丢周期:" + s.overruns;
+                                            }
+                                        }
+                                    }
+                                }
+
+                                // 文件发送
+                                RowLayout {
+                                    Layout.fillWidth: true
+                                    spacing: 6
+
+                                    Button {
+                                        text: fileTransferActive ? "取消" : "发送文件"
+                                        implicitHeight: 24
+                                        implicitWidth: 70
+                                        enabled: isConnected
+                                        background: Rectangle {
+                                            color: parent.enabled ? (parent.pressed ? "#138496" : "#17a2b8") : "#6c757d"
+                                            radius: 3
+                                        }
+                                        contentItem: Text {
+                                            text: parent.text
+                                            color: "white"
+                                            horizontalAlignment: Text.AlignHCenter
+                                            verticalAlignment: Text.AlignVCenter
+                                            font.pixelSize: 12
+                                        }
+                                        onClicked: {
+                                            if (fileTransferActive) {
+                                                serial.cancelFileTransfer();
+                                            } else {
+                                                sendFileDialog.open();
+                                            }
+                                        }
+                                    }
+
+                                    ComboBox {
+                                        id: fileProtocolSelector
+                                        implicitHeight: 24
+                                        implicitWidth: 110
+                                        font.pixelSize: 12
+                                        model: ["RAW", "XMODEM-1K", "YMODEM"]
+                                        enabled: !fileTransferActive
+                                    }
+
+                                    ProgressBar {
+                                        id: fileTransferBar
+                                        Layout.fillWidth: true
+                                        from: 0
+                                        to: 1
+                                        value: 0
+                                    }
+
+                                    Label {
+                                        id: fileTransferLabel
+                                        font.pixelSize: 11
+                                        color: "#6c757d"
+                                    }
+                                }
+
                                 Button {
                                     Layout.fillWidth: true
                                     text: "发送数据"
@@ -1009,11 +1340,51 @@ ApplicationWindow {
                                     }
                                     TextField {
                                         id: maxLinesTextField
-                                        text: "30"
+                                        text: scriptOutput.capacity.toString()
                                         implicitHeight: 28
                                         implicitWidth: 80
                                         font.pixelSize: 12
                                         inputMethodHints: Qt.ImhDigitsOnly
+                                        validator: IntValidator {
+                                            bottom: 10
+                                            top: 100000
+                                        }
+                                        onEditingFinished: {
+                                            if (acceptableInput) {
+                                                scriptOutput.capacity = parseInt(text)
+                                            } else {
+                                                text = scriptOutput.capacity.toString()
+                                            }
+                                        }
+                                    }
+                                    CheckBox {
+                                        id: spillCheckBox
+                                        text: "写入文件"
+                                        checked: scriptOutput.spillFile !== ""
+                                        font.pixelSize: 12
+                                        ToolTip.visible: hovered && scriptOutput.spillFile !== ""
+                                        ToolTip.text: scriptOutput.spillFile
+                                        onClicked: {
+                                            if (checked) {
+                                                spillFileDialog.open()
+                                            } else {
+                                                scriptOutput.spillFile = ""
+                                            }
+                                        }
+                                    }
+                                    Label {
+                                        text: "日志:"
+                                        font.pixelSize: 12
+                                    }
+                                    ComboBox {
+                                        id: logLevelSelector
+                                        implicitHeight: 28
+                                        implicitWidth: 80
+                                        font.pixelSize: 12
+                                        model: ["debug", "info", "warn", "error", "off"]
+                                        currentIndex: 1
+                                        // 脚本中的 log.* 低于该级别时直接返回
+                                        onActivated: serial.setScriptLogLevel(currentText)
                                     }
                                     Item {
                                         Layout.fillWidth: true
@@ -1034,156 +1405,468 @@ ApplicationWindow {
                                             verticalAlignment: Text.AlignVCenter
                                             font.pixelSize: 12
                                         }
-                                        onClicked: scriptOutputArea.clear()
+                                        onClicked: scriptOutput.clear()
                                     }
                                 }
-                                ScrollView {
-                                    id: outputScrollView
+                                Rectangle {
                                     Layout.fillWidth: true
                                     Layout.fillHeight: true
-                                    clip: true
-                                    TextArea {
-                                        id: scriptOutputArea
-                                        width: outputScrollView.width
-                                        readOnly: true
-                                        selectByMouse: true
-                                        wrapMode: TextArea.Wrap
-                                        font.family: "Courier New"
-                                        font.pixelSize: 12
-                                        background: Rectangle {
-                                            color: "#f8f9fa"
+                                    color: "#f8f9fa"
+
+                                    // 输出保存在 C++ 环形缓冲中，只为可见行创建委托
+                                    ListView {
+                                        id: scriptOutputList
+                                        anchors.fill: parent
+                                        anchors.margins: 4
+                                        clip: true
+                                        model: scriptOutput
+                                        boundsBehavior: Flickable.StopAtBounds
+                                        ScrollBar.vertical: ScrollBar {
+                                            policy: ScrollBar.AsNeeded
+                                        }
+
+                                        property bool followTail: true
+
+                                        delegate: TextEdit {
+                                            width: scriptOutputList.width - 12
+                                            text: model.text
+                                            readOnly: true
+                                            selectByMouse: true
+                                            wrapMode: TextEdit.WrapAnywhere
+                                            textFormat: TextEdit.PlainText
+                                            font.family: "Courier New"
+                                            font.pixelSize: 12
+                                        }
+
+                                        onMovementEnded: followTail = atYEnd
+                                        onCountChanged: {
+                                            if (followTail) {
+                                                Qt.callLater(positionViewAtEnd)
+                                            }
                                         }
                                     }
                                 }
                             }
                         }
                     }
-                }
-            }
-        }
-    }
 
-    Connections {
-        target: serial
-        // 接收数据处理
-        function onDataReceived(hexData, asciiData) {
-            var timestamp = getCurrentDateTime();
-            var displayData;
-
-            // 根据当前显示模式选择要显示的数据格式
-            if (displayHex) {
-                displayData = hexData;
-            } else {
-                displayData = asciiData;
-            }
+                    // 曲线选项卡：标签的时间序列由 C++ 按像素列抽稀，Canvas 只画抽稀后的折线
+                    ColumnLayout {
+                        spacing: 8
 
-            // 确保数据不为空
-            if (displayData.trim() !== "") {
-                bufferText += "\n[接收] " + timestamp + " " + displayData;
-            }
-        }
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 8
+                            Label {
+                                text: "时间窗:"
+                                font.pixelSize: 12
+                            }
+                            ComboBox {
+                                id: chartWindowSelector
+                                implicitHeight: 28
+                                implicitWidth: 90
+                                font.pixelSize: 12
+                                textRole: "text"
+                                valueRole: "ms"
+                                model: [
+                                    { text: "10秒", ms: 10000 },
+                                    { text: "1分钟", ms: 60000 },
+                                    { text: "10分钟", ms: 600000 },
+                                    { text: "1小时", ms: 3600000 },
+                                    { text: "1天", ms: 86400000 }
+                                ]
+                                currentIndex: 1
+                                onActivated: chartModel.windowMs = currentValue
+                            }
+                            CheckBox {
+                                text: "暂停"
+                                checked: chartModel.paused
+                                font.pixelSize: 12
+                                onClicked: chartModel.paused = checked
+                            }
+                            Button {
+                                text: "导出"
+                                implicitHeight: 28
+                                font.pixelSize: 12
+                                ToolTip.visible: hovered
+                                ToolTip.text: "导出勾选的标签，未勾选时导出全部"
+                                onClicked: exportTagsDialog.open()
+                            }
+                            Item {
+                                Layout.fillWidth: true
+                            }
+                            Label {
+                                id: chartStatsLabel
+                                font.pixelSize: 12
+                                color: "#6c757d"
+                            }
+                        }
 
-        // 发送数据处理
-        function onDataSent(data, isHex) {
-            var timestamp = getCurrentDateTime();
-            var displayData = data;
-
-            if (displayHex && !isHex) {
-                // ASCII 转 HEX 显示
-                var hexArray = [];
-                for (var i = 0; i < data.length; i++) {
-                    var code = data.charCodeAt(i);
-                    var hex = code.toString(16).toUpperCase();
-                    hex = hex.length < 2 ? '0' + hex : hex;
-                    hexArray.push(hex);
-                }
-                displayData = hexArray.join(' ');
-            } else if (!displayHex && isHex) {
-                // HEX 转 ASCII 显示
-                try {
-                    var chars = [];
-                    var hexValues = data.split(/\s+/).filter(function(h) { return h !== ''; });
-                    for (var j = 0; j < hexValues.length; j++) {
-                        var hexStr = hexValues[j];
-                        if (!/^[0-9A-Fa-f]{1,2}$/.test(hexStr)) {
-                            chars.push("？");
-                            continue;
+                        RowLayout {
+                            Layout.fillWidth: true
+                            Layout.fillHeight: true
+                            spacing: 8
+
+                            // 标签列表，勾选的标签加入曲线
+                            GroupBox {
+                                Layout.preferredWidth: 180
+                                Layout.fillHeight: true
+                                title: "标签"
+                                padding: 6
+
+                                ListView {
+                                    id: chartTagList
+                                    anchors.fill: parent
+                                    clip: true
+                                    model: tagStore.tags()
+                                    ScrollBar.vertical: ScrollBar {
+                                        policy: ScrollBar.AsNeeded
+                                    }
+
+                                    delegate: RowLayout {
+                                        width: chartTagList.width
+                                        spacing: 4
+                                        property int seriesIndex: chartModel.tags.indexOf(modelData)
+
+                                        CheckBox {
+                                            text: modelData
+                                            checked: seriesIndex >= 0
+                                            font.pixelSize: 12
+                                            Layout.fillWidth: true
+                                            onClicked: toggleChartTag(modelData, checked)
+                                        }
+                                        Label {
+                                            text: {
+                                                pollValueRevision
+                                                var value = pollValues[modelData]
+                                                return value === undefined ? "" : Number(value.toFixed(3)).toString()
+                                            }
+                                            font.pixelSize: 12
+                                            color: "#6c757d"
+                                        }
+                                        Rectangle {
+                                            width: 12
+                                            height: 3
+                                            visible: seriesIndex >= 0
+                                            color: chartColors[Math.max(0, seriesIndex) % chartColors.length]
+                                        }
+                                    }
+                                }
+                            }
+
+                            Rectangle {
+                                Layout.fillWidth: true
+                                Layout.fillHeight: true
+                                border.color: "#ced4da"
+                                border.width: 1
+                                color: "#f8f9fa"
+
+                                // 软件光栅绘制，每条曲线最多 4×宽度 个点
+                                Canvas {
+                                    id: chartCanvas
+                                    anchors.fill: parent
+                                    anchors.margins: 1
+                                    renderTarget: Canvas.Image
+
+                                    onWidthChanged: chartModel.columns = Math.max(1, Math.round(width))
+
+                                    onPaint: {
+                                        var ctx = getContext("2d")
+                                        ctx.reset()
+
+                                        ctx.strokeStyle = "#dee2e6"
+                                        ctx.lineWidth = 1
+                                        ctx.beginPath()
+                                        for (var g = 1; g < 4; g++) {
+                                            var gy = Math.round(height * g / 4) + 0.5
+                                            ctx.moveTo(0, gy)
+                                            ctx.lineTo(width, gy)
+                                        }
+                                        ctx.stroke()
+
+                                        for (var s = 0; s < chartModel.tags.length; s++) {
+                                            var p = chartModel.polyline(s)
+                                            if (p.length < 2) {
+                                                continue
+                                            }
+                                            ctx.strokeStyle = chartColors[s % chartColors.length]
+                                            ctx.beginPath()
+                                            ctx.moveTo(p[0] * width, (1 - p[1]) * height)
+                                            for (var i = 2; i < p.length; i += 2) {
+                                                ctx.lineTo(p[i] * width, (1 - p[i + 1]) * height)
+                                            }
+                                            ctx.stroke()
+                                        }
+                                    }
+                                }
+
+                                Label {
+                                    anchors.left: parent.left
+                                    anchors.top: parent.top
+                                    anchors.margins: 4
+                                    text: chartModel.maxValue.toPrecision(6)
+                                    font.pixelSize: 11
+                                    color: "#6c757d"
+                                }
+                                Label {
+                                    anchors.left: parent.left
+                                    anchors.bottom: parent.bottom
+                                    anchors.margins: 4
+                                    text: chartModel.minValue.toPrecision(6)
+                                    font.pixelSize: 11
+                                    color: "#6c757d"
+                                }
+                                Label {
+                                    anchors.right: parent.right
+                                    anchors.bottom: parent.bottom
+                                    anchors.margins: 4
+                                    text: Qt.formatDateTime(new Date(chartModel.endTime), "hh:mm:ss.zzz")
+                                    font.pixelSize: 11
+                                    color: "#6c757d"
+                                }
+                            }
                         }
-                        var val = parseInt(hexStr, 16);
-                        val = val & 0xFF;
-                        chars.push((val >= 32 && val <= 126) ? String.fromCharCode(val) : "？");
                     }
-                    displayData = chars.join("");
-                } catch (e) {
-                    displayData = "[转换错误]";
-                }
-            } else if (isHex) {
-                var cleanHex = data.replace(/\s+/g, '');
-                var formattedHex = [];
-                for (var k = 0; k < cleanHex.length; k += 2) {
-                    if (k + 1 < cleanHex.length) {
-                        formattedHex.push(cleanHex.substr(k, 2));
-                    } else {
-                        formattedHex.push(cleanHex.substr(k, 1));
+
+                    // 历史选项卡：全部收发记录保存在磁盘文件，C++ 按块索引过滤后只返回命中的记录
+                    ColumnLayout {
+                        spacing: 8
+
+                        RowLayout {
+                            Layout.fillWidth: true
+                            spacing: 8
+                            ComboBox {
+                                id: historyDirectionSelector
+                                implicitHeight: 28
+                                implicitWidth: 80
+                                font.pixelSize: 12
+                                textRole: "text"
+                                valueRole: "value"
+                                model: [
+                                    { text: "收发", value: "all" },
+                                    { text: "接收", value: "rx" },
+                                    { text: "发送", value: "tx" }
+                                ]
+                            }
+                            ComboBox {
+                                id: historyTransportSelector
+                                implicitHeight: 28
+                                implicitWidth: 100
+                                font.pixelSize: 12
+                                textRole: "text"
+                                valueRole: "value"
+                                model: [
+                                    { text: "全部连接", value: "all" },
+                                    { text: "串口", value: "serial" },
+                                    { text: "TCP", value: "tcp" },
+                                    { text: "TCP服务器", value: "tcpserver" },
+                                    { text: "UDP", value: "udp" }
+                                ]
+                            }
+                            ComboBox {
+                                id: historyRangeSelector
+                                implicitHeight: 28
+                                implicitWidth: 90
+                                font.pixelSize: 12
+                                textRole: "text"
+                                valueRole: "ms"
+                                model: [
+                                    { text: "全部", ms: 0 },
+                                    { text: "1分钟", ms: 60000 },
+                                    { text: "10分钟", ms: 600000 },
+                                    { text: "1小时", ms: 3600000 },
+                                    { text: "1天", ms: 86400000 }
+                                ]
+                            }
+                            CheckBox {
+                                id: historyHexCheck
+                                text: "HEX"
+                                checked: true
+                                font.pixelSize: 12
+                            }
+                            TextField {
+                                id: historyPatternField
+                                Layout.fillWidth: true
+                                implicitHeight: 28
+                                font.pixelSize: 12
+                                placeholderText: historyHexCheck.checked ? "字节序列，如 01 03 00" : "文本"
+                                onAccepted: searchHistory()
+                            }
+                            Button {
+                                text: "搜索"
+                                implicitHeight: 28
+                                font.pixelSize: 12
+                                onClicked: searchHistory()
+                            }
+                            Button {
+                                text: "清空历史"
+                                implicitHeight: 28
+                                font.pixelSize: 12
+                                onClicked: {
+                                    serial.clearHistory()
+                                    historyList.model = []
+                                    historyStatsLabel.text = ""
+                                }
+                            }
+                        }
+
+                        Label {
+                            id: historyStatsLabel
+                            Layout.fillWidth: true
+                            font.pixelSize: 12
+                            color: "#6c757d"
+                        }
+
+                        Rectangle {
+                            Layout.fillWidth: true
+                            Layout.fillHeight: true
+                            color: "#f8f9fa"
+
+                            ListView {
+                                id: historyList
+                                anchors.fill: parent
+                                anchors.margins: 4
+                                clip: true
+                                model: []
+                                boundsBehavior: Flickable.StopAtBounds
+                                ScrollBar.vertical: ScrollBar {
+                                    policy: ScrollBar.AsNeeded
+                                }
+
+                                delegate: TextEdit {
+                                    width: historyList.width - 12
+                                    text: "#" + modelData.index + " "
+                                          + (modelData.direction === "tx" ? "[发送] " : "[接收] ")
+                                          + Qt.formatDateTime(new Date(modelData.time), "yyyy-MM-dd hh:mm:ss.zzz")
+                                          + " " + modelData.transport + " " + modelData.hex
+                                    color: modelData.direction === "tx" ? "#1a5fb4" : "black"
+                                    readOnly: true
+                                    selectByMouse: true
+                                    wrapMode: TextEdit.WrapAnywhere
+                                    textFormat: TextEdit.PlainText
+                                    font.family: "Courier New"
+                                    font.pixelSize: 12
+                                }
+                            }
+                        }
                     }
                 }
-                displayData = formattedHex.join(' ');
             }
-
-            // 更新显示缓冲区
-            bufferText += "\n[发送] " + timestamp + " " + displayData;
         }
+    }
 
+    Connections {
+        target: serial
         function onConnectionStatusChanged(connected, message) {
             isConnected = connected;
             statusMessage = message;
+            if (!connected) {
+                periodicCheckBox.checked = false;
+            }
+        }
+
+        function onFileTransferProgress(sent, total) {
+            fileTransferBar.value = total > 0 ? sent / total : 1;
+            fileTransferLabel.text = Math.round(sent / 1024) + "/" + Math.round(total / 1024) + " KB";
         }
 
-        function onLuaOutput(output) {
-            appendScriptOutput("[输出] " + output);
+        function onFileTransferFinished(success, message) {
+            fileTransferActive = false;
+            fileTransferLabel.text = message;
         }
 
         function onCurrentScriptChanged() {
             scriptArea.text = serial.currentScript;
         }
+
+        function onExportFinished(success, message) {
+            appendScriptOutput(message);
+        }
+
+        // 轮询只上报变化的值，静态数据不触发界面刷新
+        function onPollValuesChanged(id, changes, timestamp) {
+            for (var i = 0; i < changes.length; i++) {
+                pollValues[changes[i].tag] = changes[i].value;
+            }
+            pollValueRevision++;
+        }
     }
 
-    function appendScriptOutput(text) {
-        if (!scriptOutputArea.text) {
-            scriptOutputArea.text = text;
-            scriptcurrentLines = text.split('\n').length;
-        } else {
-            let lines = scriptOutputArea.text.split('\n');
-            lines.push(text);
-            let maxLines = parseInt(maxLinesTextField.text) || 100;
-            if (lines.length > maxLines) {
-                lines = lines.slice(lines.length - maxLines);
+    Connections {
+        target: tagStore
+        function onTagsChanged() {
+            chartTagList.model = tagStore.tags()
+        }
+    }
+
+    Connections {
+        target: chartModel
+        function onChanged() {
+            chartCanvas.requestPaint()
+            var stats = chartModel.getStats()
+            chartStatsLabel.text = stats.sourcePoints + " 点 → " + stats.outputPoints + " 点, " + stats.rebuildMs.toFixed(1) + " ms"
+        }
+    }
+
+    function toggleChartTag(tag, checked) {
+        var tags = []
+        for (var i = 0; i < chartModel.tags.length; i++) {
+            if (chartModel.tags[i] !== tag) {
+                tags.push(chartModel.tags[i])
             }
-            scriptOutputArea.text = lines.join('\n');
-            scriptcurrentLines = lines.length;
         }
-        scriptOutputArea.cursorPosition = scriptOutputArea.text.length;
+        if (checked) {
+            tags.push(tag)
+        }
+        chartModel.tags = tags
     }
 
-    function trimOldData() {
-        var lines = receiveArea.text.split('\n')
-        if (lines.length > maxLines) {
-            lines = lines.slice(-maxLines)
-            receiveArea.text = lines.join('\n')
-            if (autoScroll) {
-                forceRefresh()
+    // 按界面条件检索会话历史，最多显示最新的 1000 条
+    function searchHistory() {
+        var filter = {
+            direction: historyDirectionSelector.currentValue,
+            transport: historyTransportSelector.currentValue,
+            limit: 1000
+        }
+        if (historyRangeSelector.currentValue > 0) {
+            filter.from = Date.now() - historyRangeSelector.currentValue
+        }
+        if (historyPatternField.text.length > 0) {
+            if (historyHexCheck.checked) {
+                filter.hex = historyPatternField.text
+            } else {
+                filter.text = historyPatternField.text
             }
         }
+        var hits = serial.searchHistory(filter)
+        historyList.model = hits
+        var stats = serial.getHistoryStats()
+        historyStatsLabel.text = hits.length + " 条命中 / " + stats.frames + " 条记录, 扫描 "
+                + stats.lastScannedBlocks + "/" + stats.blocks + " 块, " + stats.lastSearchMs.toFixed(1) + " ms"
+    }
+
+    // 文件对话框的 URL 转为本地路径
+    function exportPath(url) {
+        var localPath = url.toString().replace(/^(file:\/{3})|(qrc:\/{3})/, "");
+        return decodeURIComponent(localPath);
+    }
+
+    // .mjcol 后缀为列式文件，其余为 CSV
+    function exportFormat(path) {
+        return path.toLowerCase().endsWith(".mjcol") ? "columnar" : "csv";
+    }
+
+    function appendScriptOutput(text) {
+        scriptOutput.append(text);
     }
 
     function forceRefresh() {
-        receiveArea.cursorPosition = receiveArea.length
-        scrollView.ScrollBar.vertical.position = 1.0 - scrollView.ScrollBar.vertical.size
+        receiveList.positionViewAtEnd()
+        receiveList.followTail = true
     }
 
     function clearReceiveArea() {
-        receiveArea.clear()
-        bufferText = ""
+        trafficModel.clear()
         forceRefresh()
     }
 }
@@ -6,8 +6,23 @@
 -- sendHex(text) - 发送16进制数据
 -- sleep(ms) - 等待毫秒
 -- print(text) - 输出到控制台
+-- log.debug/info/warn/error(fmt, ...) - 分级日志，按 string.format 格式化；log.setLevel("warn") 后低级别调用不做格式化
 -- getLastData() - 获取最后接收的数据，返回二进制数据
 -- setResponseTimeout(ms) - 设置响应超时时间
+-- setRtuFraming(enable) - 按 t3.5 帧间隔分帧，getLastData() 返回完整帧；帧内间隔超过 t1.5 的帧计入 getRtuTiming().gapFrames
+-- setRtuStrictGap(enable) - 丢弃上述帧(需开启串口低延迟模式：界面"低延迟"或 --low-latency)
+-- createVirtualSerial("modbus") - 创建内置Modbus从站的虚拟串口(vpty0)，无硬件时可用它测试本脚本
+-- getLuaMemoryStats() - Lua内存统计(bytes/gcMode/mainStackTop/coroutines)，长时间轮询可配合 collectgarbage("generational")
+-- waitFor(pattern[, ms]) - 挂起等待匹配 "01 03 ?? 0?" 的数据('?' 为半字节通配)，返回 true, 字节；超时返回 false
+-- addTrigger(pattern, fn(id, bytes)[, once]) / addRegexTrigger(regex, fn[, once]) - 接收流触发器，所有模式一次扫描匹配
+-- recordTag(tag, value[, ms]) / getTag(tag) / queryTag(tag, from, to[, bucketMs]) - 标签时间序列，本脚本按 "从站/功能码/地址" 记录轮询值
+-- startCapture(path[, "csv"|"columnar"]) / stopCapture() / exportTags(path[, format[, tags[, from, to]]]) - 录制收发数据、导出标签历史
+-- addPoll{unit=, func=, addr=, count=, period=, priority=, format=, deadband=} / startPolling{timeout=} / getPollStats() - 原生轮询调度
+-- onPollChange(fn(id, changes)) - 轮询值变化回调，changes = {{tag=, addr=, value=, previous=}}，只包含变化的值(模拟量按 deadband)
+-- modbusWrite{unit=, addr=, value= 或 values={...}, coil=, priority=} / getWriteStats() - 写入(05/06/0F/10)，相邻的写合并为一帧，与轮询按优先级交替
+-- getPollUnits() - 从站健康状态，连续失败的从站断开(open)，只定期探测，恢复应答后重新轮询
+-- searchHistory{hex="01 03", direction="rx", from=ms, limit=100} / getHistoryStats() - 检索全部收发历史(磁盘文件 + 块索引)
+-- setDissector("modbus-rtu") / onFrame(fn(frame)) - 协议解析，frame.fields 为解析出的字段(unit/function/registers...)；registerDissector(name, fn(bytes)) 注册脚本解析器
 
 -- 数据格式类型定义
 local DATA_FORMATS = {
@@ -28,15 +43,20 @@ local DATA_FORMATS = {
 local settings = {
     pollInterval = 100,     -- 轮询间隔(毫秒)
     responseTimeout = 100,  -- 响应超时时间(毫秒)
-    decimalPlaces = 2       -- 浮点数小数位数
+    decimalPlaces = 2,      -- 浮点数小数位数
+    nativePolling = true,   -- 使用原生轮询调度(按组的 period/priority)，false 时使用下面的脚本轮询循环
+    statsInterval = 5000,   -- 原生轮询时输出统计的间隔(毫秒)
+    printChangesOnly = true, -- 只输出有变化的值，静态数据不刷屏
+    readWrite = true        -- 原生轮询时寄存器写搭载在同站 0x03 轮询上用 0x17 发送(从站不支持时自动分开)
 }
 
 -- 参数设置，每组可独立配置从站ID、功能码、地址和个数和数据格式
+-- 原生轮询时 period 为该组周期(毫秒，默认 pollInterval)，priority 越大越优先，deadband 为模拟量的上报死区
 local poll_config = {
-    {unit_id = 1, func_code = 0x01, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.UINT16},
-    {unit_id = 1, func_code = 0x02, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.UINT16},    
-    {unit_id = 1, func_code = 0x03, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.UINT16},
-    {unit_id = 1, func_code = 0x04, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.FLOAT_ABCD}
+    {unit_id = 1, func_code = 0x01, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.UINT16, period = 500},
+    {unit_id = 1, func_code = 0x02, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.UINT16, period = 500},    
+    {unit_id = 1, func_code = 0x03, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.UINT16, period = 100, priority = 1},
+    {unit_id = 1, func_code = 0x04, start_addr = 0x0000, quantity = 20, format = DATA_FORMATS.FLOAT_ABCD, period = 1000, deadband = 0.01}
 }
 
 -- 获取功能码对应的名称
@@ -45,7 +65,12 @@ function get_func_name(func_code)
         [0x01] = "线圈状态",
         [0x02] = "离散输入",
         [0x03] = "保持寄存器",
-        [0x04] = "输入寄存器"
+        [0x04] = "输入寄存器",
+        [0x05] = "写单个线圈",
+        [0x06] = "写单个寄存器",
+        [0x0F] = "写多个线圈",
+        [0x10] = "写多个寄存器",
+        [0x17] = "读写多个寄存器"
     }
     return names[func_code] or "未知功能码"
 end
@@ -173,18 +198,40 @@ function parse_long(bytes, format)
     return value
 end
 
+-- 记录到标签存储，stride 为每个值占用的地址数
+function record_values(unit_id, func_code, start_addr, values, stride)
+    for i, v in ipairs(values) do
+        local number = tonumber(v)
+        if number then
+            recordTag(string.format("%d/%d/%d", unit_id, func_code, start_addr + (i - 1) * stride), number)
+        end
+    end
+end
+
+-- 上次输出的内容，按 功能码/地址 区分
+local last_output = {}
+
+function print_values(func_code, start_addr, output)
+    local key = func_code .. "/" .. start_addr
+    if settings.printChangesOnly and last_output[key] == output then
+        return
+    end
+    last_output[key] = output
+    print(output)
+end
+
 function parse_response(response, func_code, start_addr, format, quantity)
     local func_name = get_func_name(func_code)
     
     if not response or response == "" then
-        print(func_name .. " 起始地址:0x" .. string.format("%04X", start_addr) .. " 无响应数据")
+        log.warn("%s 起始地址:0x%04X 无响应数据", func_name, start_addr)
         return
     end
     
     local bytes = string_to_bytes(response)
     
     if #bytes < 3 then
-        print(func_name .. " 起始地址:0x" .. string.format("%04X", start_addr) .. " 响应数据过短")
+        log.warn("%s 起始地址:0x%04X 响应数据过短", func_name, start_addr)
         return
     end
     
@@ -194,12 +241,12 @@ function parse_response(response, func_code, start_addr, format, quantity)
     if resp_func_code ~= func_code then
         if resp_func_code == (func_code + 0x80) then
             if #bytes >= 3 then
-                print(func_name .. " 起始地址:0x" .. string.format("%04X", start_addr) .. " 异常:0x" .. string.format("%02X", bytes[3]))
+                log.warn("%s 起始地址:0x%04X 异常:0x%02X", func_name, start_addr, bytes[3])
             else
-                print(func_name .. " 起始地址:0x" .. string.format("%04X", start_addr) .. " 异常响应")
+                log.warn("%s 起始地址:0x%04X 异常响应", func_name, start_addr)
             end
         else
-            print(func_name .. " 起始地址:0x" .. string.format("%04X", start_addr) .. " 功能码不匹配")
+            log.warn("%s 起始地址:0x%04X 功能码不匹配", func_name, start_addr)
         end
         return
     end
@@ -207,7 +254,7 @@ function parse_response(response, func_code, start_addr, format, quantity)
     local byte_count = bytes[3]
     
     if #bytes < 3 + byte_count then
-        print(func_name .. " 起始地址:0x" .. string.format("%04X", start_addr) .. " 数据长度不匹配")
+        log.warn("%s 起始地址:0x%04X 数据长度不匹配", func_name, start_addr)
         return
     end
     
@@ -228,8 +275,9 @@ function parse_response(response, func_code, start_addr, format, quantity)
             end
         end
         
+        record_values(unit_id, func_code, start_addr, states, 1)
         output = output .. " 值:" .. table.concat(states, ",")
-        print(output)
+        print_values(func_code, start_addr, output)
         
     elseif func_code == 0x03 or func_code == 0x04 then
         local values = {}
@@ -290,8 +338,10 @@ function parse_response(response, func_code, start_addr, format, quantity)
             end
         end
         
+        local stride = (format:find("FLOAT_") == 1 or format:find("LONG_") == 1) and 2 or 1
+        record_values(unit_id, func_code, start_addr, values, stride)
         output = output .. " " .. format_desc .. " 值:" .. table.concat(values, ",")
-        print(output)
+        print_values(func_code, start_addr, output)
     end
 end
 
@@ -303,6 +353,10 @@ function init()
     print("浮点数小数位数: " .. settings.decimalPlaces)
     
     setResponseTimeout(settings.responseTimeout)
+    setRtuFraming(true)
+
+    local timing = getRtuTiming()
+    print(string.format("字符时间: %.1fus, t3.5: %.1fus", timing.charUs, timing.t35Us))
     
     for i, cfg in ipairs(poll_config) do
         print(string.format("轮询配置 #%d: 从站ID=%d, 功能码=0x%02X(%s), 起始地址=0x%04X, 数量=%d, 格式=%s", 
@@ -310,9 +364,58 @@ function init()
     end
 end
 
+-- 原生轮询：各组按自己的周期和优先级在 C++ 中调度，连续失败的从站断开后只定期探测，不拖慢其他组
+-- 读到的值记入标签存储(曲线页查看)，这里只输出变化的值和定时的轮询统计
+function run_native_polling()
+    onPollChange(function(id, changes)
+        for _, c in ipairs(changes) do
+            if c.previous then
+                print(string.format("组%d %s: %g -> %g", id, c.tag, c.previous, c.value))
+            else
+                print(string.format("组%d %s: %g", id, c.tag, c.value))
+            end
+        end
+    end)
+    clearPolls()
+    for i, cfg in ipairs(poll_config) do
+        local id, err = addPoll{
+            unit = cfg.unit_id, func = cfg.func_code, addr = cfg.start_addr, count = cfg.quantity,
+            period = cfg.period or settings.pollInterval, priority = cfg.priority or 0, format = cfg.format,
+            deadband = cfg.deadband or 0
+        }
+        if not id then
+            log.error("轮询配置 #%d 无效: %s", i, err)
+        end
+    end
+    startPolling{protocol = "rtu", timeout = settings.responseTimeout, readWrite = settings.readWrite}
+
+    while true do
+        sleep(settings.statsInterval)
+        for _, s in ipairs(getPollStats()) do
+            print(string.format("组%d 从站%d 0x%02X: 请求%d 应答%d 超时%d 异常%d 错过截止%d 实际周期%.1fms 退避%dms",
+                s.id, s.unit, s.func, s.polls, s.responses, s.timeouts, s.exceptions, s.misses, s.actualPeriodMs, s.backoffMs))
+        end
+        local w = getWriteStats()
+        if w.queued > 0 then
+            print(string.format("写入: 排队%d 合并%d 帧%d(0x17 %d) 成功%d 失败%d 平均%.1fms",
+                w.queued, w.merged, w.frames, w.readWriteFrames, w.ok, w.failed, w.meanLatencyMs))
+        end
+        for _, u in ipairs(getPollUnits()) do
+            if u.state ~= "closed" then
+                print(string.format("从站%d %s: 连续失败%d 超时%d CRC错误%d 断开%d次 探测%d次 %dms后探测",
+                    u.unit, u.state, u.failures, u.timeouts, u.crcErrors, u.trips, u.probes, u.retryMs))
+            end
+        end
+    end
+end
+
 -- 初始化
 init()
 
+if settings.nativePolling then
+    run_native_polling()
+end
+
 while true do
     for _, cfg in ipairs(poll_config) do
         local request = modbus_request(cfg.unit_id, cfg.func_code, cfg.start_addr, cfg.quantity)
@@ -6,8 +6,13 @@
 -- sendHex(text) - 发送16进制数据
 -- sleep(ms) - 等待毫秒
 -- print(text) - 输出到控制台
+-- log.debug/info/warn/error(fmt, ...) - 分级日志，按 string.format 格式化；log.setLevel("warn") 后低级别调用不做格式化
 -- getLastData() - 获取最后接收的数据，返回二进制数据
 -- setResponseTimeout(ms) - 设置响应超时时间
+-- addPoll{unit=, func=, addr=, count=, period=, priority=, format=, deadband=} / startPolling{protocol="tcp"} / getPollStats() - 原生轮询调度
+-- onPollChange(fn(id, changes)) - 轮询值变化回调，changes = {{tag=, addr=, value=, previous=}}，只包含变化的值(模拟量按 deadband)
+-- modbusWrite{unit=, addr=, value= 或 values={...}, coil=, priority=} / getWriteStats() - 写入(05/06/0F/10)，相邻的写合并为一帧，与轮询按优先级交替
+-- getPollUnits() - 从站健康状态，连续失败的从站断开(open)，只定期探测，恢复应答后重新轮询
 
 -- 数据格式类型定义
 local DATA_FORMATS = {
@@ -28,13 +33,18 @@ local DATA_FORMATS = {
 local settings = {
     pollInterval = 100,     -- 轮询间隔(毫秒)
     responseTimeout = 100,  -- 响应超时时间(毫秒)
-    decimalPlaces = 2       -- 浮点数小数位数
+    decimalPlaces = 2,      -- 浮点数小数位数
+    nativePolling = true,   -- 使用原生轮询调度(按组的 period/priority)，false 时使用下面的脚本轮询循环
+    statsInterval = 5000,   -- 原生轮询时输出统计的间隔(毫秒)
+    printChangesOnly = true, -- 只输出有变化的值，静态数据不刷屏
+    readWrite = true        -- 原生轮询时寄存器写搭载在同站 0x03 轮询上用 0x17 发送(从站不支持时自动分开)
 }
 
 -- 参数设置，每组可独立配置从站 ID、功能码、地址和个数和数据格式
+-- 原生轮询时 period 为该组周期(毫秒，默认 pollInterval)，priority 越大越优先，deadband 为模拟量的上报死区
 local poll_config = {
-    {unit_id = 1, func_code = 0x03, start_addr = 0x0000, quantity = 10, format = DATA_FORMATS.UINT16},
-    {unit_id = 1, func_code = 0x04, start_addr = 0x0000, quantity = 10, format = DATA_FORMATS.FLOAT_ABCD}
+    {unit_id = 1, func_code = 0x03, start_addr = 0x0000, quantity = 10, format = DATA_FORMATS.UINT16, period = 100, priority = 1},
+    {unit_id = 1, func_code = 0x04, start_addr = 0x0000, quantity = 10, format = DATA_FORMATS.FLOAT_ABCD, period = 1000, deadband = 0.01}
 }
 
 -- 获取功能码对应的名称
@@ -43,7 +53,12 @@ function get_func_name(func_code)
         [0x01] = "线圈状态",
         [0x02] = "离散输入",
         [0x03] = "保持寄存器",
-        [0x04] = "输入寄存器"
+        [0x04] = "输入寄存器",
+        [0x05] = "写单个线圈",
+        [0x06] = "写单个寄存器",
+        [0x0F] = "写多个线圈",
+        [0x10] = "写多个寄存器",
+        [0x17] = "读写多个寄存器"
     }
     return names[func_code] or "未知功能码"
 end
@@ -148,6 +163,18 @@ function parse_long(bytes, format)
     return value
 end
 
+-- 上次输出的内容，按 功能码/地址 区分
+local last_output = {}
+
+function print_values(func_code, start_addr, output)
+    local key = func_code .. "/" .. start_addr
+    if settings.printChangesOnly and last_output[key] == output then
+        return
+    end
+    last_output[key] = output
+    print(output)
+end
+
 function parse_response(response, func_code, start_addr, format, quantity)
     local func_name = get_func_name(func_code)
     
@@ -211,7 +238,7 @@ function parse_response(response, func_code, start_addr, format, quantity)
         end
         
         output = output .. " 值:" .. table.concat(states, ",")
-        print(output)
+        print_values(func_code, start_addr, output)
         
     elseif func_code == 0x03 or func_code == 0x04 then
         local values = {}
@@ -273,7 +300,7 @@ function parse_response(response, func_code, start_addr, format, quantity)
         end
         
         output = output .. " " .. format_desc .. " 值:" .. table.concat(values, ",")
-        print(output)
+        print_values(func_code, start_addr, output)
     end
 end
 
@@ -292,9 +319,58 @@ function init()
     end
 end
 
+-- 原生轮询：各组按自己的周期和优先级在 C++ 中调度，连续失败的从站断开后只定期探测，不拖慢其他组
+-- 读到的值记入标签存储(曲线页查看)，这里只输出变化的值和定时的轮询统计
+function run_native_polling()
+    onPollChange(function(id, changes)
+        for _, c in ipairs(changes) do
+            if c.previous then
+                print(string.format("组%d %s: %g -> %g", id, c.tag, c.previous, c.value))
+            else
+                print(string.format("组%d %s: %g", id, c.tag, c.value))
+            end
+        end
+    end)
+    clearPolls()
+    for i, cfg in ipairs(poll_config) do
+        local id, err = addPoll{
+            unit = cfg.unit_id, func = cfg.func_code, addr = cfg.start_addr, count = cfg.quantity,
+            period = cfg.period or settings.pollInterval, priority = cfg.priority or 0, format = cfg.format,
+            deadband = cfg.deadband or 0
+        }
+        if not id then
+            log.error("轮询配置 #%d 无效: %s", i, err)
+        end
+    end
+    startPolling{protocol = "tcp", timeout = settings.responseTimeout, readWrite = settings.readWrite}
+
+    while true do
+        sleep(settings.statsInterval)
+        for _, s in ipairs(getPollStats()) do
+            print(string.format("组%d 从站%d 0x%02X: 请求%d 应答%d 超时%d 异常%d 错过截止%d 实际周期%.1fms 退避%dms",
+                s.id, s.unit, s.func, s.polls, s.responses, s.timeouts, s.exceptions, s.misses, s.actualPeriodMs, s.backoffMs))
+        end
+        local w = getWriteStats()
+        if w.queued > 0 then
+            print(string.format("写入: 排队%d 合并%d 帧%d(0x17 %d) 成功%d 失败%d 平均%.1fms",
+                w.queued, w.merged, w.frames, w.readWriteFrames, w.ok, w.failed, w.meanLatencyMs))
+        end
+        for _, u in ipairs(getPollUnits()) do
+            if u.state ~= "closed" then
+                print(string.format("从站%d %s: 连续失败%d 超时%d CRC错误%d 断开%d次 探测%d次 %dms后探测",
+                    u.unit, u.state, u.failures, u.timeouts, u.crcErrors, u.trips, u.probes, u.retryMs))
+            end
+        end
+    end
+end
+
 -- 初始化
 init()
 
+if settings.nativePolling then
+    run_native_polling()
+end
+
 local transaction_id = 1
 while true do
     for _, cfg in ipairs(poll_config) do
@@ -0,0 +1,1101 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QUdpSocket>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#ifdef Q_OS_MACOS
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+#endif
+
+#include "serialhandler.h"
+#include "codec.h"
+#include "trafficmodel.h"
+#include "triggerengine.h"
+#include "dissector.h"
+#include "tagstore.h"
+#include "chartmodel.h"
+#include "exporter.h"
+#include "sessionhistory.h"
+#include "pollscheduler.h"
+
+// mjcom_bench 性能基准：接收→解码→显示链路、十六进制编解码、Lua 绑定和 Modbus 脚本解析
+// 输出吞吐、延迟分位数和每次操作的堆分配次数
+
+// === 堆分配计数 ===
+// glibc 下替换 malloc 系列，能统计到 Qt 容器内部的分配；其他平台只统计 operator new
+
+static std::atomic<quint64> allocCount{0};
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) noexcept {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) noexcept {
+    __libc_free(ptr);
+}
+}
+#else
+void *operator new(std::size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+namespace {
+
+struct BenchResult {
+    QString name;
+    qint64 ops = 0;
+    qint64 bytes = 0;
+    qint64 elapsedNs = 0;
+    quint64 allocs = 0;
+    std::vector<qint64> latencies;  // 单次延迟(纳秒)，为空时不输出分位数
+};
+
+QTextStream out(stdout);
+QString filter;
+int scale = 1;  // --quick 时缩小迭代次数
+
+double percentile(std::vector<qint64> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = size_t(p * (sorted.size() - 1) + 0.5);
+    return sorted[qMin(index, sorted.size() - 1)] / 1000.0;
+}
+
+void report(BenchResult &result) {
+    double seconds = result.elapsedNs / 1e9;
+    std::sort(result.latencies.begin(), result.latencies.end());
+
+    out << QString("%1").arg(result.name, -22)
+        << QString("%1").arg(result.ops, 10)
+        << QString("%1").arg(seconds > 0 ? result.ops / seconds : 0.0, 14, 'f', 0);
+    if (result.bytes > 0) {
+        out << QString("%1").arg(seconds > 0 ? result.bytes / seconds / 1048576.0 : 0.0, 10, 'f', 2);
+    } else {
+        out << QString("%1").arg("-", 10);
+    }
+    if (!result.latencies.empty()) {
+        out << QString("%1").arg(percentile(result.latencies, 0.50), 10, 'f', 1)
+            << QString("%1").arg(percentile(result.latencies, 0.99), 10, 'f', 1)
+            << QString("%1").arg(result.latencies.back() / 1000.0, 10, 'f', 1);
+    } else {
+        out << QString("%1").arg("-", 10) << QString("%1").arg("-", 10) << QString("%1").arg("-", 10);
+    }
+    out << QString("%1").arg(result.ops > 0 ? double(result.allocs) / result.ops : 0.0, 12, 'f', 2)
+        << Qt::endl;
+}
+
+// 名称包含过滤串，或过滤串是该组基准下的具体项
+bool selected(const QString &name) {
+    return filter.isEmpty() || name.contains(filter) || filter.startsWith(name);
+}
+
+// 处理事件直到条件满足或超时
+bool waitUntil(const std::function<bool()> &condition, int timeoutMs = 10000) {
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() > timeoutMs) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::AllEvents);
+    }
+    return true;
+}
+
+// 统计 SerialHandler 输出的接收数据
+struct RxCounter {
+    qint64 chunks = 0;
+    qint64 bytes = 0;
+    QMetaObject::Connection connection;
+
+    ~RxCounter() {
+        QObject::disconnect(connection);
+    }
+
+    void attach(SerialHandler &handler) {
+        connection = QObject::connect(&handler, &SerialHandler::dataReceived,
+                                      [this](const QByteArray &data, qint64) {
+                                          chunks++;
+                                          bytes += data.size();
+                                      });
+    }
+};
+
+// === 十六进制编解码 ===
+
+void benchHexCodec(int payloadSize) {
+    BenchResult result;
+    result.name = QString("codec.hex2bytes.%1").arg(payloadSize);
+    if (!selected(result.name)) {
+        return;
+    }
+
+    QByteArray payload(payloadSize, 0);
+    for (int i = 0; i < payloadSize; i++) {
+        payload[i] = char(i * 37);
+    }
+    const QString hex = QString::fromLatin1(payload.toHex(' ').toUpper());
+
+    const int iterations = 200000 / scale / qMax(1, payloadSize / 64);
+    result.latencies.reserve(iterations);
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        qint64 start = total.nsecsElapsed();
+        QByteArray bytes = Codec::fromHexString(hex);
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.bytes += bytes.size();
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    // latencies 已预留容量，不计入分配
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = iterations;
+    report(result);
+}
+
+// 接收显示用的字节转十六进制文本
+void benchHexEncode(int payloadSize) {
+    BenchResult result;
+    result.name = QString("codec.bytes2hex.%1").arg(payloadSize);
+    if (!selected(result.name)) {
+        return;
+    }
+
+    QByteArray payload(payloadSize, 0);
+    for (int i = 0; i < payloadSize; i++) {
+        payload[i] = char(i * 37);
+    }
+
+    const int iterations = 200000 / scale / qMax(1, payloadSize / 64);
+    result.latencies.reserve(iterations);
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        qint64 start = total.nsecsElapsed();
+        QString hex = Codec::toHexString(payload);
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.bytes += payload.size();
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = iterations;
+    report(result);
+}
+
+// === 接收触发器：多个带通配的模式一次扫描 ===
+
+void benchTriggerScan(int patternCount) {
+    BenchResult result;
+    result.name = QString("trigger.scan.%1").arg(patternCount);
+    if (!selected(result.name)) {
+        return;
+    }
+
+    // 模式以 0xA5 开头，数据中该字节稀疏出现，可测到首字节预过滤的效果
+    TriggerEngine engine;
+    for (int i = 0; i < patternCount; i++) {
+        engine.addPattern(QString("A5 %1 ?? %2").arg(i & 0xFF, 2, 16, QLatin1Char('0'))
+                                               .arg((i * 7) & 0xFF, 2, 16, QLatin1Char('0')));
+    }
+
+    const int chunkSize = 4096;
+    QByteArray chunk(chunkSize, 0);
+    for (int i = 0; i < chunkSize; i++) {
+        chunk[i] = char((i * 37) % 0xA5);
+    }
+    for (int i = 0; i < chunkSize; i += 512) {
+        chunk[i] = char(0xA5);
+        chunk[i + 1] = char((i / 512) % patternCount);
+    }
+
+    const int iterations = 20000 / scale;
+    result.latencies.reserve(iterations);
+    QVector<TriggerMatch> matches;
+    matches.reserve(64);
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        qint64 start = total.nsecsElapsed();
+        engine.feed(chunk.constData(), chunk.size(), matches);
+        matches.clear();
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.bytes += chunk.size();
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = iterations;
+    report(result);
+}
+
+// === 协议解析：Modbus RTU 应答流按 CRC 切帧并解析寄存器 ===
+
+void benchDissector() {
+    BenchResult result;
+    result.name = "dissect.modbus-rtu";
+    if (!selected(result.name)) {
+        return;
+    }
+
+    // 16 个 03 功能码应答(各 10 个寄存器)首尾相接，按 64 字节分块输入，模拟跨块的帧
+    QByteArray stream;
+    for (int i = 0; i < 16; i++) {
+        QByteArray frame;
+        frame.append(char(1));
+        frame.append(char(0x03));
+        frame.append(char(20));
+        for (int r = 0; r < 10; r++) {
+            frame.append(char(i));
+            frame.append(char(r));
+        }
+        quint16 crc = Codec::modbusCrc16(frame.constData(), frame.size());
+        frame.append(char(crc & 0xFF));
+        frame.append(char(crc >> 8));
+        stream.append(frame);
+    }
+
+    std::unique_ptr<Dissector> dissector = DissectorRegistry::create("modbus-rtu");
+    QVector<DissectedFrame> frames;
+    const int iterations = 20000 / scale;
+    result.latencies.reserve(iterations);
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        qint64 start = total.nsecsElapsed();
+        for (int offset = 0; offset < stream.size(); offset += 64) {
+            dissector->feed(stream.constData() + offset, qMin(64, int(stream.size()) - offset), frames);
+        }
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.ops += frames.size();
+        result.bytes += stream.size();
+        frames.clear();
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    report(result);
+}
+
+// === 标签存储：轮询值压缩追加，按时间范围解压遍历，曲线按像素列抽稀 ===
+
+void benchTagStore() {
+    if (!selected("tagstore.")) {
+        return;
+    }
+
+    BenchResult result;
+    result.name = "tagstore.record";
+
+    // 8 个标签每 100ms 一个点，值为缓慢变化的寄存器读数；每次迭代写入 1000 个点
+    TagStore store;
+    const int iterations = 2000 / scale;
+    const int batch = 1000;
+    qint64 time = 1700000000000;
+    result.latencies.reserve(iterations);
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        qint64 start = total.nsecsElapsed();
+        for (int n = 0; n < batch; n++) {
+            int tag = n % 8;
+            store.record(QStringLiteral("1/3/%1").arg(tag), 1000 + ((i * batch + n) / 64 + tag) % 50, time);
+            if (tag == 7) {
+                time += 100;
+            }
+        }
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.ops += batch;
+        result.bytes += batch * qint64(sizeof(TagPoint));
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    report(result);
+
+    BenchResult query;
+    query.name = "tagstore.query";
+    const qint64 last = time;
+    double sum = 0;
+    allocsBefore = allocCount.load();
+    total.restart();
+    for (int i = 0; i < 100; i++) {
+        qint64 start = total.nsecsElapsed();
+        store.visit(QStringLiteral("1/3/0"), last - 600 * 1000, last, [&](qint64, double value) {
+            sum += value;
+            query.ops++;
+        });
+        query.latencies.push_back(total.nsecsElapsed() - start);
+    }
+    query.bytes = query.ops * qint64(sizeof(TagPoint));
+    query.elapsedNs = total.nsecsElapsed();
+    query.allocs = allocCount.load() - allocsBefore;
+    Q_UNUSED(sum);
+    report(query);
+
+    // 曲线抽稀：一个标签全部原始点按 800 列做 M4
+    BenchResult chart;
+    chart.name = "tagstore.chart";
+    ChartModel chartModel(&store);
+    chartModel.setColumns(800);
+    chartModel.setWindowMs(last - 1700000000000);
+    chartModel.setTags({QStringLiteral("1/3/0")});
+    allocsBefore = allocCount.load();
+    total.restart();
+    for (int i = 0; i < 20; i++) {
+        qint64 start = total.nsecsElapsed();
+        chartModel.refresh();
+        chart.latencies.push_back(total.nsecsElapsed() - start);
+        chart.ops += chartModel.getStats().value("sourcePoints").toLongLong();
+    }
+    chart.bytes = chart.ops * qint64(sizeof(TagPoint));
+    chart.elapsedNs = total.nsecsElapsed();
+    chart.allocs = allocCount.load() - allocsBefore;
+    report(chart);
+}
+
+// === 导出：收发记录按批交给写线程编码写盘 ===
+
+void benchExport(ExportWriter::Format format) {
+    BenchResult result;
+    result.name = format == ExportWriter::Csv ? "export.csv" : "export.columnar";
+    if (!selected(result.name)) {
+        return;
+    }
+
+    const QString path = QDir::temp().filePath(format == ExportWriter::Csv ? "mjcom_bench.csv" : "mjcom_bench.mjcol");
+    ExportWriter writer;
+    if (!writer.open(path, format, ExportWriter::Traffic)) {
+        return;
+    }
+
+    // 8 字节请求和 25 字节应答交替，每批 8192 行
+    const QByteArray request = QByteArray::fromHex("01030000000A C5CD");
+    const QByteArray response(25, char(0x5A));
+    const int batches = 200 / scale;
+    qint64 time = 1700000000000;
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int b = 0; b < batches; b++) {
+        ExportBatch batch;
+        for (int i = 0; i < 8192; i++) {
+            const bool rx = i & 1;
+            batch.times.append(time++);
+            batch.names.append(rx ? QStringLiteral("rx") : QStringLiteral("tx"));
+            batch.data.append(rx ? response : request);
+            result.bytes += rx ? response.size() : request.size();
+        }
+        qint64 start = total.nsecsElapsed();
+        writer.push(std::move(batch));
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.ops += 8192;
+    }
+    writer.close();
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    report(result);
+    QFile::remove(path);
+}
+
+// === Modbus 轮询：应答解码、记入标签、选出并编码下一个请求 ===
+
+void benchPollScheduler() {
+    BenchResult result;
+    result.name = "poll.response";
+    if (!selected(result.name)) {
+        return;
+    }
+
+    // 16 组各读 20 个保持寄存器，周期 1ms，总线上总有到期的组；从站应答立即送回
+    TagStore store;
+    PollScheduler scheduler(&store);
+    QByteArray request;
+    scheduler.setWriter([&request](const QByteArray &frame) {
+        request = frame;
+        return true;
+    });
+    for (int i = 0; i < 16; i++) {
+        PollScheduler::Group group;
+        group.request.function = Modbus::ReadHoldingRegisters;
+        group.request.address = i * 20;
+        group.request.count = 20;
+        group.periodMs = 1;
+        scheduler.addGroup(group);
+    }
+
+    QByteArray response;
+    response.append(char(1));
+    response.append(char(Modbus::ReadHoldingRegisters));
+    response.append(char(40));
+    for (int i = 0; i < 40; i++) {
+        response.append(char(i));
+    }
+    const quint16 crc = Codec::modbusCrc16(response.constData(), response.size());
+    response.append(char(crc & 0xFF));
+    response.append(char(crc >> 8));
+
+    const int iterations = 200000 / scale;
+    result.latencies.reserve(iterations);
+    scheduler.start();
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        while (request.isEmpty()) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents);
+        }
+        request.clear();
+        qint64 start = total.nsecsElapsed();
+        scheduler.feed(response.constData(), response.size());
+        qint64 elapsed = total.nsecsElapsed() - start;
+        result.latencies.push_back(elapsed);
+        result.elapsedNs += elapsed;
+        result.ops++;
+        result.bytes += response.size();
+    }
+    result.allocs = allocCount.load() - allocsBefore;
+    scheduler.stop();
+    report(result);
+}
+
+// === 会话历史：追加写盘，按块索引检索 ===
+
+void benchHistory() {
+    if (!selected("history.")) {
+        return;
+    }
+
+    BenchResult result;
+    result.name = "history.append";
+
+    // Modbus 请求/应答交替，每隔 100000 帧插入一帧带特征字节的应答
+    SessionHistory history;
+    if (!history.open()) {
+        return;
+    }
+    const QByteArray request = QByteArray::fromHex("01030000000A C5CD");
+    QByteArray response(25, char(0x5A));
+    const QByteArray needle = QByteArray::fromHex("DEADBEEF");
+    const int frames = 2000000 / scale;
+    qint64 time = 1700000000000;
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < frames; i += 1000) {
+        qint64 start = total.nsecsElapsed();
+        for (int n = i; n < i + 1000; n++) {
+            if (n & 1) {
+                response[3] = char(n >> 1);
+                const bool marked = n % 100000 == 1;
+                if (marked) {
+                    response.replace(8, needle.size(), needle);
+                }
+                history.append(SessionHistory::Received, SessionHistory::Serial, response.constData(), response.size(), time);
+                if (marked) {
+                    response.replace(8, needle.size(), QByteArray(needle.size(), char(0x5A)));
+                }
+                result.bytes += response.size();
+            } else {
+                history.append(SessionHistory::Sent, SessionHistory::Serial, request.constData(), request.size(), time);
+                result.bytes += request.size();
+            }
+            time += 5;
+        }
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.ops += 1000;
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    report(result);
+
+    // 全部历史中找特征字节，块索引跳过绝大多数块
+    BenchResult search;
+    search.name = "history.search";
+    SessionHistory::Query query;
+    query.pattern = needle;
+    query.directions = 1 << SessionHistory::Received;
+    allocsBefore = allocCount.load();
+    total.restart();
+    for (int i = 0; i < 20; i++) {
+        qint64 start = total.nsecsElapsed();
+        search.ops += history.search(query).size();
+        search.latencies.push_back(total.nsecsElapsed() - start);
+    }
+    search.bytes = history.statistics().value("bytes").toLongLong() * 20;
+    search.elapsedNs = total.nsecsElapsed();
+    search.allocs = allocCount.load() - allocsBefore;
+    report(search);
+}
+
+// === 收发记录模型：追加进待插入队列，批量插入，只格式化可见行 ===
+
+void benchTrafficModel() {
+    if (!selected("model.")) {
+        return;
+    }
+
+    BenchResult result;
+    result.name = "model.append";
+
+    TrafficModel model;
+    model.setMaxRows(10000);
+    QByteArray payload(64, 0);
+    for (int i = 0; i < payload.size(); i++) {
+        payload[i] = char(i * 37);
+    }
+
+    const int iterations = 200000 / scale;
+    result.latencies.reserve(iterations);
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < iterations; i++) {
+        qint64 start = total.nsecsElapsed();
+        model.appendReceived(payload, i);
+        result.latencies.push_back(total.nsecsElapsed() - start);
+        result.bytes += payload.size();
+    }
+    model.flush();
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = iterations;
+    report(result);
+
+    // 切换显示模式后只取 50 行可见文本，与历史行数无关
+    BenchResult toggle;
+    toggle.name = "model.toggle";
+    const int visibleRows = 50;
+    const int toggles = 3000 / scale;
+    toggle.latencies.reserve(toggles);
+    allocsBefore = allocCount.load();
+    total.restart();
+    for (int i = 0; i < toggles; i++) {
+        qint64 start = total.nsecsElapsed();
+        model.setDisplayMode(i % 3);
+        for (int row = model.count() - visibleRows; row < model.count(); row++) {
+            model.data(model.index(row), TrafficModel::TextRole);
+        }
+        toggle.latencies.push_back(total.nsecsElapsed() - start);
+    }
+    toggle.elapsedNs = total.nsecsElapsed();
+    toggle.allocs = allocCount.load() - allocsBefore;
+    toggle.ops = toggles;
+    report(toggle);
+    QVariantMap stats = model.getStats();
+    out << "  model rows " << stats["rows"].toLongLong() << ", batches " << stats["batches"].toLongLong()
+        << ", dropped " << stats["dropped"].toLongLong() << ", formatted " << stats["formatted"].toLongLong()
+        << ", cache hits " << stats["cacheHits"].toLongLong() << Qt::endl;
+}
+
+// === 接收链路：对端写入 → readyRead → processReceivedData → dataReceived ===
+
+// 逐个往返测延迟，再连续发送测吞吐
+void runRxBench(const QString &name, SerialHandler &handler,
+                const std::function<void(const QByteArray &)> &write,
+                int chunkSize, int latencyRounds, qint64 throughputBytes) {
+    RxCounter counter;
+    counter.attach(handler);
+    QByteArray chunk(chunkSize, 'U');
+
+    if (selected(name + ".latency")) {
+        BenchResult result;
+        result.name = name + ".latency";
+        result.latencies.reserve(latencyRounds);
+
+        quint64 allocsBefore = allocCount.load();
+        QElapsedTimer total;
+        total.start();
+        for (int i = 0; i < latencyRounds; i++) {
+            qint64 expected = counter.bytes + chunkSize;
+            qint64 start = total.nsecsElapsed();
+            write(chunk);
+            if (!waitUntil([&]() { return counter.bytes >= expected; })) {
+                out << name << ": 接收超时" << Qt::endl;
+                return;
+            }
+            result.latencies.push_back(total.nsecsElapsed() - start);
+        }
+        result.elapsedNs = total.nsecsElapsed();
+        result.allocs = allocCount.load() - allocsBefore;
+        result.ops = latencyRounds;
+        result.bytes = qint64(latencyRounds) * chunkSize;
+        report(result);
+    }
+
+    if (selected(name + ".throughput")) {
+        BenchResult result;
+        result.name = name + ".throughput";
+
+        qint64 startBytes = counter.bytes;
+        qint64 startChunks = counter.chunks;
+        quint64 allocsBefore = allocCount.load();
+        QElapsedTimer total;
+        total.start();
+        for (qint64 sent = 0; sent < throughputBytes; sent += chunkSize) {
+            write(chunk);
+            // 每 64 块让出一次事件循环，避免发送端缓冲无限增长
+            if ((sent / chunkSize) % 64 == 63) {
+                QCoreApplication::processEvents(QEventLoop::AllEvents);
+            }
+        }
+        // 等到全部收到，或 1 秒内没有新数据(UDP 可能丢包)
+        qint64 lastBytes = -1;
+        while (counter.bytes - startBytes < throughputBytes && counter.bytes != lastBytes) {
+            lastBytes = counter.bytes;
+            waitUntil([&]() { return counter.bytes - startBytes >= throughputBytes; }, 1000);
+        }
+        result.elapsedNs = total.nsecsElapsed();
+        result.allocs = allocCount.load() - allocsBefore;
+        result.ops = counter.chunks - startChunks;
+        result.bytes = counter.bytes - startBytes;
+        report(result);
+    }
+
+    // 不连接 dataReceived，只走读入缓冲池 → 脚本交付，验证稳态接收不分配内存
+    // (连接界面时 dataReceived 每块拷贝一次，不在此零分配数字内)
+    if (selected(name + ".pooled")) {
+        QObject::disconnect(counter.connection);
+        BenchResult result;
+        result.name = name + ".pooled";
+
+        auto roundTrip = [&]() {
+            qint64 expected = handler.receivedBytes() + chunkSize;
+            write(chunk);
+            return waitUntil([&]() { return handler.receivedBytes() >= expected; });
+        };
+
+        // 预热，让缓冲池和设备缓冲进入稳态
+        for (int i = 0; i < 16; i++) {
+            roundTrip();
+        }
+
+        qint64 poolAllocsBefore = handler.rxPoolStats().allocations;
+        quint64 allocsBefore = allocCount.load();
+        QElapsedTimer total;
+        total.start();
+        for (int i = 0; i < latencyRounds; i++) {
+            if (!roundTrip()) {
+                out << name << ": 接收超时" << Qt::endl;
+                return;
+            }
+        }
+        result.elapsedNs = total.nsecsElapsed();
+        result.allocs = allocCount.load() - allocsBefore;
+        result.ops = latencyRounds;
+        result.bytes = qint64(latencyRounds) * chunkSize;
+        report(result);
+        out << "  " << result.name << " 缓冲池堆分配: "
+            << handler.rxPoolStats().allocations - poolAllocsBefore << Qt::endl;
+    }
+}
+
+void benchUdp() {
+    if (!selected("rx.udp")) {
+        return;
+    }
+
+    SerialHandler handler;
+    QUdpSocket peer;
+    peer.bind(QHostAddress::LocalHost, 0);
+    if (!handler.startUdp(0, "127.0.0.1", peer.localPort())) {
+        out << "rx.udp: 绑定失败" << Qt::endl;
+        return;
+    }
+
+    // startUdp 绑定在任意端口，通过对端收到的首个报文得知 SerialHandler 的端口
+    handler.sendData("00", true);
+    if (!waitUntil([&]() { return peer.hasPendingDatagrams(); }, 2000)) {
+        out << "rx.udp: 无法获取本地端口" << Qt::endl;
+        return;
+    }
+    QHostAddress sender;
+    quint16 senderPort = 0;
+    QByteArray probe(peer.pendingDatagramSize(), 0);
+    peer.readDatagram(probe.data(), probe.size(), &sender, &senderPort);
+
+    runRxBench("rx.udp", handler,
+               [&](const QByteArray &chunk) { peer.writeDatagram(chunk, QHostAddress::LocalHost, senderPort); },
+               256, 5000 / scale, 16LL * 1024 * 1024 / scale);
+}
+
+void benchTcp() {
+    if (!selected("rx.tcp")) {
+        return;
+    }
+
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost, 0);
+
+    SerialHandler handler;
+    handler.connectToTcpServer("127.0.0.1", server.serverPort());
+    if (!waitUntil([&]() { return server.hasPendingConnections() && handler.isTcpConnected(); }, 5000)) {
+        out << "rx.tcp: 连接失败" << Qt::endl;
+        return;
+    }
+    QTcpSocket *peer = server.nextPendingConnection();
+
+    runRxBench("rx.tcp", handler,
+               [&](const QByteArray &chunk) { peer->write(chunk); peer->flush(); },
+               4096, 5000 / scale, 64LL * 1024 * 1024 / scale);
+}
+
+void benchSerial() {
+#ifdef Q_OS_UNIX
+    if (!selected("rx.serial")) {
+        return;
+    }
+
+    // 伪终端对：SerialHandler 打开从端，基准程序写主端
+    int master = -1;
+    int slave = -1;
+    char slaveName[256] = {0};
+    if (::openpty(&master, &slave, slaveName, nullptr, nullptr) != 0) {
+        out << "rx.serial: openpty 失败" << Qt::endl;
+        return;
+    }
+
+    SerialHandler handler;
+    handler.openPort(QString::fromLocal8Bit(slaveName), "115200", "8", "1", "None");
+
+    runRxBench("rx.serial", handler,
+               [&](const QByteArray &chunk) {
+                   qint64 offset = 0;
+                   while (offset < chunk.size()) {
+                       ssize_t n = ::write(master, chunk.constData() + offset, chunk.size() - offset);
+                       if (n <= 0) {
+                           QCoreApplication::processEvents(QEventLoop::AllEvents);
+                           continue;
+                       }
+                       offset += n;
+                   }
+               },
+               64, 2000 / scale, 4LL * 1024 * 1024 / scale);
+
+    handler.closePort();
+    ::close(slave);
+    ::close(master);
+#endif
+}
+
+// === 虚拟 Modbus 从站轮询：请求 → 限速应答 → RTU 分帧 → dataReceived ===
+
+void benchVirtualRtu(int baudRate) {
+    QString name = QString("rtu.virtual.%1").arg(baudRate);
+    if (!selected(name)) {
+        return;
+    }
+
+    SerialHandler handler;
+    QString port = handler.createVirtualSerial("modbus");
+    if (port.isEmpty()) {
+        out << name << ": 虚拟串口创建失败" << Qt::endl;
+        return;
+    }
+    handler.setRtuFraming(true);
+    handler.openPort(port, QString::number(baudRate), "8", "1", "None");
+
+    RxCounter counter;
+    counter.attach(handler);
+
+    // 读 10 个保持寄存器，应答 25 字节
+    const int rounds = qMax(5, (baudRate >= 115200 ? 2000 : 200) / scale);
+    BenchResult result;
+    result.name = name;
+    result.latencies.reserve(rounds);
+
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < rounds; i++) {
+        qint64 expected = counter.chunks + 1;
+        qint64 start = total.nsecsElapsed();
+        handler.sendData("01 03 00 00 00 0A C5 CD", true);
+        if (!waitUntil([&]() { return counter.chunks >= expected; }, 2000)) {
+            out << name << ": 应答超时" << Qt::endl;
+            return;
+        }
+        result.latencies.push_back(total.nsecsElapsed() - start);
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = rounds;
+    result.bytes = counter.bytes;
+    report(result);
+
+    handler.closePort();
+    handler.closeVirtualSerial();
+}
+
+// === Lua 绑定 ===
+
+void runLuaBench(const QString &name, SerialHandler &handler, const QString &script, int iterations) {
+    if (!selected(name)) {
+        return;
+    }
+
+    BenchResult result;
+    result.name = name;
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    QString status = handler.executeLuaScript(script);
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = iterations;
+    if (status != "脚本执行完成") {
+        out << name << ": " << status << Qt::endl;
+        return;
+    }
+    report(result);
+}
+
+void benchLua() {
+    if (!selected("lua.")) {
+        return;
+    }
+
+    // sendHex 经 UDP 发往一个不读取的端口，只测绑定和编码开销
+    SerialHandler handler;
+    QUdpSocket sink;
+    sink.bind(QHostAddress::LocalHost, 0);
+    handler.startUdp(0, "127.0.0.1", sink.localPort());
+
+    const int iterations = 100000 / scale;
+    runLuaBench("lua.sendHex", handler,
+                QString("for i = 1, %1 do sendHex('01 03 00 00 00 0A C5 CD') end").arg(iterations),
+                iterations);
+    runLuaBench("lua.getLastData", handler,
+                QString("for i = 1, %1 do local d = getLastData() end").arg(iterations),
+                iterations);
+    runLuaBench("lua.print", handler,
+                QString("for i = 1, %1 do print('reg', i, 1234) end").arg(iterations),
+                iterations);
+    runLuaBench("lua.log.info", handler,
+                QString("log.setLevel('info') for i = 1, %1 do log.info('reg %d = %d', i, 1234) end").arg(iterations),
+                iterations);
+    // 级别关闭的 log 调用只有一次上值比较
+    runLuaBench("lua.log.disabled", handler,
+                QString("log.setLevel('info') for i = 1, %1 do log.debug('reg %d = %d', i, 1234) end").arg(iterations),
+                iterations);
+}
+
+// === 脚本反复重启：协程关闭后主线程栈和内存应保持平稳 ===
+
+void benchLuaRestart() {
+    BenchResult result;
+    result.name = "lua.restart";
+    if (!selected(result.name)) {
+        return;
+    }
+
+    SerialHandler handler;
+    const QString script = "local t = {} for i = 1, 64 do t[i] = tostring(i) end";
+    const int restarts = 20000 / scale;
+
+    handler.executeLuaScript(script);
+    handler.collectLuaGarbage();
+    QVariantMap before = handler.getLuaMemoryStats();
+
+    result.latencies.reserve(restarts);
+    quint64 allocsBefore = allocCount.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < restarts; i++) {
+        qint64 start = total.nsecsElapsed();
+        handler.executeLuaScript(script);
+        result.latencies.push_back(total.nsecsElapsed() - start);
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.allocs = allocCount.load() - allocsBefore;
+    result.ops = restarts;
+    report(result);
+
+    handler.collectLuaGarbage();
+    QVariantMap after = handler.getLuaMemoryStats();
+    out << "  lua memory " << before["bytes"].toLongLong() << " -> " << after["bytes"].toLongLong()
+        << " bytes, main stack " << before["mainStackTop"].toInt() << " -> " << after["mainStackTop"].toInt()
+        << Qt::endl;
+    out << "  lua allocator " << after["allocations"].toLongLong() << " requests, "
+        << after["poolHits"].toLongLong() << " pool hits, " << after["inPlace"].toLongLong() << " in place, "
+        << after["poolChunks"].toLongLong() << " chunks" << Qt::endl;
+}
+
+// === Modbus 脚本解析 ===
+
+// 取出脚本中的函数定义(去掉末尾的初始化和轮询循环)
+QString loadModbusFunctions(const QString &fileName) {
+    QFile file(QString(MJCOM_SOURCE_DIR) + "/" + fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    QString script = QString::fromUtf8(file.readAll());
+    int loopStart = script.lastIndexOf("\ninit()");
+    return loopStart > 0 ? script.left(loopStart) : QString();
+}
+
+void benchModbusScript() {
+    if (!selected("modbus.")) {
+        return;
+    }
+
+    QString functions = loadModbusFunctions("Modbus RTU master.lua");
+    if (functions.isEmpty()) {
+        out << "modbus: 找不到脚本" << Qt::endl;
+        return;
+    }
+
+    SerialHandler handler;
+    qint64 lines = 0;
+    QObject::connect(&handler, &SerialHandler::luaOutput,
+                     [&lines](const QString &output) { lines += output.count('\n') + 1; });
+
+    // 合成响应：从站1，20个寄存器，按Lua转义字符串拼出
+    auto buildResponse = [](int funcCode) {
+        QString response = QString("\\x01\\x%1\\x28").arg(funcCode, 2, 16, QLatin1Char('0'));
+        for (int i = 0; i < 40; i++) {
+            response += QString("\\x%1").arg(quint8(i * 7), 2, 16, QLatin1Char('0'));
+        }
+        return response;
+    };
+
+    const int iterations = 20000 / scale;
+    runLuaBench("modbus.parse.uint16", handler,
+                functions + QString("\nlocal resp = \"%1\"\nfor i = 1, %2 do parse_response(resp, 0x03, 0, DATA_FORMATS.UINT16, 20) end")
+                                .arg(buildResponse(0x03)).arg(iterations),
+                iterations);
+    runLuaBench("modbus.parse.float", handler,
+                functions + QString("\nlocal resp = \"%1\"\nfor i = 1, %2 do parse_response(resp, 0x04, 0, DATA_FORMATS.FLOAT_ABCD, 10) end")
+                                .arg(buildResponse(0x04)).arg(iterations),
+                iterations);
+    runLuaBench("modbus.request", handler,
+                functions + QString("\nfor i = 1, %1 do local r = modbus_request(1, 3, i % 100, 20) end").arg(iterations),
+                iterations);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MJCom 性能基准");
+    parser.addHelpOption();
+    QCommandLineOption quickOption("quick", "缩短迭代次数(冒烟测试)");
+    QCommandLineOption filterOption("filter", "只运行名称包含该字符串的基准", "name");
+    parser.addOptions({quickOption, filterOption});
+    parser.process(app);
+
+    filter = parser.value(filterOption);
+    scale = parser.isSet(quickOption) ? 20 : 1;
+
+    // 基准期间屏蔽 qDebug 输出
+    qInstallMessageHandler([](QtMsgType type, const QMessageLogContext &, const QString &msg) {
+        if (type != QtDebugMsg) {
+            QTextStream(stderr) << msg << Qt::endl;
+        }
+    });
+
+    out << QString("%1").arg("benchmark", -22)
+        << QString("%1").arg("ops", 10)
+        << QString("%1").arg("ops/s", 14)
+        << QString("%1").arg("MB/s", 10)
+        << QString("%1").arg("p50(us)", 10)
+        << QString("%1").arg("p99(us)", 10)
+        << QString("%1").arg("max(us)", 10)
+        << QString("%1").arg("allocs/op", 12)
+        << Qt::endl;
+
+    benchHexCodec(8);
+    benchHexCodec(256);
+    benchHexEncode(8);
+    benchHexEncode(256);
+    benchTrafficModel();
+    benchTriggerScan(1);
+    benchTriggerScan(32);
+    benchDissector();
+    benchTagStore();
+    benchExport(ExportWriter::Csv);
+    benchExport(ExportWriter::Columnar);
+    benchHistory();
+    benchPollScheduler();
+    benchUdp();
+    benchTcp();
+    benchSerial();
+    benchVirtualRtu(9600);
+    benchVirtualRtu(115200);
+    benchLua();
+    benchLuaRestart();
+    benchModbusScript();
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "bufferpool.h"
+
+#include <cstring>
+#include <new>
+
+// === RxBuffer ===
+
+RxBuffer::RxBuffer(const RxBuffer &other) : slab(other.slab) {
+    if (slab) {
+        slab->ref++;
+    }
+}
+
+RxBuffer::RxBuffer(RxBuffer &&other) noexcept : slab(other.slab) {
+    other.slab = nullptr;
+}
+
+RxBuffer &RxBuffer::operator=(const RxBuffer &other) {
+    if (slab != other.slab) {
+        if (other.slab) {
+            other.slab->ref++;
+        }
+        release();
+        slab = other.slab;
+    }
+    return *this;
+}
+
+RxBuffer &RxBuffer::operator=(RxBuffer &&other) noexcept {
+    if (this != &other) {
+        release();
+        slab = other.slab;
+        other.slab = nullptr;
+    }
+    return *this;
+}
+
+RxBuffer::~RxBuffer() {
+    release();
+}
+
+void RxBuffer::resize(int size) {
+    if (slab) {
+        slab->size = qBound(0, size, slab->capacity);
+    }
+}
+
+int RxBuffer::append(const char *bytes, int count) {
+    if (!slab) {
+        return 0;
+    }
+    int n = qMin(count, slab->capacity - slab->size);
+    memcpy(slab->data() + slab->size, bytes, n);
+    slab->size += n;
+    return n;
+}
+
+void RxBuffer::release() {
+    if (!slab) {
+        return;
+    }
+    if (--slab->ref == 0) {
+        if (slab->pool) {
+            slab->pool->release(slab);
+        } else {
+            ::operator delete(slab);
+        }
+    }
+    slab = nullptr;
+}
+
+// === BufferPool ===
+
+BufferPool::BufferPool(int slabSize, int preallocate, int maxFree)
+    : blockSize(qMax(256, slabSize)), maxFreeSlabs(qMax(1, maxFree)) {
+    freeList.reserve(maxFreeSlabs);
+    allSlabs.reserve(maxFreeSlabs);
+    for (int i = 0; i < preallocate; i++) {
+        RxSlab *slab = allocateSlab(blockSize, this);
+        allSlabs.append(slab);
+        freeList.append(slab);
+    }
+}
+
+BufferPool::~BufferPool() {
+    // 空闲块直接释放，仍被句柄持有的块脱离池，由最后一个句柄释放
+    for (RxSlab *slab : std::as_const(allSlabs)) {
+        if (slab->ref == 0) {
+            ::operator delete(slab);
+        } else {
+            slab->pool = nullptr;
+        }
+    }
+}
+
+RxSlab *BufferPool::allocateSlab(int capacity, BufferPool *owner) {
+    void *memory = ::operator new(sizeof(RxSlab) + capacity);
+    counters.allocations++;
+    return new (memory) RxSlab{owner, 0, 0, capacity};
+}
+
+RxBuffer BufferPool::acquire(int minCapacity) {
+    counters.acquires++;
+
+    RxSlab *slab;
+    if (minCapacity > blockSize) {
+        // 超长请求(如大 UDP 报文)单独分配，释放时直接归还系统
+        counters.oversize++;
+        slab = allocateSlab(minCapacity, nullptr);
+    } else {
+        if (freeList.isEmpty()) {
+            slab = allocateSlab(blockSize, this);
+            allSlabs.append(slab);
+        } else {
+            slab = freeList.takeLast();
+        }
+        counters.inUse++;
+        counters.peakInUse = qMax(counters.peakInUse, counters.inUse);
+    }
+
+    slab->ref = 1;
+    slab->size = 0;
+    return RxBuffer(slab);
+}
+
+void BufferPool::release(RxSlab *slab) {
+    counters.inUse--;
+    if (freeList.size() >= maxFreeSlabs) {
+        // 突发过后收缩到 maxFree 块
+        allSlabs.removeOne(slab);
+        ::operator delete(slab);
+        return;
+    }
+    freeList.append(slab);
+}
+
+BufferPool::Stats BufferPool::stats() const {
+    Stats result = counters;
+    result.slabs = allSlabs.size();
+    result.free = freeList.size();
+    return result;
+}
+
+QVariantMap BufferPool::statistics() const {
+    Stats current = stats();
+    QVariantMap map;
+    map["slabSize"] = blockSize;
+    map["slabs"] = current.slabs;
+    map["free"] = current.free;
+    map["inUse"] = current.inUse;
+    map["peakInUse"] = current.peakInUse;
+    map["acquires"] = current.acquires;
+    map["allocations"] = current.allocations;
+    map["oversize"] = current.oversize;
+    return map;
+}
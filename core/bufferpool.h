@@ -0,0 +1,94 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QByteArray>
+#include <QVariantMap>
+#include <QVector>
+
+class BufferPool;
+
+// 池中的一块缓冲：头部和数据一次分配
+struct RxSlab {
+    BufferPool *pool;   // 所属的池，为空表示不回收(超长块或池已销毁)
+    int ref;
+    int size;
+    int capacity;
+
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+};
+
+// RxBuffer 池化接收缓冲的引用计数句柄
+// 拷贝只增加计数，最后一个句柄释放时缓冲回到池中；与池在同一线程内使用
+class RxBuffer {
+public:
+    RxBuffer() = default;
+    RxBuffer(const RxBuffer &other);
+    RxBuffer(RxBuffer &&other) noexcept;
+    RxBuffer &operator=(const RxBuffer &other);
+    RxBuffer &operator=(RxBuffer &&other) noexcept;
+    ~RxBuffer();
+
+    bool isNull() const { return slab == nullptr; }
+    bool isEmpty() const { return !slab || slab->size == 0; }
+    int size() const { return slab ? slab->size : 0; }
+    int capacity() const { return slab ? slab->capacity : 0; }
+
+    char *data() { return slab ? slab->data() : nullptr; }
+    const char *constData() const { return slab ? slab->data() : nullptr; }
+    char operator[](int i) const { return slab->data()[i]; }
+
+    // 设置有效长度(不超过容量)；追加数据，返回实际追加的字节数
+    void resize(int size);
+    int append(const char *bytes, int count);
+
+    // 不拷贝的只读视图，只在句柄存活期间有效，不可保存
+    QByteArray view() const { return QByteArray::fromRawData(constData(), size()); }
+    QByteArray toByteArray() const { return QByteArray(constData(), size()); }
+
+private:
+    friend class BufferPool;
+    explicit RxBuffer(RxSlab *s) : slab(s) {}
+    void release();
+
+    RxSlab *slab = nullptr;
+};
+
+// BufferPool 接收缓冲池：固定大小的块预先分配，用完放回空闲表，稳态下接收不再分配内存
+class BufferPool {
+public:
+    struct Stats {
+        qint64 slabs = 0;        // 池中块总数
+        qint64 free = 0;         // 空闲块数
+        qint64 inUse = 0;        // 被句柄持有的块数
+        qint64 peakInUse = 0;
+        qint64 acquires = 0;     // 取块次数
+        qint64 allocations = 0;  // 堆分配次数(预分配 + 池扩容 + 超长块)
+        qint64 oversize = 0;     // 超过块大小的请求
+    };
+
+    explicit BufferPool(int slabSize = 16384, int preallocate = 8, int maxFree = 64);
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // 取一块空缓冲，minCapacity 超过块大小时单独分配且不回收
+    RxBuffer acquire(int minCapacity = 0);
+
+    int slabSize() const { return blockSize; }
+    Stats stats() const;
+    QVariantMap statistics() const;
+
+private:
+    friend class RxBuffer;
+    RxSlab *allocateSlab(int capacity, BufferPool *owner);
+    void release(RxSlab *slab);
+
+    int blockSize;
+    int maxFreeSlabs;
+    QVector<RxSlab *> freeList;
+    QVector<RxSlab *> allSlabs;  // 池内全部块，析构时用于释放或脱离
+    Stats counters;
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,228 @@
+#include "chartmodel.h"
+#include "tagstore.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <limits>
+
+ChartModel::ChartModel(TagStore *store, QObject *parent)
+    : QObject(parent), store(store) {
+    rebuildTimer.setSingleShot(true);
+    rebuildTimer.setInterval(0);
+    connect(&rebuildTimer, &QTimer::timeout, this, &ChartModel::rebuild);
+
+    // TagStore 的 updated 已按 100ms 合并，新数据到达时跟随刷新
+    connect(store, &TagStore::updated, this, [this]() {
+        if (!isPaused && !chartTags.isEmpty()) {
+            scheduleRebuild();
+        }
+    });
+}
+
+void ChartModel::setTags(const QStringList &tags) {
+    if (tags == chartTags) {
+        return;
+    }
+    chartTags = tags;
+    emit tagsChanged();
+    scheduleRebuild();
+}
+
+void ChartModel::setWindowMs(qint64 ms) {
+    ms = qMax<qint64>(10, ms);
+    if (ms == window) {
+        return;
+    }
+    window = ms;
+    emit windowMsChanged();
+    scheduleRebuild();
+}
+
+void ChartModel::setColumns(int columns) {
+    columns = qBound(1, columns, 16384);
+    if (columns == columnCount) {
+        return;
+    }
+    columnCount = columns;
+    emit columnsChanged();
+    scheduleRebuild();
+}
+
+void ChartModel::setPaused(bool paused) {
+    if (paused == isPaused) {
+        return;
+    }
+    isPaused = paused;
+    emit pausedChanged();
+    if (!isPaused) {
+        scheduleRebuild();
+    }
+}
+
+QList<qreal> ChartModel::polyline(int index) const {
+    QList<qreal> flat;
+    if (index < 0 || index >= lines.size()) {
+        return flat;
+    }
+    const QVector<QPointF> &line = lines[index];
+    const double scale = 1.0 / (yMax - yMin);
+    flat.reserve(line.size() * 2);
+    for (const QPointF &point : line) {
+        flat.append(point.x());
+        flat.append((point.y() - yMin) * scale);
+    }
+    return flat;
+}
+
+void ChartModel::refresh() {
+    rebuildTimer.stop();
+    rebuild();
+}
+
+QVariantMap ChartModel::getStats() const {
+    QVariantMap map;
+    map["series"] = lines.size();
+    map["sourcePoints"] = sourcePoints;
+    map["outputPoints"] = outputPoints;
+    map["rebuildMs"] = rebuildNs / 1e6;
+    map["rebuilds"] = rebuildCount;
+    return map;
+}
+
+void ChartModel::scheduleRebuild() {
+    if (!rebuildTimer.isActive()) {
+        rebuildTimer.start();
+    }
+}
+
+void ChartModel::rebuild() {
+    QElapsedTimer timer;
+    timer.start();
+
+    // 右端对齐所选标签的最新时间，暂停时保持不动，便于查看
+    if (!isPaused) {
+        qint64 latest = 0;
+        for (const QString &tag : std::as_const(chartTags)) {
+            qint64 first, last;
+            if (store->rawRange(tag, &first, &last)) {
+                latest = qMax(latest, last);
+            }
+        }
+        end = latest > 0 ? latest : QDateTime::currentMSecsSinceEpoch();
+    }
+    const qint64 from = end - window;
+    const qint64 bucketMs = qMax<qint64>(1, window / columnCount);
+
+    lines.resize(chartTags.size());
+    sourcePoints = 0;
+    outputPoints = 0;
+    for (int i = 0; i < chartTags.size(); i++) {
+        QVector<QPointF> &line = lines[i];
+        line.clear();
+        qint64 first, last;
+        if (!store->rawRange(chartTags[i], &first, &last)) {
+            continue;
+        }
+
+        // 原始点已淘汰的部分用降采样桶，每桶在桶中心画一段 min→max；不足一列的缺口忽略
+        if (first > from + bucketMs) {
+            const QVector<TagBucket> buckets = store->buckets(chartTags[i], from, first - 1, bucketMs);
+            for (const TagBucket &bucket : buckets) {
+                const double x = qBound(0.0, double(bucket.start + bucketMs / 2 - from) / window, 1.0);
+                line.append(QPointF(x, bucket.min));
+                if (bucket.max != bucket.min) {
+                    line.append(QPointF(x, bucket.max));
+                }
+                sourcePoints += bucket.count;
+            }
+        }
+        sourcePoints += decimate(chartTags[i], qMax(from, first), end, line);
+        outputPoints += line.size();
+    }
+
+    // 纵轴包含所有曲线，上下各留 5%
+    double low = std::numeric_limits<double>::infinity();
+    double high = -std::numeric_limits<double>::infinity();
+    for (const QVector<QPointF> &line : std::as_const(lines)) {
+        for (const QPointF &point : line) {
+            low = qMin(low, point.y());
+            high = qMax(high, point.y());
+        }
+    }
+    if (low > high) {
+        yMin = 0;
+        yMax = 1;
+    } else if (low == high) {
+        const double pad = low != 0 ? std::abs(low) * 0.05 : 1.0;
+        yMin = low - pad;
+        yMax = high + pad;
+    } else {
+        const double pad = (high - low) * 0.05;
+        yMin = low - pad;
+        yMax = high + pad;
+    }
+
+    rebuildNs = timer.nsecsElapsed();
+    rebuildCount++;
+    emit changed();
+}
+
+qint64 ChartModel::decimate(const QString &tag, qint64 from, qint64 to, QVector<QPointF> &line) const {
+    // 列按整个窗口划分，与降采样部分和绘图区的像素对齐
+    const qint64 windowStart = end - window;
+    const double xScale = 1.0 / window;
+    qint64 scanned = 0;
+
+    int column = -1;
+    qint64 columnEnd = 0;  // 下一列的起始时间，列内的点只比较时间不做除法
+    qint64 firstTime = 0, minTime = 0, maxTime = 0, lastTime = 0;
+    double firstValue = 0, lowValue = 0, highValue = 0, lastValue = 0;
+
+    // 按时间顺序输出一列的首、最小/最大、尾，相同的点只输出一次
+    auto flush = [&]() {
+        const bool minFirst = minTime <= maxTime;
+        const qint64 times[4] = {firstTime, minFirst ? minTime : maxTime, minFirst ? maxTime : minTime, lastTime};
+        const double values[4] = {firstValue, minFirst ? lowValue : highValue, minFirst ? highValue : lowValue, lastValue};
+        for (int i = 0; i < 4; i++) {
+            if (i > 0 && times[i] == times[i - 1] && values[i] == values[i - 1]) {
+                continue;
+            }
+            line.append(QPointF((times[i] - windowStart) * xScale, values[i]));
+        }
+    };
+
+    store->visit(tag, from, to, [&](qint64 time, double value) {
+        scanned++;
+        if (!std::isfinite(value)) {
+            return;
+        }
+        if (column < 0 || time >= columnEnd) {
+            if (column >= 0) {
+                flush();
+            }
+            column = int(qBound<qint64>(0, (time - windowStart) * columnCount / window, columnCount - 1));
+            columnEnd = column + 1 < columnCount
+                    ? windowStart + ((column + 1) * window + columnCount - 1) / columnCount
+                    : std::numeric_limits<qint64>::max();
+            firstTime = minTime = maxTime = lastTime = time;
+            firstValue = lowValue = highValue = lastValue = value;
+            return;
+        }
+        if (value < lowValue) {
+            lowValue = value;
+            minTime = time;
+        }
+        if (value > highValue) {
+            highValue = value;
+            maxTime = time;
+        }
+        lastTime = time;
+        lastValue = value;
+    });
+    if (column >= 0) {
+        flush();
+    }
+    return scanned;
+}
@@ -0,0 +1,85 @@
+#ifndef CHARTMODEL_H
+#define CHARTMODEL_H
+
+#include <QObject>
+#include <QPointF>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+class TagStore;
+
+// ChartModel 把 TagStore 中若干标签最近 windowMs 的数据抽稀成折线，供界面 Canvas 绘制
+// 原始点按像素列做 M4 抽稀：每列只保留首/尾/最小/最大四个点，折线逐像素与全量绘制一致，
+// 每条曲线最多 4×columns 个点，与原始点数无关；原始点已淘汰的较早部分改用降采样桶的 min/max
+// 折线坐标归一化到 [0,1]，x 为窗口内的时间位置，y 按所有曲线的值域自动缩放
+class ChartModel : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QStringList tags READ tags WRITE setTags NOTIFY tagsChanged)
+    Q_PROPERTY(qint64 windowMs READ windowMs WRITE setWindowMs NOTIFY windowMsChanged)
+    Q_PROPERTY(int columns READ columns WRITE setColumns NOTIFY columnsChanged)
+    Q_PROPERTY(bool paused READ paused WRITE setPaused NOTIFY pausedChanged)
+    Q_PROPERTY(qint64 endTime READ endTime NOTIFY changed)
+    Q_PROPERTY(double minValue READ minValue NOTIFY changed)
+    Q_PROPERTY(double maxValue READ maxValue NOTIFY changed)
+
+public:
+    explicit ChartModel(TagStore *store, QObject *parent = nullptr);
+
+    QStringList tags() const { return chartTags; }
+    void setTags(const QStringList &tags);
+    qint64 windowMs() const { return window; }
+    void setWindowMs(qint64 ms);
+    // 绘图区宽度(像素)，决定抽稀的列数
+    int columns() const { return columnCount; }
+    void setColumns(int columns);
+    // 暂停时不随新数据刷新
+    bool paused() const { return isPaused; }
+    void setPaused(bool paused);
+
+    // 窗口右端时间(所选标签的最新时间)和当前纵轴范围
+    qint64 endTime() const { return end; }
+    double minValue() const { return yMin; }
+    double maxValue() const { return yMax; }
+
+    // 第 index 条曲线的折线 [x0, y0, x1, y1, ...]
+    Q_INVOKABLE QList<qreal> polyline(int index) const;
+    // 立即重新抽稀
+    Q_INVOKABLE void refresh();
+    // 统计：扫描的原始点数、输出点数和最近一次抽稀耗时
+    Q_INVOKABLE QVariantMap getStats() const;
+
+signals:
+    void tagsChanged();
+    void windowMsChanged();
+    void columnsChanged();
+    void pausedChanged();
+    // 折线已更新
+    void changed();
+
+private:
+    void scheduleRebuild();
+    void rebuild();
+    // 原始点 [from, to] 按列做 M4 抽稀，追加到 line，返回扫描的点数
+    qint64 decimate(const QString &tag, qint64 from, qint64 to, QVector<QPointF> &line) const;
+
+    TagStore *store;
+    QStringList chartTags;
+    qint64 window = 60 * 1000;
+    int columnCount = 800;
+    bool isPaused = false;
+
+    QVector<QVector<QPointF>> lines;  // x 已归一化，y 为原始值，rebuild 结束时归一化
+    qint64 end = 0;
+    double yMin = 0;
+    double yMax = 1;
+
+    QTimer rebuildTimer;  // 合并同一轮事件循环内的多次刷新请求
+    qint64 sourcePoints = 0;
+    int outputPoints = 0;
+    qint64 rebuildNs = 0;
+    qint64 rebuildCount = 0;
+};
+
+#endif // CHARTMODEL_H
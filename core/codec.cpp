@@ -0,0 +1,111 @@
+#include "codec.h"
+
+namespace Codec {
+
+// Modbus CRC16 查表
+struct ModbusCrcTable {
+    quint16 values[256];
+
+    constexpr ModbusCrcTable() : values() {
+        for (int i = 0; i < 256; i++) {
+            quint16 crc = quint16(i);
+            for (int j = 0; j < 8; j++) {
+                crc = (crc & 1) ? quint16((crc >> 1) ^ 0xA001) : quint16(crc >> 1);
+            }
+            values[i] = crc;
+        }
+    }
+};
+
+static constexpr ModbusCrcTable kModbusCrcTable;
+
+static int hexValue(QChar c) {
+    ushort u = c.unicode();
+    if (u >= '0' && u <= '9') {
+        return u - '0';
+    } else if (u >= 'a' && u <= 'f') {
+        return u - 'a' + 10;
+    } else if (u >= 'A' && u <= 'F') {
+        return u - 'A' + 10;
+    }
+    return -1;
+}
+
+QByteArray fromHexString(const QString &hexString) {
+    QByteArray result;
+    result.reserve(hexString.size() / 2 + 1);
+
+    // 逐个取非空白字符，两两组成一个字节
+    int high = -2;  // -2 表示等待高位
+    for (QChar c : hexString) {
+        if (c.isSpace()) {
+            continue;
+        }
+        int value = hexValue(c);
+        if (high == -2) {
+            high = value;
+        } else {
+            if (high >= 0 && value >= 0) {
+                result.append(char(high << 4 | value));
+            }
+            high = -2;
+        }
+    }
+
+    // 奇数长度时末位视为高位，低位补0
+    if (high >= 0) {
+        result.append(char(high << 4));
+    }
+    return result;
+}
+
+QString toHexString(const QByteArray &data) {
+    static const char digits[] = "0123456789ABCDEF";
+    if (data.isEmpty()) {
+        return QString();
+    }
+
+    QString result(data.size() * 3 - 1, QLatin1Char(' '));
+    QChar *out = result.data();
+    for (int i = 0; i < data.size(); i++) {
+        quint8 byte = quint8(data[i]);
+        out[i * 3] = QLatin1Char(digits[byte >> 4]);
+        out[i * 3 + 1] = QLatin1Char(digits[byte & 0x0F]);
+    }
+    return result;
+}
+
+QString toMixedString(const QByteArray &data) {
+    static const char digits[] = "0123456789ABCDEF";
+    QString result;
+    result.reserve(data.size() * 2);
+    for (char c : data) {
+        quint8 byte = quint8(c);
+        if (byte >= 0x20 && byte < 0x7F && byte != '\\') {
+            result.append(QLatin1Char(c));
+        } else if (byte == '\r') {
+            result.append(QLatin1String("\\r"));
+        } else if (byte == '\n') {
+            result.append(QLatin1String("\\n"));
+        } else if (byte == '\t') {
+            result.append(QLatin1String("\\t"));
+        } else if (byte == '\\') {
+            result.append(QLatin1String("\\\\"));
+        } else {
+            result.append(QLatin1String("\\x"));
+            result.append(QLatin1Char(digits[byte >> 4]));
+            result.append(QLatin1Char(digits[byte & 0x0F]));
+        }
+    }
+    return result;
+}
+
+quint16 modbusCrc16(const char *data, int size) {
+    quint16 crc = 0xFFFF;
+    for (int i = 0; i < size; i++) {
+        crc = quint16((crc >> 8) ^ kModbusCrcTable.values[(crc ^ quint8(data[i])) & 0xFF]);
+    }
+    return crc;
+}
+
+} // namespace Codec
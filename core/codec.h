@@ -0,0 +1,24 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <QByteArray>
+#include <QString>
+
+// Codec 收发数据的文本编解码
+namespace Codec {
+
+// 十六进制文本转字节，忽略空白；奇数长度末尾补0，非法字符对跳过
+QByteArray fromHexString(const QString &hexString);
+
+// 字节转大写十六进制文本，以空格分隔，如 "01 03 0A"
+QString toHexString(const QByteArray &data);
+
+// 混合显示：可打印 ASCII 原样输出，\r \n \t 转义，其余字节输出为 \xNN
+QString toMixedString(const QByteArray &data);
+
+// Modbus CRC16(多项式 0xA001，初值 0xFFFF)，帧中低字节在前
+quint16 modbusCrc16(const char *data, int size);
+
+} // namespace Codec
+
+#endif // CODEC_H
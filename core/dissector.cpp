@@ -0,0 +1,609 @@
+#include "dissector.h"
+#include "codec.h"
+
+#include <cstring>
+
+QVariantMap DissectedFrame::toVariant() const {
+    QVariantMap map;
+    map["protocol"] = protocol;
+    map["offset"] = offset;
+    map["raw"] = raw;
+    map["valid"] = valid;
+    map["summary"] = summary;
+    map["fields"] = fields;
+    return map;
+}
+
+// === Dissector ===
+
+void Dissector::feed(const char *data, int size, QVector<DissectedFrame> &frames) {
+    if (size <= 0) {
+        return;
+    }
+    buffer.append(data, size);
+
+    while (readPos < buffer.size()) {
+        const int available = buffer.size() - readPos;
+        DissectedFrame frame;
+        int n = parse(buffer.constData() + readPos, available, frame);
+        if (n == 0) {
+            if (available <= maxFrameSize) {
+                break;
+            }
+            n = -1;  // 长时间不成帧，丢弃一个字节重新同步
+        }
+        if (n < 0) {
+            int skip = qMin(-n, available);
+            readPos += skip;
+            skippedCount += skip;
+            continue;
+        }
+
+        n = qMin(n, available);
+        if (frame.protocol.isEmpty()) {
+            frame.protocol = dissectorName;
+        }
+        frame.offset = bufferStart + readPos;
+        if (frame.raw.isEmpty()) {
+            frame.raw = buffer.mid(readPos, n);
+        }
+        frameCount++;
+        byteCount += n;
+        if (!frame.valid) {
+            invalidCount++;
+        }
+        frames.append(std::move(frame));
+        readPos += n;
+    }
+
+    // 已消费的字节超过一半才前移，避免每帧都搬动缓冲
+    if (readPos >= buffer.size()) {
+        bufferStart += buffer.size();
+        buffer.resize(0);
+        readPos = 0;
+    } else if (readPos > buffer.size() / 2) {
+        buffer.remove(0, readPos);
+        bufferStart += readPos;
+        readPos = 0;
+    }
+}
+
+void Dissector::reset() {
+    bufferStart += buffer.size();
+    buffer.resize(0);
+    readPos = 0;
+}
+
+QVariantMap Dissector::statistics() const {
+    QVariantMap map;
+    map["name"] = dissectorName;
+    map["frames"] = frameCount;
+    map["invalid"] = invalidCount;
+    map["bytes"] = byteCount;
+    map["skipped"] = skippedCount;
+    map["buffered"] = buffer.size() - readPos;
+    return map;
+}
+
+int CallbackDissector::parse(const char *data, int size, DissectedFrame &frame) {
+    return parser ? parser(data, size, frame) : -size;
+}
+
+namespace {
+
+quint16 readBigEndian16(const uchar *p) {
+    return quint16(p[0] << 8 | p[1]);
+}
+
+// 摘要中的十六进制预览，过长时截断
+QString previewHex(const QByteArray &bytes) {
+    const int limit = 32;
+    QString text = Codec::toHexString(bytes.left(limit));
+    if (bytes.size() > limit) {
+        text.append(QLatin1String(" ..."));
+    }
+    return text;
+}
+
+// === Modbus ===
+
+QString modbusFunctionName(int function) {
+    switch (function) {
+    case 0x01: return "读线圈";
+    case 0x02: return "读离散输入";
+    case 0x03: return "读保持寄存器";
+    case 0x04: return "读输入寄存器";
+    case 0x05: return "写单个线圈";
+    case 0x06: return "写单个寄存器";
+    case 0x0F: return "写多个线圈";
+    case 0x10: return "写多个寄存器";
+    case 0x17: return "读写多个寄存器";
+    default: return QString("功能码0x%1").arg(QString::number(function, 16).toUpper().rightJustified(2, '0'));
+    }
+}
+
+QVariantList unpackBits(const uchar *bytes, int count) {
+    QVariantList bits;
+    bits.reserve(count);
+    for (int i = 0; i < count; i++) {
+        bits.append((bytes[i / 8] >> (i % 8)) & 1);
+    }
+    return bits;
+}
+
+QVariantList unpackRegisters(const uchar *bytes, int count) {
+    QVariantList registers;
+    registers.reserve(count);
+    for (int i = 0; i < count; i++) {
+        registers.append(readBigEndian16(bytes + i * 2));
+    }
+    return registers;
+}
+
+// 解析 Modbus PDU(从功能码开始)，request 指定按请求还是应答解释；长度与内容不符时返回 false
+bool decodeModbusPdu(const uchar *pdu, int size, bool request, QVariantMap &fields) {
+    if (size < 1) {
+        return false;
+    }
+    const int function = pdu[0];
+    fields["function"] = function & 0x7F;
+    if (function & 0x80) {
+        fields["type"] = "exception";
+        if (size != 2) {
+            return false;
+        }
+        fields["exception"] = pdu[1];
+        return true;
+    }
+    fields["type"] = request ? "request" : "response";
+
+    switch (function) {
+    case 0x01:
+    case 0x02:
+    case 0x03:
+    case 0x04:
+        if (request) {
+            if (size != 5) {
+                return false;
+            }
+            fields["start"] = readBigEndian16(pdu + 1);
+            fields["quantity"] = readBigEndian16(pdu + 3);
+            return true;
+        }
+        if (size < 2 || size != 2 + pdu[1]) {
+            return false;
+        }
+        fields["byteCount"] = pdu[1];
+        if (function <= 0x02) {
+            fields["bits"] = unpackBits(pdu + 2, pdu[1] * 8);
+        } else {
+            if (pdu[1] % 2 != 0) {
+                return false;
+            }
+            fields["registers"] = unpackRegisters(pdu + 2, pdu[1] / 2);
+        }
+        return true;
+    case 0x05:
+    case 0x06:
+        // 请求和应答格式相同
+        if (size != 5) {
+            return false;
+        }
+        fields["address"] = readBigEndian16(pdu + 1);
+        fields["value"] = readBigEndian16(pdu + 3);
+        return true;
+    case 0x0F:
+    case 0x10:
+        if (size < 5) {
+            return false;
+        }
+        fields["start"] = readBigEndian16(pdu + 1);
+        fields["quantity"] = readBigEndian16(pdu + 3);
+        if (!request) {
+            return size == 5;
+        }
+        if (size < 6 || size != 6 + pdu[5]) {
+            return false;
+        }
+        fields["byteCount"] = pdu[5];
+        if (function == 0x0F) {
+            fields["bits"] = unpackBits(pdu + 6, qMin(int(readBigEndian16(pdu + 3)), pdu[5] * 8));
+        } else {
+            fields["registers"] = unpackRegisters(pdu + 6, pdu[5] / 2);
+        }
+        return true;
+    case 0x17:
+        // 请求：读起始/数量、写起始/数量、字节数和写入值；应答同 0x03
+        if (!request) {
+            if (size < 2 || size != 2 + pdu[1] || pdu[1] % 2 != 0) {
+                return false;
+            }
+            fields["byteCount"] = pdu[1];
+            fields["registers"] = unpackRegisters(pdu + 2, pdu[1] / 2);
+            return true;
+        }
+        if (size < 10 || size != 10 + pdu[9] || pdu[9] % 2 != 0) {
+            return false;
+        }
+        fields["start"] = readBigEndian16(pdu + 1);
+        fields["quantity"] = readBigEndian16(pdu + 3);
+        fields["writeStart"] = readBigEndian16(pdu + 5);
+        fields["writeQuantity"] = readBigEndian16(pdu + 7);
+        fields["byteCount"] = pdu[9];
+        fields["registers"] = unpackRegisters(pdu + 10, pdu[9] / 2);
+        return true;
+    default:
+        fields["data"] = QByteArray(reinterpret_cast<const char *>(pdu + 1), size - 1);
+        return true;
+    }
+}
+
+QString joinValues(const QVariantList &values) {
+    const int limit = 16;
+    QStringList parts;
+    for (int i = 0; i < values.size() && i < limit; i++) {
+        parts.append(values[i].toString());
+    }
+    if (values.size() > limit) {
+        parts.append(QLatin1String("..."));
+    }
+    return parts.join(' ');
+}
+
+QString modbusSummary(const QString &prefix, int unit, const QVariantMap &fields) {
+    QString text = QString("%1 站%2 %3").arg(prefix).arg(unit).arg(modbusFunctionName(fields["function"].toInt()));
+    const QString type = fields["type"].toString();
+    if (type == "exception") {
+        return text + QString(" 异常 %1").arg(fields["exception"].toInt());
+    }
+    text += type == "request" ? " 请求" : " 应答";
+    if (fields.contains("registers")) {
+        text += " " + joinValues(fields["registers"].toList());
+    } else if (fields.contains("bits")) {
+        text += " " + joinValues(fields["bits"].toList());
+    } else if (fields.contains("address")) {
+        text += QString(" 地址 %1 值 %2").arg(fields["address"].toInt()).arg(fields["value"].toInt());
+    } else if (fields.contains("start")) {
+        text += QString(" 起始 %1 数量 %2").arg(fields["start"].toInt()).arg(fields["quantity"].toInt());
+    }
+    return text;
+}
+
+// Modbus RTU：没有帧边界，按功能码列出请求/应答两种可能的长度，以 CRC 确认
+class ModbusRtuDissector : public Dissector {
+public:
+    ModbusRtuDissector() : Dissector("modbus-rtu") {
+        maxFrameSize = 256;  // RTU 帧最大长度
+    }
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override {
+        if (size < 4) {
+            return 0;
+        }
+        const uchar *d = reinterpret_cast<const uchar *>(data);
+        const int function = d[1];
+
+        struct Candidate {
+            int length;
+            bool request;
+        };
+        Candidate candidates[2];
+        int count = 0;
+        if (function & 0x80) {
+            candidates[count++] = {5, false};
+        } else if (function >= 0x01 && function <= 0x04) {
+            candidates[count++] = {8, true};
+            candidates[count++] = {5 + d[2], false};
+        } else if (function == 0x05 || function == 0x06) {
+            candidates[count++] = {8, true};
+        } else if (function == 0x0F || function == 0x10) {
+            candidates[count++] = {8, false};
+            if (size >= 7) {
+                candidates[count++] = {9 + d[6], true};
+            } else {
+                return 0;
+            }
+        } else if (function == 0x17) {
+            // 请求长度要等到字节数(d[10])到达，之前按最短 13 字节等待
+            candidates[count++] = {5 + d[2], false};
+            candidates[count++] = {size >= 11 ? 13 + d[10] : 13, true};
+        } else {
+            return -1;
+        }
+
+        bool needMore = false;
+        for (int i = 0; i < count; i++) {
+            const int length = candidates[i].length;
+            if (length > size) {
+                needMore = true;
+                continue;
+            }
+            quint16 crc = Codec::modbusCrc16(data, length - 2);
+            if (d[length - 2] != (crc & 0xFF) || d[length - 1] != (crc >> 8)) {
+                continue;
+            }
+            frame.fields["unit"] = d[0];
+            frame.valid = decodeModbusPdu(d + 1, length - 3, candidates[i].request, frame.fields);
+            frame.summary = modbusSummary("Modbus RTU", d[0], frame.fields);
+            return length;
+        }
+        return needMore ? 0 : -1;
+    }
+};
+
+// Modbus TCP：MBAP 头(事务、协议、长度、单元)后接 PDU，默认按应答解释，requests=true 时按请求
+class ModbusTcpDissector : public Dissector {
+public:
+    ModbusTcpDissector() : Dissector("modbus-tcp") {
+        maxFrameSize = 260;
+    }
+
+    void configure(const QVariantMap &options) override {
+        requests = options.value("requests", requests).toBool();
+    }
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override {
+        if (size < 8) {
+            return 0;
+        }
+        const uchar *d = reinterpret_cast<const uchar *>(data);
+        const int length = readBigEndian16(d + 4);
+        if (readBigEndian16(d + 2) != 0 || length < 2 || length > 254) {
+            return -1;
+        }
+        if (size < 6 + length) {
+            return 0;
+        }
+        frame.fields["transaction"] = readBigEndian16(d);
+        frame.fields["unit"] = d[6];
+        frame.valid = decodeModbusPdu(d + 7, length - 1, requests, frame.fields);
+        frame.summary = modbusSummary(QString("Modbus TCP #%1").arg(readBigEndian16(d)), d[6], frame.fields);
+        return 6 + length;
+    }
+
+private:
+    bool requests = false;
+};
+
+// === 分隔符成帧 ===
+
+// SLIP(RFC 1055)：END 结束一帧，ESC 转义
+class SlipDissector : public Dissector {
+public:
+    SlipDissector() : Dissector("slip") {}
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override {
+        const uchar End = 0xC0, Esc = 0xDB, EscEnd = 0xDC, EscEsc = 0xDD;
+        const uchar *d = reinterpret_cast<const uchar *>(data);
+
+        // 帧前的 END 计入本帧
+        int start = 0;
+        while (start < size && d[start] == End) {
+            start++;
+        }
+        const void *hit = start < size ? memchr(d + start, End, size_t(size - start)) : nullptr;
+        if (!hit) {
+            return 0;
+        }
+        const int end = int(static_cast<const uchar *>(hit) - d);
+
+        QByteArray payload;
+        payload.reserve(end - start);
+        for (int i = start; i < end; i++) {
+            if (d[i] != Esc) {
+                payload.append(char(d[i]));
+            } else if (i + 1 < end && d[i + 1] == EscEnd) {
+                payload.append(char(End));
+                i++;
+            } else if (i + 1 < end && d[i + 1] == EscEsc) {
+                payload.append(char(Esc));
+                i++;
+            } else {
+                frame.valid = false;  // 非法转义，保留原字节
+                payload.append(char(d[i]));
+            }
+        }
+        frame.fields["length"] = payload.size();
+        frame.fields["payload"] = payload;
+        frame.summary = QString("SLIP %1 字节 %2").arg(payload.size()).arg(previewHex(payload));
+        return end + 1;
+    }
+};
+
+// COBS：0x00 结束一帧，帧内由长度码消除 0x00
+class CobsDissector : public Dissector {
+public:
+    CobsDissector() : Dissector("cobs") {}
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override {
+        const uchar *d = reinterpret_cast<const uchar *>(data);
+        int start = 0;
+        while (start < size && d[start] == 0) {
+            start++;
+        }
+        const void *hit = start < size ? memchr(d + start, 0, size_t(size - start)) : nullptr;
+        if (!hit) {
+            return 0;
+        }
+        const int end = int(static_cast<const uchar *>(hit) - d);
+
+        QByteArray payload;
+        payload.reserve(end - start);
+        int i = start;
+        while (i < end) {
+            const int code = d[i++];
+            if (i + code - 1 > end) {
+                frame.valid = false;  // 长度码超出帧尾
+                payload.append(reinterpret_cast<const char *>(d + i), end - i);
+                break;
+            }
+            payload.append(reinterpret_cast<const char *>(d + i), code - 1);
+            i += code - 1;
+            if (code < 0xFF && i < end) {
+                payload.append('\0');
+            }
+        }
+        frame.fields["length"] = payload.size();
+        frame.fields["payload"] = payload;
+        frame.summary = QString("COBS %1 字节 %2").arg(payload.size()).arg(previewHex(payload));
+        return end + 1;
+    }
+};
+
+// NMEA-0183：'$' 或 '!' 开头、换行结束的语句，'*' 后为异或校验
+class NmeaDissector : public Dissector {
+public:
+    NmeaDissector() : Dissector("nmea") {
+        maxFrameSize = 128;  // 标准语句不超过 82 字符
+    }
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override {
+        if (data[0] != '$' && data[0] != '!') {
+            for (int i = 1; i < size; i++) {
+                if (data[i] == '$' || data[i] == '!') {
+                    return -i;
+                }
+            }
+            return -size;
+        }
+        const void *hit = memchr(data, '\n', size_t(size));
+        if (!hit) {
+            return 0;
+        }
+        const int length = int(static_cast<const char *>(hit) - data) + 1;
+
+        int lineEnd = length - 1;
+        if (lineEnd > 0 && data[lineEnd - 1] == '\r') {
+            lineEnd--;
+        }
+        const char *star = static_cast<const char *>(memchr(data, '*', size_t(lineEnd)));
+        const int bodyEnd = star ? int(star - data) : lineEnd;
+
+        quint8 checksum = 0;
+        for (int i = 1; i < bodyEnd; i++) {
+            checksum ^= quint8(data[i]);
+        }
+        frame.fields["checksum"] = star != nullptr;
+        if (star) {
+            bool ok = false;
+            int expected = QByteArray(star + 1, lineEnd - bodyEnd - 1).toInt(&ok, 16);
+            frame.valid = ok && expected == checksum;
+        }
+
+        const QString body = QString::fromLatin1(data + 1, bodyEnd - 1);
+        const QStringList parts = body.split(',');
+        const QString address = parts.first();
+        if (address.startsWith('P')) {
+            frame.fields["talker"] = "P";
+            frame.fields["sentence"] = address.mid(1);
+        } else {
+            frame.fields["talker"] = address.left(2);
+            frame.fields["sentence"] = address.mid(2);
+        }
+        QVariantList values;
+        values.reserve(parts.size() - 1);
+        for (int i = 1; i < parts.size(); i++) {
+            values.append(parts[i]);
+        }
+        frame.fields["values"] = values;
+        frame.summary = QString("NMEA %1").arg(QString::fromLatin1(data, lineEnd));
+        return length;
+    }
+};
+
+// 长度前缀二进制帧：帧长 = lengthOffset + lengthSize + 长度值 + lengthAdjust
+class LengthPrefixedDissector : public Dissector {
+public:
+    LengthPrefixedDissector() : Dissector("length-prefixed") {}
+
+    void configure(const QVariantMap &options) override {
+        lengthOffset = qMax(0, options.value("lengthOffset", lengthOffset).toInt());
+        lengthSize = options.value("lengthSize", lengthSize).toInt();
+        if (lengthSize != 1 && lengthSize != 2 && lengthSize != 4) {
+            lengthSize = 2;
+        }
+        bigEndian = options.value("bigEndian", bigEndian).toBool();
+        lengthAdjust = options.value("lengthAdjust", lengthAdjust).toInt();
+        maxFrameSize = qMax(16, options.value("maxLength", maxFrameSize).toInt());
+    }
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override {
+        const int header = lengthOffset + lengthSize;
+        if (size < header) {
+            return 0;
+        }
+        const uchar *p = reinterpret_cast<const uchar *>(data + lengthOffset);
+        qint64 value = 0;
+        for (int i = 0; i < lengthSize; i++) {
+            int shift = bigEndian ? (lengthSize - 1 - i) * 8 : i * 8;
+            value |= qint64(p[i]) << shift;
+        }
+        const qint64 total = header + value + lengthAdjust;
+        if (total < header || total > maxFrameSize) {
+            return -1;
+        }
+        if (size < total) {
+            return 0;
+        }
+        const QByteArray payload(data + header, int(total - header));
+        frame.fields["length"] = value;
+        frame.fields["payload"] = payload;
+        frame.summary = QString("LEN %1 字节 %2").arg(payload.size()).arg(previewHex(payload));
+        return int(total);
+    }
+
+private:
+    int lengthOffset = 0;
+    int lengthSize = 2;
+    bool bigEndian = true;
+    int lengthAdjust = 0;
+};
+
+template <typename T>
+DissectorRegistry::Factory factoryFor() {
+    return []() { return std::unique_ptr<Dissector>(new T); };
+}
+
+} // namespace
+
+// === DissectorRegistry ===
+
+QHash<QString, DissectorRegistry::Factory> &DissectorRegistry::factories() {
+    static QHash<QString, Factory> registry = {
+        {"modbus-rtu", factoryFor<ModbusRtuDissector>()},
+        {"modbus-tcp", factoryFor<ModbusTcpDissector>()},
+        {"slip", factoryFor<SlipDissector>()},
+        {"cobs", factoryFor<CobsDissector>()},
+        {"nmea", factoryFor<NmeaDissector>()},
+        {"length-prefixed", factoryFor<LengthPrefixedDissector>()},
+    };
+    return registry;
+}
+
+void DissectorRegistry::add(const QString &name, Factory factory) {
+    factories().insert(name, std::move(factory));
+}
+
+bool DissectorRegistry::contains(const QString &name) {
+    return factories().contains(name);
+}
+
+QStringList DissectorRegistry::names() {
+    QStringList list = factories().keys();
+    list.sort();
+    return list;
+}
+
+std::unique_ptr<Dissector> DissectorRegistry::create(const QString &name) {
+    auto it = factories().constFind(name);
+    if (it == factories().constEnd()) {
+        return nullptr;
+    }
+    return it.value()();
+}
@@ -0,0 +1,97 @@
+#ifndef DISSECTOR_H
+#define DISSECTOR_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+// 一帧解析结果：协议名、帧在接收流中的偏移、原始字节、校验结果、摘要和结构化字段
+struct DissectedFrame {
+    QString protocol;
+    qint64 offset = 0;
+    QByteArray raw;
+    bool valid = true;     // 校验和/CRC 通过
+    QString summary;       // 单行显示文本
+    QVariantMap fields;
+
+    // 转为 {protocol=, offset=, raw=, valid=, summary=, fields={...}}，供界面和 Lua 使用
+    QVariantMap toVariant() const;
+};
+
+// Dissector 流式协议解析器
+// 接收数据追加到解析器内部的缓冲，从读位置起反复调用 parse 切出完整帧，已消费的字节累积到一半才整体前移
+// 子类只实现 parse：返回 >0 为一帧的字节数，0 为需要更多数据，<0 为跳过 -n 个无法识别的字节
+class Dissector {
+public:
+    explicit Dissector(const QString &name) : dissectorName(name) {}
+    virtual ~Dissector() = default;
+
+    Dissector(const Dissector &) = delete;
+    Dissector &operator=(const Dissector &) = delete;
+
+    QString name() const { return dissectorName; }
+    // 解析参数，各解析器自行解释，未知键忽略
+    virtual void configure(const QVariantMap &options) { Q_UNUSED(options); }
+
+    // 输入新数据，解析出的帧追加到 frames
+    void feed(const char *data, int size, QVector<DissectedFrame> &frames);
+    void reset();
+
+    // 帧数、校验失败帧数、解析字节数和跳过的字节数
+    QVariantMap statistics() const;
+
+protected:
+    virtual int parse(const char *data, int size, DissectedFrame &frame) = 0;
+
+    // 等待中的数据超过该长度仍不成帧时丢弃一个字节重新同步
+    int maxFrameSize = 4096;
+
+private:
+    QString dissectorName;
+    QByteArray buffer;
+    int readPos = 0;          // buffer 中尚未解析的起点
+    qint64 bufferStart = 0;   // buffer[0] 在接收流中的偏移
+
+    qint64 frameCount = 0;
+    qint64 invalidCount = 0;
+    qint64 byteCount = 0;
+    qint64 skippedCount = 0;
+};
+
+// 由回调完成 parse 的解析器，用于脚本定义的协议
+class CallbackDissector : public Dissector {
+public:
+    using Parser = std::function<int(const char *data, int size, DissectedFrame &frame)>;
+
+    CallbackDissector(const QString &name, Parser parser) : Dissector(name), parser(std::move(parser)) {}
+
+protected:
+    int parse(const char *data, int size, DissectedFrame &frame) override;
+
+private:
+    Parser parser;
+};
+
+// DissectorRegistry 按名称创建解析器
+// 内置 modbus-rtu、modbus-tcp、slip、cobs、nmea、length-prefixed，其他解析器可通过 add 注册
+class DissectorRegistry {
+public:
+    using Factory = std::function<std::unique_ptr<Dissector>()>;
+
+    static void add(const QString &name, Factory factory);
+    static bool contains(const QString &name);
+    static QStringList names();
+    // 名称不存在时返回空指针
+    static std::unique_ptr<Dissector> create(const QString &name);
+
+private:
+    static QHash<QString, Factory> &factories();
+};
+
+#endif // DISSECTOR_H
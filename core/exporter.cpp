@@ -0,0 +1,526 @@
+#include "exporter.h"
+#include "tagstore.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QLocale>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtEndian>
+
+#include <limits>
+
+static const int kQueueLimit = 4;           // 队列中最多等待的批次
+static const int kBufferSize = 1 << 20;     // 攒够后整块写出
+static const int kRowGroupRows = 65536;     // 列式格式每个行组的行数
+static const int kRowGroupBytes = 4 << 20;  // 行组中报文数据超过它也结束行组，限制长报文时的内存
+static const int kBatchRows = 8192;         // 录制和标签导出每批的行数
+
+static const char kColumnarMagic[8] = {'M', 'J', 'C', 'O', 'L', '1', '\n', '\0'};
+static const char kColumnarEnd[8] = {'M', 'J', 'C', 'O', 'L', 'E', 'N', 'D'};
+
+// 列式格式的列类型
+enum ColumnType : quint8 {
+    TimeColumn = 1,
+    NameColumn = 2,
+    BytesColumn = 3,
+    DoubleColumn = 4
+};
+
+template <typename T>
+static void appendLittleEndian(QByteArray &out, T value) {
+    const T le = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&le), sizeof(le));
+}
+
+static void appendVarint(QByteArray &out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static quint64 zigzag(qint64 value) {
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+// 大写十六进制，以空格分隔，与 Codec::toHexString 相同
+static void appendHex(QByteArray &out, const QByteArray &data) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (int i = 0; i < data.size(); i++) {
+        const uchar byte = uchar(data[i]);
+        if (i > 0) {
+            out.append(' ');
+        }
+        out.append(digits[byte >> 4]);
+        out.append(digits[byte & 0x0F]);
+    }
+}
+
+// CSV 字段：含逗号、引号或换行时加引号，引号加倍
+static void appendCsvField(QByteArray &out, const QString &text) {
+    const QByteArray utf8 = text.toUtf8();
+    if (!utf8.contains(',') && !utf8.contains('"') && !utf8.contains('\n') && !utf8.contains('\r')) {
+        out.append(utf8);
+        return;
+    }
+    out.append('"');
+    for (char c : utf8) {
+        if (c == '"') {
+            out.append('"');
+        }
+        out.append(c);
+    }
+    out.append('"');
+}
+
+// === ExportWriter ===
+
+ExportWriter::ExportWriter() = default;
+
+ExportWriter::~ExportWriter() {
+    close();
+}
+
+bool ExportWriter::formatFromString(const QString &name, Format *format) {
+    const QString lower = name.toLower();
+    if (lower.isEmpty() || lower == "csv") {
+        *format = Csv;
+        return true;
+    }
+    if (lower == "columnar" || lower == "mjcol") {
+        *format = Columnar;
+        return true;
+    }
+    return false;
+}
+
+bool ExportWriter::open(const QString &filePath, Format format, Kind kind) {
+    if (thread) {
+        QMutexLocker locker(&mutex);
+        lastError = "正在写入 " + file.fileName();
+        return false;
+    }
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        QMutexLocker locker(&mutex);
+        lastError = file.errorString();
+        return false;
+    }
+
+    this->format = format;
+    this->kind = kind;
+    queue.clear();
+    closing = false;
+    lastError.clear();
+    buffer.clear();
+    buffer.reserve(kBufferSize + 64 * 1024);
+    fileOffset = 0;
+    rowGroup.clear();
+    rowGroupBytes = 0;
+    rowGroups.clear();
+    csvSecond = -1;
+    failed = false;
+    rowCount = 0;
+    byteCount = 0;
+
+    writeHeader();
+    thread.reset(QThread::create([this]() { run(); }));
+    thread->start();
+    return true;
+}
+
+void ExportWriter::push(ExportBatch &&batch) {
+    if (!thread || batch.size() == 0) {
+        return;
+    }
+    QMutexLocker locker(&mutex);
+    while (queue.size() >= kQueueLimit) {
+        notFull.wait(&mutex);
+    }
+    queue.append(std::move(batch));
+    notEmpty.wakeOne();
+}
+
+bool ExportWriter::close() {
+    if (!thread) {
+        return false;
+    }
+    {
+        QMutexLocker locker(&mutex);
+        closing = true;
+        notEmpty.wakeAll();
+    }
+    thread->wait();
+    thread.reset();
+    file.close();
+    buffer.clear();
+    buffer.squeeze();
+    rowGroup.clear();
+    rowGroups.clear();
+    return !failed;
+}
+
+QString ExportWriter::errorString() const {
+    QMutexLocker locker(&mutex);
+    return lastError;
+}
+
+void ExportWriter::run() {
+    for (;;) {
+        ExportBatch batch;
+        {
+            QMutexLocker locker(&mutex);
+            while (queue.isEmpty() && !closing) {
+                notEmpty.wait(&mutex);
+            }
+            if (queue.isEmpty()) {
+                break;  // 已关闭且队列取完
+            }
+            batch = std::move(queue.first());
+            queue.removeFirst();
+            notFull.wakeAll();
+        }
+        // 写失败后仍取走批次，保证 push 不会一直等待
+        if (!failed) {
+            encode(batch);
+        }
+    }
+    if (!failed && format == Columnar) {
+        flushRowGroup();
+        writeFooter();
+    }
+    writeBuffer(true);
+}
+
+void ExportWriter::encode(const ExportBatch &batch) {
+    if (format == Csv) {
+        encodeCsv(batch);
+    } else {
+        appendColumnar(batch);
+    }
+    rowCount += batch.size();
+}
+
+void ExportWriter::writeHeader() {
+    if (format == Csv) {
+        buffer.append(kind == Traffic ? "timestamp_ms,time,direction,length,hex\n"
+                                      : "timestamp_ms,time,tag,value\n");
+        return;
+    }
+    const QByteArray names[3] = {"time", kind == Traffic ? "direction" : "tag", kind == Traffic ? "data" : "value"};
+    const quint8 types[3] = {TimeColumn, NameColumn, kind == Traffic ? BytesColumn : DoubleColumn};
+    buffer.append(kColumnarMagic, sizeof(kColumnarMagic));
+    buffer.append(char(kind));
+    buffer.append(char(3));
+    for (int i = 0; i < 3; i++) {
+        buffer.append(char(types[i]));
+        buffer.append(char(names[i].size()));
+        buffer.append(names[i]);
+    }
+}
+
+void ExportWriter::encodeCsv(const ExportBatch &batch) {
+    for (int i = 0; i < batch.size(); i++) {
+        const qint64 time = batch.times[i];
+        qint64 second = time / 1000;
+        int millis = int(time % 1000);
+        if (millis < 0) {
+            second--;
+            millis += 1000;
+        }
+        if (second != csvSecond) {
+            csvSecond = second;
+            csvSecondText = QDateTime::fromSecsSinceEpoch(second).toString("yyyy-MM-dd hh:mm:ss").toLatin1();
+        }
+
+        buffer.append(QByteArray::number(time));
+        buffer.append(',');
+        buffer.append(csvSecondText);
+        buffer.append('.');
+        buffer.append(char('0' + millis / 100));
+        buffer.append(char('0' + millis / 10 % 10));
+        buffer.append(char('0' + millis % 10));
+        buffer.append(',');
+        appendCsvField(buffer, batch.names[i]);
+        buffer.append(',');
+        if (kind == Traffic) {
+            buffer.append(QByteArray::number(batch.data[i].size()));
+            buffer.append(',');
+            appendHex(buffer, batch.data[i]);
+        } else {
+            buffer.append(QByteArray::number(batch.values[i], 'g', QLocale::FloatingPointShortest));
+        }
+        buffer.append('\n');
+
+        if (buffer.size() >= kBufferSize) {
+            writeBuffer(false);
+        }
+    }
+}
+
+void ExportWriter::appendColumnar(const ExportBatch &batch) {
+    for (int i = 0; i < batch.size(); i++) {
+        rowGroup.times.append(batch.times[i]);
+        rowGroup.names.append(batch.names[i]);
+        if (kind == Traffic) {
+            rowGroup.data.append(batch.data[i]);
+            rowGroupBytes += batch.data[i].size();
+        } else {
+            rowGroup.values.append(batch.values[i]);
+        }
+        if (rowGroup.size() >= kRowGroupRows || rowGroupBytes >= kRowGroupBytes) {
+            flushRowGroup();
+        }
+    }
+}
+
+void ExportWriter::flushRowGroup() {
+    const int rows = rowGroup.size();
+    if (rows == 0) {
+        return;
+    }
+
+    RowGroupInfo info;
+    info.offset = fileOffset + buffer.size();
+    info.rows = rows;
+    info.minTime = std::numeric_limits<qint64>::max();
+    info.maxTime = std::numeric_limits<qint64>::min();
+    appendVarint(buffer, quint64(rows));
+
+    QByteArray column;
+    auto appendColumn = [this, &column]() {
+        appendVarint(buffer, quint64(column.size()));
+        buffer.append(column);
+        column.clear();
+    };
+
+    qint64 previous = 0;
+    for (qint64 time : std::as_const(rowGroup.times)) {
+        appendVarint(column, zigzag(time - previous));
+        previous = time;
+        info.minTime = qMin(info.minTime, time);
+        info.maxTime = qMax(info.maxTime, time);
+    }
+    appendColumn();
+
+    // 方向和标签名重复度高，按行组建字典
+    QHash<QString, int> dictionary;
+    QByteArray indices;
+    QByteArray entries;
+    for (const QString &name : std::as_const(rowGroup.names)) {
+        auto it = dictionary.constFind(name);
+        if (it == dictionary.constEnd()) {
+            it = dictionary.insert(name, dictionary.size());
+            const QByteArray utf8 = name.toUtf8();
+            appendVarint(entries, quint64(utf8.size()));
+            entries.append(utf8);
+        }
+        appendVarint(indices, quint64(it.value()));
+    }
+    appendVarint(column, quint64(dictionary.size()));
+    column.append(entries);
+    column.append(indices);
+    appendColumn();
+
+    if (kind == Traffic) {
+        // 长度在前、数据在后，数据直接追加到 buffer，不经过 column 再拷贝一次
+        for (const QByteArray &data : std::as_const(rowGroup.data)) {
+            appendVarint(column, quint64(data.size()));
+        }
+        appendVarint(buffer, quint64(column.size() + rowGroupBytes));
+        buffer.append(column);
+        column.clear();
+        for (const QByteArray &data : std::as_const(rowGroup.data)) {
+            buffer.append(data);
+        }
+    } else {
+        column.reserve(rows * int(sizeof(double)));
+        for (double value : std::as_const(rowGroup.values)) {
+            appendLittleEndian(column, value);
+        }
+        appendColumn();
+    }
+
+    rowGroups.append(info);
+    rowGroup.clear();
+    rowGroupBytes = 0;
+    writeBuffer(false);
+}
+
+void ExportWriter::writeFooter() {
+    const qint64 start = buffer.size();
+    qint64 totalRows = 0;
+    for (const RowGroupInfo &info : std::as_const(rowGroups)) {
+        appendLittleEndian(buffer, quint64(info.offset));
+        appendLittleEndian(buffer, quint32(info.rows));
+        appendLittleEndian(buffer, qint64(info.minTime));
+        appendLittleEndian(buffer, qint64(info.maxTime));
+        totalRows += info.rows;
+    }
+    appendLittleEndian(buffer, quint32(rowGroups.size()));
+    appendLittleEndian(buffer, quint64(totalRows));
+    appendLittleEndian(buffer, quint32(buffer.size() - start));
+    buffer.append(kColumnarEnd, sizeof(kColumnarEnd));
+}
+
+void ExportWriter::writeBuffer(bool force) {
+    if (buffer.isEmpty() || (!force && buffer.size() < kBufferSize) || failed) {
+        return;
+    }
+    const qint64 written = file.write(buffer);
+    if (written != buffer.size()) {
+        fail(file.errorString());
+        return;
+    }
+    fileOffset += written;
+    byteCount += written;
+    buffer.resize(0);  // 保留容量
+}
+
+void ExportWriter::fail(const QString &message) {
+    failed = true;
+    QMutexLocker locker(&mutex);
+    lastError = message;
+}
+
+// === Exporter ===
+
+Exporter::Exporter(QObject *parent) : QObject(parent) {
+    captureTimer.setInterval(200);
+    connect(&captureTimer, &QTimer::timeout, this, &Exporter::flushCapture);
+    exportTimer.setInterval(0);
+    connect(&exportTimer, &QTimer::timeout, this, &Exporter::exportNextTag);
+}
+
+Exporter::~Exporter() {
+    stopCapture();
+    if (isExporting()) {
+        exportTimer.stop();
+        tagWriter.close();
+    }
+}
+
+bool Exporter::startCapture(const QString &filePath, ExportWriter::Format format) {
+    if (!captureWriter.open(filePath, format, ExportWriter::Traffic)) {
+        lastError = captureWriter.errorString();
+        return false;
+    }
+    captureBatch.clear();
+    captureTimer.start();
+    return true;
+}
+
+void Exporter::appendTraffic(const QString &direction, const QByteArray &data, qint64 timestamp) {
+    if (!captureWriter.isOpen()) {
+        return;
+    }
+    captureBatch.times.append(timestamp);
+    captureBatch.names.append(direction);
+    captureBatch.data.append(data);
+    if (captureBatch.size() >= kBatchRows) {
+        flushCapture();
+    }
+}
+
+void Exporter::flushCapture() {
+    if (captureBatch.size() == 0) {
+        return;
+    }
+    captureWriter.push(std::move(captureBatch));
+    captureBatch = ExportBatch();
+}
+
+bool Exporter::stopCapture() {
+    if (!captureWriter.isOpen()) {
+        return false;
+    }
+    flushCapture();
+    captureTimer.stop();
+    if (!captureWriter.close()) {
+        lastError = captureWriter.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool Exporter::exportTags(TagStore *store, const QString &filePath, ExportWriter::Format format,
+                          const QStringList &tags, qint64 from, qint64 to) {
+    if (!store) {
+        return false;
+    }
+    if (!tagWriter.open(filePath, format, ExportWriter::Tags)) {
+        lastError = tagWriter.errorString();
+        return false;
+    }
+    tagStore = store;
+    pendingTags = tags.isEmpty() ? store->tags() : tags;
+    totalTags = pendingTags.size();
+    exportedTags = 0;
+    exportFrom = from;
+    exportTo = to > 0 ? to : std::numeric_limits<qint64>::max();
+    exportTimer.start();
+    return true;
+}
+
+void Exporter::cancelExport() {
+    if (isExporting()) {
+        pendingTags.clear();
+        finishExport(false, "导出已取消");
+    }
+}
+
+// 每个周期导出一个标签；push 在写线程落后时等待，界面线程最多停顿一个队列的写入时间
+void Exporter::exportNextTag() {
+    if (pendingTags.isEmpty()) {
+        finishExport(true, QString());
+        return;
+    }
+
+    const QString tag = pendingTags.takeFirst();
+    ExportBatch batch;
+    tagStore->visit(tag, exportFrom, exportTo, [&](qint64 time, double value) {
+        batch.times.append(time);
+        batch.names.append(tag);
+        batch.values.append(value);
+        if (batch.size() >= kBatchRows) {
+            tagWriter.push(std::move(batch));
+            batch = ExportBatch();
+        }
+    });
+    tagWriter.push(std::move(batch));
+    exportedTags++;
+    emit progress(tagWriter.rows(), tagWriter.bytes());
+}
+
+void Exporter::finishExport(bool success, const QString &message) {
+    exportTimer.stop();
+    const QString filePath = tagWriter.filePath();
+    const bool written = tagWriter.close();
+    emit progress(tagWriter.rows(), tagWriter.bytes());
+    if (!written) {
+        lastError = tagWriter.errorString();
+        emit finished(false, "导出失败: " + lastError);
+    } else if (!success) {
+        emit finished(false, message);
+    } else {
+        emit finished(true, QString("已导出 %1 个标签 %2 行到 %3")
+                                .arg(exportedTags).arg(tagWriter.rows()).arg(filePath));
+    }
+}
+
+QVariantMap Exporter::statistics() const {
+    QVariantMap map;
+    map["capturing"] = isCapturing();
+    map["captureFile"] = captureWriter.filePath();
+    map["captureRows"] = captureWriter.rows();
+    map["captureBytes"] = captureWriter.bytes();
+    map["exporting"] = isExporting();
+    map["exportFile"] = tagWriter.filePath();
+    map["exportRows"] = tagWriter.rows();
+    map["exportBytes"] = tagWriter.bytes();
+    map["exportedTags"] = exportedTags;
+    map["totalTags"] = totalTags;
+    return map;
+}
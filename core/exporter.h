@@ -0,0 +1,172 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+class TagStore;
+
+// 一批待写入的行，按列存放；收发记录用 times/names/data，标签历史用 times/names/values
+struct ExportBatch {
+    QVector<qint64> times;      // 毫秒时间戳
+    QVector<QString> names;     // 方向("rx"/"tx")或标签名
+    QVector<QByteArray> data;   // 收发记录的原始字节
+    QVector<double> values;     // 标签值
+
+    int size() const { return times.size(); }
+    void clear() { times.clear(); names.clear(); data.clear(); values.clear(); }
+};
+
+// ExportWriter 在后台线程把批次编码后写入文件
+// 调用方 push 批次进入有界队列，队列满时等待写线程，内存与导出的数据量无关；
+// 编码结果先攒到 1MB 的缓冲再整块写出
+//
+// CSV：收发记录 timestamp_ms,time,direction,length,hex；标签历史 timestamp_ms,time,tag,value
+// 列式(.mjcol)：类似 Parquet 的行组 + 文件尾索引，所有整数为小端
+//   文件头  "MJCOL1\n\0"，u8 类型(0=收发记录 1=标签)，u8 列数，每列 u8 列类型 + u8 名称长度 + 名称
+//   行组    varint 行数，每列 varint 字节数 + 列数据；最多 65536 行或约 4 MB 报文数据
+//           时间列：与前一行的差值，zigzag varint(行组第一行相对 0)
+//           名称列：字典编码，varint 字典大小 + 各项(varint 长度 + UTF-8)，再每行 varint 下标
+//           字节列：每行 varint 长度，随后全部字节首尾相接
+//           数值列：每行 8 字节 double
+//   文件尾  每个行组 u64 偏移 + u32 行数 + i64 最小时间 + i64 最大时间，
+//           随后 u32 行组数、u64 总行数、u32 文件尾长度、"MJCOLEND"
+class ExportWriter {
+public:
+    enum Format {
+        Csv,
+        Columnar
+    };
+
+    enum Kind {
+        Traffic,  // 收发记录
+        Tags      // 标签历史
+    };
+
+    ExportWriter();
+    ~ExportWriter();
+
+    ExportWriter(const ExportWriter &) = delete;
+    ExportWriter &operator=(const ExportWriter &) = delete;
+
+    // 打开文件并启动写线程，失败时返回 false 并通过 errorString() 说明原因
+    bool open(const QString &filePath, Format format, Kind kind);
+    // 交给写线程，队列满时阻塞到写线程取走一批
+    void push(ExportBatch &&batch);
+    // 写完队列中的批次和文件尾后关闭，阻塞到写线程结束；返回是否全部写入成功
+    bool close();
+    bool isOpen() const { return thread != nullptr; }
+
+    QString filePath() const { return file.fileName(); }
+    QString errorString() const;
+    qint64 rows() const { return rowCount.load(); }
+    qint64 bytes() const { return byteCount.load(); }
+
+    static bool formatFromString(const QString &name, Format *format);
+
+private:
+    void run();
+    void encode(const ExportBatch &batch);
+    void encodeCsv(const ExportBatch &batch);
+    void appendColumnar(const ExportBatch &batch);
+    void flushRowGroup();
+    void writeHeader();
+    void writeFooter();
+    void writeBuffer(bool force);
+    void fail(const QString &message);
+
+    QFile file;
+    Format format = Csv;
+    Kind kind = Traffic;
+    std::unique_ptr<QThread> thread;
+
+    // 写线程和调用方共享，由 mutex 保护
+    mutable QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QVector<ExportBatch> queue;
+    bool closing = false;
+    QString lastError;
+
+    // 以下只在写线程中使用
+    QByteArray buffer;            // 待写出的编码结果
+    qint64 fileOffset = 0;
+    ExportBatch rowGroup;         // 列式格式累积中的行组
+    qint64 rowGroupBytes = 0;     // 行组中报文数据的字节数
+    struct RowGroupInfo {
+        qint64 offset;
+        int rows;
+        qint64 minTime;
+        qint64 maxTime;
+    };
+    QVector<RowGroupInfo> rowGroups;
+    qint64 csvSecond = -1;        // CSV 时间文本按秒缓存
+    QByteArray csvSecondText;
+    bool failed = false;
+
+    std::atomic<qint64> rowCount{0};
+    std::atomic<qint64> byteCount{0};
+};
+
+// Exporter 导出收发记录和标签历史
+// 录制：startCapture 之后 appendTraffic 的每条记录按批交给写线程，直到 stopCapture
+// 标签：按标签逐个在事件循环中读取 TagStore，每个定时器周期处理一个标签，避免长时间占用界面线程
+class Exporter : public QObject {
+    Q_OBJECT
+
+public:
+    explicit Exporter(QObject *parent = nullptr);
+    ~Exporter();
+
+    bool startCapture(const QString &filePath, ExportWriter::Format format);
+    // direction 为 "rx" 或 "tx"
+    void appendTraffic(const QString &direction, const QByteArray &data, qint64 timestamp);
+    bool stopCapture();
+    bool isCapturing() const { return captureWriter.isOpen(); }
+
+    // tags 为空时导出全部标签；to 为 0 时不限结束时间
+    bool exportTags(TagStore *store, const QString &filePath, ExportWriter::Format format,
+                    const QStringList &tags, qint64 from, qint64 to);
+    void cancelExport();
+    bool isExporting() const { return tagWriter.isOpen(); }
+
+    QString errorString() const { return lastError; }
+    // 统计：录制文件、行数和字节数，标签导出文件、进度
+    QVariantMap statistics() const;
+
+signals:
+    void progress(qint64 rows, qint64 bytes);
+    void finished(bool success, const QString &message);
+
+private:
+    void flushCapture();
+    void exportNextTag();
+    void finishExport(bool success, const QString &message);
+
+    ExportWriter captureWriter;
+    ExportBatch captureBatch;
+    QTimer captureTimer;       // 不足一批的录制数据定时交给写线程
+
+    ExportWriter tagWriter;
+    TagStore *tagStore = nullptr;
+    QStringList pendingTags;
+    int exportedTags = 0;
+    int totalTags = 0;
+    qint64 exportFrom = 0;
+    qint64 exportTo = 0;
+    QTimer exportTimer;
+    QString lastError;
+};
+
+#endif // EXPORTER_H
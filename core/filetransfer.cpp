@@ -0,0 +1,363 @@
+#include "filetransfer.h"
+
+#include <QFileInfo>
+#include <QIODevice>
+#include <cstring>
+
+namespace {
+
+const char SOH = 0x01;
+const char STX = 0x02;
+const char EOT = 0x04;
+const char ACK = 0x06;
+const char NAK = 0x15;
+const char CAN = 0x18;
+const char SUB = 0x1A;
+const char CRC_REQUEST = 'C';
+
+const qint64 kRawChunkSize = 16 * 1024;   // 原始流单次写入大小
+const qint64 kRawHighWater = 64 * 1024;   // 设备写缓冲高水位，超过则等待 bytesWritten
+const int kStartTimeoutMs = 60000;        // 等待接收方启动
+const int kBlockTimeoutMs = 10000;        // 等待块确认
+const int kMaxRetries = 10;
+
+// CRC-16/XMODEM (多项式 0x1021，初值 0) 查表
+struct Crc16Table {
+    quint16 values[256];
+
+    constexpr Crc16Table() : values() {
+        for (int i = 0; i < 256; i++) {
+            quint16 crc = quint16(i << 8);
+            for (int j = 0; j < 8; j++) {
+                crc = (crc & 0x8000) ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+            }
+            values[i] = crc;
+        }
+    }
+};
+
+constexpr Crc16Table kCrc16Table;
+
+} // namespace
+
+FileTransfer::FileTransfer(QObject *parent) : QObject(parent) {
+    timeoutTimer.setSingleShot(true);
+    connect(&timeoutTimer, &QTimer::timeout, this, &FileTransfer::onTimeout);
+}
+
+FileTransfer::~FileTransfer() {
+    if (mapped) {
+        file.unmap(mapped);
+    }
+}
+
+quint16 FileTransfer::crc16(const char *data, qint64 size) {
+    quint16 crc = 0;
+    for (qint64 i = 0; i < size; i++) {
+        crc = quint16((crc << 8) ^ kCrc16Table.values[((crc >> 8) ^ quint8(data[i])) & 0xFF]);
+    }
+    return crc;
+}
+
+FileTransfer::Protocol FileTransfer::protocolFromString(const QString &name) {
+    const QString lower = name.toLower();
+    if (lower.startsWith("xmodem")) {
+        return XModem1K;
+    }
+    if (lower.startsWith("ymodem")) {
+        return YModem;
+    }
+    return Raw;
+}
+
+bool FileTransfer::start(QIODevice *dev, const QString &filePath, Protocol proto) {
+    if (isActive()) {
+        lastError = "已有文件正在发送";
+        return false;
+    }
+    if (!dev || !dev->isOpen()) {
+        lastError = "传输设备未打开";
+        return false;
+    }
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        lastError = "无法打开文件: " + file.errorString();
+        return false;
+    }
+
+    fileSize = file.size();
+    if (fileSize > 0) {
+        mapped = file.map(0, fileSize);
+        if (!mapped) {
+            lastError = "文件映射失败: " + file.errorString();
+            file.close();
+            return false;
+        }
+    }
+
+    device = dev;
+    protocol = proto;
+    offset = 0;
+    pendingOffset = 0;
+    blockNumber = 1;
+    retries = 0;
+    cancelCount = 0;
+    headerSent = (protocol != YModem);
+    lastError.clear();
+    connect(device, &QIODevice::bytesWritten, this, &FileTransfer::onBytesWritten);
+
+    emit progress(0, fileSize);
+
+    if (protocol == Raw) {
+        state = RawStreaming;
+        writeRawChunks();
+    } else {
+        // XMODEM/YMODEM 由接收方发 'C' 启动
+        state = WaitStart;
+        timeoutTimer.start(kStartTimeoutMs);
+    }
+    return true;
+}
+
+void FileTransfer::cancel() {
+    if (!isActive()) {
+        return;
+    }
+    if (protocol != Raw && device) {
+        device->write(QByteArray(3, CAN));
+    }
+    finish(false, "文件发送已取消");
+}
+
+bool FileTransfer::handleIncoming(const QByteArray &data) {
+    if (state == Idle || state == RawStreaming) {
+        return false;
+    }
+
+    for (char byte : data) {
+        if (state == Idle) {
+            break;
+        }
+
+        // 连续两个 CAN 表示接收方取消
+        if (byte == CAN) {
+            if (++cancelCount >= 2) {
+                finish(false, "接收方取消了传输");
+            }
+            continue;
+        }
+        cancelCount = 0;
+
+        switch (state) {
+        case WaitStart:
+            if (byte == CRC_REQUEST) {
+                timeoutTimer.stop();
+                if (!headerSent) {
+                    sendHeaderBlock(false);
+                } else {
+                    sendNextBlock();
+                }
+            }
+            break;
+        case WaitBlockAck:
+            if (byte == ACK) {
+                if (!headerSent) {
+                    // YMODEM 块0 确认后，接收方会再发一次 'C' 请求数据
+                    headerSent = true;
+                    state = WaitStart;
+                    timeoutTimer.start(kBlockTimeoutMs);
+                } else {
+                    offset = pendingOffset;
+                    blockNumber++;
+                    emit progress(offset, fileSize);
+                    sendNextBlock();
+                }
+            } else if (byte == NAK) {
+                resendBlock();
+            }
+            break;
+        case WaitEotAck:
+            if (byte == ACK) {
+                if (protocol == YModem) {
+                    state = WaitBatchStart;
+                    timeoutTimer.start(kBlockTimeoutMs);
+                } else {
+                    finish(true, "文件发送完成");
+                }
+            } else if (byte == NAK) {
+                // 多数接收方会先 NAK 第一个 EOT
+                sendEot();
+            }
+            break;
+        case WaitBatchStart:
+            if (byte == CRC_REQUEST) {
+                sendHeaderBlock(true);
+            }
+            break;
+        case WaitBatchEndAck:
+            if (byte == ACK) {
+                finish(true, "文件发送完成");
+            } else if (byte == NAK) {
+                resendBlock();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+void FileTransfer::onBytesWritten(qint64 bytes) {
+    Q_UNUSED(bytes);
+    if (state == RawStreaming) {
+        writeRawChunks();
+    }
+}
+
+void FileTransfer::onTimeout() {
+    switch (state) {
+    case WaitStart:
+    case WaitBatchStart:
+        finish(false, "等待接收方超时");
+        break;
+    case WaitBlockAck:
+    case WaitBatchEndAck:
+        resendBlock();
+        break;
+    case WaitEotAck:
+        sendEot();
+        break;
+    default:
+        break;
+    }
+}
+
+void FileTransfer::writeRawChunks() {
+    if (!device) {
+        finish(false, "传输设备已关闭");
+        return;
+    }
+
+    // 设备写缓冲低于高水位时才继续写，避免把整个文件堆进 Qt 内部缓冲
+    const char *data = reinterpret_cast<const char *>(mapped);
+    while (offset < fileSize && device->bytesToWrite() < kRawHighWater) {
+        qint64 written = device->write(data + offset, qMin(kRawChunkSize, fileSize - offset));
+        if (written < 0) {
+            finish(false, "写入失败: " + device->errorString());
+            return;
+        }
+        if (written == 0) {
+            break;
+        }
+        offset += written;
+    }
+
+    emit progress(offset, fileSize);
+
+    if (offset >= fileSize && device->bytesToWrite() == 0) {
+        finish(true, "文件发送完成");
+    }
+}
+
+void FileTransfer::sendHeaderBlock(bool endOfBatch) {
+    // YMODEM 块0: 文件名\0文件大小\0；批次结束时为全零块
+    QByteArray header;
+    if (!endOfBatch) {
+        header = QFileInfo(file.fileName()).fileName().toUtf8();
+        header.append('\0');
+        header.append(QByteArray::number(fileSize));
+        header.append('\0');
+    }
+
+    int blockSize = header.size() > 128 ? 1024 : 128;
+    retries = 0;
+    writeBlock(0, header.constData(), qMin(int(header.size()), blockSize), blockSize, '\0');
+    state = endOfBatch ? WaitBatchEndAck : WaitBlockAck;
+    timeoutTimer.start(kBlockTimeoutMs);
+}
+
+void FileTransfer::sendNextBlock() {
+    if (offset >= fileSize) {
+        retries = 0;
+        sendEot();
+        return;
+    }
+
+    // 剩余不足 128 字节时用短块，减少填充
+    qint64 remaining = fileSize - offset;
+    int blockSize = remaining > 128 ? 1024 : 128;
+    int size = int(qMin<qint64>(blockSize, remaining));
+
+    retries = 0;
+    writeBlock(blockNumber, reinterpret_cast<const char *>(mapped) + offset, size, blockSize, SUB);
+    pendingOffset = offset + size;
+    state = WaitBlockAck;
+    timeoutTimer.start(kBlockTimeoutMs);
+}
+
+void FileTransfer::resendBlock() {
+    if (++retries > kMaxRetries) {
+        finish(false, "重试次数过多，传输失败");
+        return;
+    }
+    if (device) {
+        device->write(lastBlock);
+    }
+    timeoutTimer.start(kBlockTimeoutMs);
+}
+
+void FileTransfer::sendEot() {
+    if (state == WaitEotAck && ++retries > kMaxRetries) {
+        finish(false, "EOT 未被确认，传输失败");
+        return;
+    }
+    if (device) {
+        device->write(&EOT, 1);
+    }
+    state = WaitEotAck;
+    timeoutTimer.start(kBlockTimeoutMs);
+}
+
+void FileTransfer::writeBlock(quint8 number, const char *data, int size, int blockSize, char pad) {
+    // 块格式: SOH/STX 块号 块号反码 数据 CRC高 CRC低
+    lastBlock.resize(3 + blockSize + 2);
+    char *p = lastBlock.data();
+    p[0] = blockSize == 1024 ? STX : SOH;
+    p[1] = char(number);
+    p[2] = char(0xFF - number);
+    if (size > 0) {
+        std::memcpy(p + 3, data, size);
+    }
+    std::memset(p + 3 + size, pad, blockSize - size);
+
+    quint16 crc = crc16(p + 3, blockSize);
+    p[3 + blockSize] = char(crc >> 8);
+    p[4 + blockSize] = char(crc & 0xFF);
+
+    if (device) {
+        device->write(lastBlock);
+    }
+}
+
+void FileTransfer::finish(bool success, const QString &message) {
+    timeoutTimer.stop();
+    if (device) {
+        disconnect(device, &QIODevice::bytesWritten, this, &FileTransfer::onBytesWritten);
+    }
+    device = nullptr;
+
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = nullptr;
+    }
+    file.close();
+
+    state = Idle;
+    lastBlock.clear();
+    if (!success) {
+        lastError = message;
+    }
+    emit finished(success, message);
+}
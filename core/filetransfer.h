@@ -0,0 +1,85 @@
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QPointer>
+#include <QTimer>
+
+class QIODevice;
+
+// FileTransfer 文件发送引擎
+// 文件通过 QFile::map 映射后按块直接写入传输设备，依据 bytesWritten 做背压，
+// 不经过十六进制字符串转换；可选 XMODEM-1K / YMODEM (CRC16) 协议
+class FileTransfer : public QObject {
+    Q_OBJECT
+
+public:
+    enum Protocol {
+        Raw,        // 原始流
+        XModem1K,   // XMODEM-1K (CRC)
+        YModem      // YMODEM 批量传输(单文件)
+    };
+
+    explicit FileTransfer(QObject *parent = nullptr);
+    ~FileTransfer();
+
+    // 开始发送，device 必须已打开；失败时返回 false 并通过 errorString() 说明原因
+    bool start(QIODevice *device, const QString &filePath, Protocol protocol);
+    void cancel();
+
+    bool isActive() const { return state != Idle; }
+    QString errorString() const { return lastError; }
+
+    // 传输期间收到的数据交给协议状态机，返回 true 表示数据已被协议消费
+    bool handleIncoming(const QByteArray &data);
+
+    static Protocol protocolFromString(const QString &name);
+    static quint16 crc16(const char *data, qint64 size);
+
+signals:
+    void progress(qint64 sent, qint64 total);
+    void finished(bool success, const QString &message);
+
+private slots:
+    void onBytesWritten(qint64 bytes);
+    void onTimeout();
+
+private:
+    enum State {
+        Idle,
+        RawStreaming,   // 原始流发送中
+        WaitStart,      // 等待接收方 'C'
+        WaitBlockAck,   // 等待数据块 ACK
+        WaitEotAck,     // 等待 EOT 的 ACK
+        WaitBatchStart, // YMODEM 等待接收方请求批次结束块
+        WaitBatchEndAck // YMODEM 等待结束空块的 ACK
+    };
+
+    void writeRawChunks();
+    void sendHeaderBlock(bool endOfBatch);
+    void sendNextBlock();
+    void resendBlock();
+    void sendEot();
+    void writeBlock(quint8 number, const char *data, int size, int blockSize, char pad);
+    void finish(bool success, const QString &message);
+
+    QPointer<QIODevice> device;
+    QFile file;
+    uchar *mapped = nullptr;        // 文件映射区
+    qint64 fileSize = 0;
+    qint64 offset = 0;              // 已发送(已确认)的字节数
+    qint64 pendingOffset = 0;       // 当前块确认后的偏移
+    Protocol protocol = Raw;
+    State state = Idle;
+    bool headerSent = false;        // YMODEM 块0 是否已确认
+    quint8 blockNumber = 1;
+    QByteArray lastBlock;           // 最近发送的块，用于 NAK 重发
+    int retries = 0;
+    int cancelCount = 0;
+    QTimer timeoutTimer;
+    QString lastError;
+};
+
+#endif // FILETRANSFER_H
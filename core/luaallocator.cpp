@@ -0,0 +1,129 @@
+#include "luaallocator.h"
+
+#include <cstdlib>
+#include <cstring>
+
+LuaAllocator::~LuaAllocator() {
+    for (char *chunk : std::as_const(chunkList)) {
+        std::free(chunk);
+    }
+}
+
+void *LuaAllocator::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    return static_cast<LuaAllocator *>(ud)->reallocate(ptr, osize, nsize);
+}
+
+// ptr 为空时 osize 表示对象类型而不是大小，按 0 处理
+void *LuaAllocator::reallocate(void *ptr, size_t osize, size_t nsize) {
+    if (!ptr) {
+        osize = 0;
+    }
+
+    if (nsize == 0) {
+        if (ptr) {
+            if (osize <= kMaxSmall) {
+                freeSmall(ptr, sizeClass(osize));
+                counters.smallBlocks--;
+            } else {
+                std::free(ptr);
+                counters.largeBlocks--;
+            }
+            counters.bytesInUse -= qint64(osize);
+            counters.frees++;
+        }
+        return nullptr;
+    }
+
+    counters.allocations++;
+    bool oldSmall = ptr && osize <= kMaxSmall;
+    bool newSmall = nsize <= kMaxSmall;
+
+    void *block;
+    if (oldSmall && newSmall && sizeClass(osize) == sizeClass(nsize)) {
+        // 同一级内伸缩，块大小不变
+        counters.inPlace++;
+        block = ptr;
+    } else if (ptr && !oldSmall && !newSmall) {
+        block = std::realloc(ptr, nsize);
+        if (!block) {
+            return nullptr;
+        }
+    } else {
+        block = newSmall ? allocateSmall(sizeClass(nsize)) : std::malloc(nsize);
+        if (!block) {
+            return nullptr;
+        }
+        if (newSmall) {
+            counters.smallBlocks++;
+        } else {
+            counters.largeBlocks++;
+        }
+        if (ptr) {
+            memcpy(block, ptr, qMin(osize, nsize));
+            if (oldSmall) {
+                freeSmall(ptr, sizeClass(osize));
+                counters.smallBlocks--;
+            } else {
+                std::free(ptr);
+                counters.largeBlocks--;
+            }
+        }
+    }
+
+    counters.bytesInUse += qint64(nsize) - qint64(osize);
+    counters.peakBytes = qMax(counters.peakBytes, counters.bytesInUse);
+    return block;
+}
+
+void *LuaAllocator::allocateSmall(int cls) {
+    if (freeLists[cls]) {
+        counters.poolHits++;
+    } else if (!refill(cls)) {
+        return nullptr;
+    }
+    FreeBlock *block = freeLists[cls];
+    freeLists[cls] = block->next;
+    return block;
+}
+
+void LuaAllocator::freeSmall(void *ptr, int cls) {
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = freeLists[cls];
+    freeLists[cls] = block;
+}
+
+// 新分配一个大块并切成该级的空闲块；大块在分配器析构时统一释放
+bool LuaAllocator::refill(int cls) {
+    char *chunk = static_cast<char *>(std::malloc(kChunkSize));
+    if (!chunk) {
+        return false;
+    }
+    chunkList.append(chunk);
+    counters.chunks++;
+
+    const size_t blockSize = size_t(cls + 1) * kGranularity;
+    const size_t count = kChunkSize / blockSize;
+    FreeBlock *head = freeLists[cls];
+    for (size_t i = count; i > 0; i--) {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(chunk + (i - 1) * blockSize);
+        block->next = head;
+        head = block;
+    }
+    freeLists[cls] = head;
+    return true;
+}
+
+QVariantMap LuaAllocator::statistics() const {
+    QVariantMap map;
+    map["allocBytes"] = counters.bytesInUse;
+    map["allocPeakBytes"] = counters.peakBytes;
+    map["smallBlocks"] = counters.smallBlocks;
+    map["largeBlocks"] = counters.largeBlocks;
+    map["poolChunks"] = counters.chunks;
+    map["poolBytes"] = counters.chunks * qint64(kChunkSize);
+    map["allocations"] = counters.allocations;
+    map["frees"] = counters.frees;
+    map["inPlace"] = counters.inPlace;
+    map["poolHits"] = counters.poolHits;
+    return map;
+}
@@ -0,0 +1,60 @@
+#ifndef LUAALLOCATOR_H
+#define LUAALLOCATOR_H
+
+#include <QVariantMap>
+#include <QVector>
+
+#include <cstddef>
+
+// LuaAllocator Lua 状态的内存分配器(lua_Alloc)
+// 256 字节以内的小块按 16 字节分级，从 64KB 大块中切分并由各级空闲链表复用；更大的块直接用 malloc
+// 每个 Lua 状态一个实例，只在该状态所在线程使用，必须在 lua_close 之后析构
+class LuaAllocator {
+public:
+    struct Stats {
+        qint64 bytesInUse = 0;    // Lua 申请的字节数
+        qint64 peakBytes = 0;
+        qint64 smallBlocks = 0;   // 使用中的小块数
+        qint64 largeBlocks = 0;   // 使用中的 malloc 块数
+        qint64 chunks = 0;        // 已分配的大块数
+        qint64 allocations = 0;   // 分配/扩容请求次数
+        qint64 frees = 0;
+        qint64 inPlace = 0;       // 同级内的 realloc，直接返回原指针
+        qint64 poolHits = 0;      // 由空闲链表满足的小块请求
+    };
+
+    LuaAllocator() = default;
+    ~LuaAllocator();
+
+    LuaAllocator(const LuaAllocator &) = delete;
+    LuaAllocator &operator=(const LuaAllocator &) = delete;
+
+    // 作为 lua_newstate 的分配函数，ud 为 LuaAllocator 实例
+    static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+    Stats stats() const { return counters; }
+    QVariantMap statistics() const;
+
+private:
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxSmall = 256;
+    static constexpr int kClassCount = int(kMaxSmall / kGranularity);
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    static int sizeClass(size_t size) { return int((size + kGranularity - 1) / kGranularity) - 1; }
+
+    void *reallocate(void *ptr, size_t osize, size_t nsize);
+    void *allocateSmall(int cls);
+    void freeSmall(void *ptr, int cls);
+    bool refill(int cls);
+
+    FreeBlock *freeLists[kClassCount] = {};
+    QVector<char *> chunkList;
+    Stats counters;
+};
+
+#endif // LUAALLOCATOR_H
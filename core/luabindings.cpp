@@ -0,0 +1,1648 @@
+#include "luabindings.h"
+#include "serialhandler.h"
+#include "codec.h"
+
+#include <QDebug>
+#include <QDateTime>
+#include <QFile>
+#include <QMetaMethod>
+#include <QTextStream>
+#include <QThread>
+
+// Lua头文件
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+}
+
+// Lua log 级别名称和输出前缀，下标即级别
+static const char *const logLevelNames[] = {"debug", "info", "warn", "error", "off"};
+static const char *const logLevelTags[] = {"[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] "};
+static const int logLevelCount = 5;
+
+static int logLevelFromName(const char *name) {
+    for (int level = 0; level < logLevelCount; level++) {
+        if (qstricmp(name, logLevelNames[level]) == 0) {
+            return level;
+        }
+    }
+    return -1;
+}
+
+// === SerialHandler 脚本引擎：协程调度和回调 ===
+
+QString SerialHandler::executeLuaScript(const QString &script) {
+    if (!L) {
+        return "Lua环境未初始化";
+    }
+
+    // 保存当前脚本内容
+    currentScript = script;
+
+    // 重置协程状态
+    isCoroutineRunning = false;
+    waitingForResponse = false;
+
+    // 创建协程
+    createLuaCoroutine(script);
+
+    // 启动协程
+    return resumeMainCoroutine();
+}
+
+QString SerialHandler::loadLuaScriptFile(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return "无法打开文件: " + filePath;
+    }
+
+    QTextStream in(&file);
+    QString script = in.readAll();
+    file.close();
+
+    // 执行脚本
+    return executeLuaScript(script);
+}
+
+bool SerialHandler::saveLuaScriptToFile(const QString &script, const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << script;
+    file.close();
+    return true;
+}
+
+bool SerialHandler::isScriptRunning() {
+    return isCoroutineRunning;
+}
+
+void SerialHandler::stopLuaScript() {
+    stopCoroutine(); // 停止协程
+}
+
+bool SerialHandler::setScriptLogLevel(const QString &level) {
+    int value = logLevelFromName(level.toUtf8().constData());
+    if (value < 0) {
+        return false;
+    }
+    scriptLogLevel = value;
+    return true;
+}
+
+QString SerialHandler::getScriptLogLevel() {
+    return QString::fromLatin1(logLevelNames[scriptLogLevel]);
+}
+
+bool SerialHandler::setLuaGcMode(const QString &mode, int param1, int param2) {
+    if (!L) {
+        return false;
+    }
+    if (mode == "incremental") {
+        lua_gc(L, LUA_GCINC, param1, param2, 0);  // pause, stepmul
+    } else if (mode == "generational") {
+        lua_gc(L, LUA_GCGEN, param1, param2);     // minormul, majormul
+    } else {
+        return false;
+    }
+    luaGcMode = mode;
+    return true;
+}
+
+void SerialHandler::collectLuaGarbage() {
+    if (L) {
+        lua_gc(L, LUA_GCCOLLECT);
+    }
+}
+
+QVariantMap SerialHandler::getLuaMemoryStats() {
+    QVariantMap map;
+    if (!L) {
+        return map;
+    }
+    qint64 bytes = qint64(lua_gc(L, LUA_GCCOUNT)) * 1024 + lua_gc(L, LUA_GCCOUNTB);
+    map["bytes"] = bytes;
+    map["gcMode"] = luaGcMode;
+    map["mainStackTop"] = lua_gettop(L);  // 长时间运行应保持为 0
+    map["coroutines"] = coroutineCount;   // 累计创建的脚本协程
+    map["coroutineActive"] = co != nullptr;
+    map.insert(luaAllocator.statistics());
+    return map;
+}
+
+// 发送队列回落到低水位，通知Lua回调并恢复等待中的协程
+void SerialHandler::onTxLowWater(qint64 depth) {
+    callLuaCallback(txLowWaterRef, depth);
+
+    if (waitingForTxDrain && isCoroutineRunning && co) {
+        waitingForTxDrain = false;
+        lua_pushinteger(co, depth);
+        int result = lua_resume(co, NULL, 1, &nres);
+        handleCoroutineResult(result);
+    }
+}
+
+// 文件发送结束，若有协程在等待则恢复它
+void SerialHandler::onFileTransferFinished(bool success, const QString &message) {
+    qDebug() << "File transfer finished:" << success << message;
+    txQueue.setPaused(false);  // 传输期间排队的数据继续发送
+    emit fileTransferFinished(success, message);
+
+    if (waitingForFileTransfer && isCoroutineRunning && co) {
+        waitingForFileTransfer = false;
+        lua_pushboolean(co, success);
+        lua_pushstring(co, message.toUtf8().constData());
+        int result = lua_resume(co, NULL, 2, &nres);
+        handleCoroutineResult(result);
+    }
+}
+
+// 执行计划的脚本
+void SerialHandler::executeScheduledScript() {
+    executeLuaScript(currentScript);
+}
+
+// 恢复协程执行
+void SerialHandler::resumeCoroutine() {
+    if (isCoroutineRunning && co) {
+        int result = lua_resume(co, NULL, 0, &nres);
+        handleCoroutineResult(result);
+    }
+}
+
+// 处理响应超时
+void SerialHandler::handleResponseTimeout() {
+    if (waitingForResponse && isCoroutineRunning) {
+        postScriptOutput("响应超时");
+        waitingForResponse = false;
+        removeScriptTrigger(waitTriggerId);
+        waitTriggerId = -1;
+
+        // 恢复协程，但将超时状态返回给Lua
+        lua_pushboolean(co, 0); // 超时返回false
+        int result = lua_resume(co, NULL, 1, &nres);
+        handleCoroutineResult(result);
+    }
+}
+
+// 未受保护的 Lua 错误，Lua 随后会 abort
+static int luaPanic(lua_State *L) {
+    const char *message = lua_tostring(L, -1);
+    qCritical() << "Lua panic:" << (message ? message : "error object is not a string");
+    return 0;
+}
+
+// 初始化Lua环境
+void SerialHandler::initLua() {
+    coRef = LUA_NOREF;
+    txHighWaterRef = LUA_NOREF;
+    txLowWaterRef = LUA_NOREF;
+    virtualDeviceRef = LUA_NOREF;
+    frameCallbackRef = LUA_NOREF;
+    pollChangeRef = LUA_NOREF;
+
+    // 创建Lua状态，小块内存由分级池分配
+    L = lua_newstate(LuaAllocator::alloc, &luaAllocator);
+    if (!L) {
+        qDebug() << "Failed to create Lua state";
+        return;
+    }
+    lua_atpanic(L, luaPanic);
+
+    // 打开Lua标准库
+    luaL_openlibs(L);
+
+    // 注册自定义函数
+    LuaBindings::install(L, this);
+}
+
+// 清理Lua状态
+void SerialHandler::closeLua() {
+    if (L) {
+        releaseCoroutine();
+        lua_close(L);
+        L = nullptr;
+    }
+}
+
+// 创建Lua协程
+void SerialHandler::createLuaCoroutine(const QString &script) {
+    // 如果已经有一个协程在运行，先停止它；挂起但已被标记为停止的协程也一并关闭
+    stopCoroutine();
+    releaseCoroutine();
+    releaseLuaCallbacks();
+
+    // 创建新的协程，用注册表引用持有它，主线程栈上不留下线程对象
+    co = lua_newthread(L);
+    if (!co) {
+        postScriptOutput("无法创建Lua协程");
+        return;
+    }
+    coRef = luaL_ref(L, LUA_REGISTRYINDEX);
+    coroutineCount++;
+
+    // 加载脚本到协程
+    int error = luaL_loadstring(co, script.toUtf8().constData());
+    if (error) {
+        QString errorMsg = QString("Lua错误: %1").arg(lua_tostring(co, -1));
+        postScriptOutput(errorMsg);
+        lua_pop(co, 1);  // 弹出错误消息
+        releaseCoroutine();
+        return;
+    }
+}
+
+// 关闭当前协程并释放注册表引用，协程及其栈上的对象可被回收
+void SerialHandler::releaseCoroutine() {
+    if (!co) {
+        return;
+    }
+#if LUA_VERSION_NUM > 504 || (LUA_VERSION_NUM == 504 && LUA_VERSION_RELEASE_NUM >= 50406)
+    lua_closethread(co, L);
+#elif LUA_VERSION_NUM == 504
+    lua_resetthread(co);  // 5.4.6 之前的名称
+#else
+    lua_settop(co, 0);
+#endif
+    luaL_unref(L, LUA_REGISTRYINDEX, coRef);
+    coRef = LUA_NOREF;
+    co = nullptr;
+}
+
+// 恢复主协程执行
+QString SerialHandler::resumeMainCoroutine() {
+    if (!co) {
+        return "协程未初始化";
+    }
+
+    isCoroutineRunning = true;
+
+    // 恢复协程执行
+    int result = lua_resume(co, NULL, 0, &nres);
+
+    return handleCoroutineResult(result);
+}
+
+// 处理协程执行结果
+QString SerialHandler::handleCoroutineResult(int result) {
+    if (result == LUA_OK) {
+        // 协程执行完成
+        isCoroutineRunning = false;
+        waitingForResponse = false;
+        responseTimer.stop();
+        releaseCoroutine();
+        flushScriptOutput();
+        emit scriptSchedulerStatusChanged(false, "脚本执行完成");
+        return "脚本执行完成";
+    } else if (result == LUA_YIELD) {
+        // 协程被挂起，等待后续恢复
+        return "脚本执行挂起";
+    } else {
+        // 发生错误
+        QString errorMsg = QString("Lua错误: %1").arg(lua_tostring(co, -1));
+        postScriptOutput(errorMsg);
+        lua_pop(co, 1);  // 弹出错误消息
+
+        isCoroutineRunning = false;
+        waitingForResponse = false;
+        responseTimer.stop();
+        releaseCoroutine();
+        flushScriptOutput();
+        emit scriptSchedulerStatusChanged(false, errorMsg);
+        return errorMsg;
+    }
+}
+
+// 停止当前协程
+void SerialHandler::stopCoroutine() {
+    if (isCoroutineRunning) {
+        isCoroutineRunning = false;
+        waitingForResponse = false;
+        waitingForFileTransfer = false;
+        waitingForTxDrain = false;
+        responseTimer.stop();
+        coroutineTimer.stop();
+        removeScriptTrigger(waitTriggerId);
+        waitTriggerId = -1;
+        releaseCoroutine();
+        postScriptOutput("协程已停止");
+        flushScriptOutput();
+    }
+}
+
+// 脚本输出先进入列表，回到事件循环或脚本结束时合并发出
+void SerialHandler::postScriptOutput(const QString &text) {
+    pendingOutput.append(text);
+    // 长时间不让出的脚本也按批发出，避免列表无限增长
+    if (pendingOutput.size() >= 1000) {
+        flushScriptOutput();
+    } else if (!outputTimer.isActive()) {
+        outputTimer.start();
+    }
+}
+
+void SerialHandler::flushScriptOutput() {
+    outputTimer.stop();
+    if (pendingOutput.isEmpty()) {
+        return;
+    }
+    QString output = pendingOutput.join('\n');
+    pendingOutput.clear();
+    emit luaOutput(output);
+}
+
+// waitFor(nil) 等待任意数据：收到数据即恢复协程；按模式等待由 scanTriggers 处理
+void SerialHandler::checkAndResumeCoroutine() {
+    if (!isCoroutineRunning || !waitingForResponse || !co || waitTriggerId >= 0) {
+        return;
+    }
+
+    responseTimer.stop();
+    waitingForResponse = false;
+
+    // 恢复协程，传递收到的数据
+    lua_pushboolean(co, 1); // 成功返回true
+    lua_pushlstring(co, lastReceivedData.constData(), lastReceivedData.size()); // 返回接收到的数据
+
+    int result = lua_resume(co, NULL, 2, &nres);
+    handleCoroutineResult(result);
+}
+
+// 接收流送入触发器引擎，命中时调用回调或恢复 waitFor 等待的协程
+void SerialHandler::scanTriggers(const RxBuffer &chunk) {
+    if (triggerEngine.isEmpty()) {
+        return;
+    }
+    triggerEngine.feed(chunk.constData(), chunk.size(), triggerMatches);
+    if (triggerMatches.isEmpty()) {
+        return;
+    }
+
+    // 回调中可能增删触发器，先取出本次命中
+    QVector<TriggerMatch> matches;
+    matches.swap(triggerMatches);
+    for (const TriggerMatch &match : std::as_const(matches)) {
+        if (match.id == waitTriggerId) {
+            waitTriggerId = -1;
+            if (waitingForResponse && isCoroutineRunning && co) {
+                responseTimer.stop();
+                waitingForResponse = false;
+                lua_pushboolean(co, 1);
+                lua_pushlstring(co, match.bytes.constData(), match.bytes.size());
+                int result = lua_resume(co, NULL, 2, &nres);
+                handleCoroutineResult(result);
+            }
+            continue;
+        }
+
+        int ref = triggerRefs.value(match.id, LUA_NOREF);
+        if (L && ref != LUA_NOREF) {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+            lua_pushinteger(L, match.id);
+            lua_pushlstring(L, match.bytes.constData(), match.bytes.size());
+            if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+                postScriptOutput(QString("触发器回调错误: %1").arg(lua_tostring(L, -1)));
+                lua_pop(L, 1);
+            }
+        }
+        // once 触发器命中后已从引擎移除，同时释放回调
+        if (!triggerEngine.contains(match.id)) {
+            removeScriptTrigger(match.id);
+        }
+    }
+    matches.clear();
+    triggerMatches.swap(matches);  // 保留容量供下次扫描复用
+}
+
+// 接收流送入协议解析器，解析出的帧发给界面和脚本 onFrame 回调
+void SerialHandler::dissect(const RxBuffer &chunk) {
+    if (!dissector) {
+        return;
+    }
+    dissector->feed(chunk.constData(), chunk.size(), dissectedFrames);
+    if (luaDissectorFailed) {
+        luaDissectorFailed = false;
+        postScriptOutput(QString("解析器 %1 已关闭").arg(dissector->name()));
+        dissector.reset();
+    }
+    if (dissectedFrames.isEmpty()) {
+        return;
+    }
+
+    static const QMetaMethod frameSignal = QMetaMethod::fromSignal(&SerialHandler::frameDecoded);
+    const bool notify = isSignalConnected(frameSignal);
+    const bool callScript = L && frameCallbackRef != LUA_NOREF;
+    if (!notify && !callScript) {
+        dissectedFrames.clear();
+        return;
+    }
+    const qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+
+    // 回调中可能切换解析器，先取出本次的帧
+    QVector<DissectedFrame> frames;
+    frames.swap(dissectedFrames);
+    for (const DissectedFrame &frame : std::as_const(frames)) {
+        const QVariantMap record = frame.toVariant();
+        if (notify) {
+            emit frameDecoded(record, timestamp);
+        }
+        if (callScript && frameCallbackRef != LUA_NOREF) {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, frameCallbackRef);
+            LuaBindings::pushVariant(L, record);
+            if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+                postScriptOutput(QString("解析回调错误: %1").arg(lua_tostring(L, -1)));
+                lua_pop(L, 1);
+            }
+        }
+    }
+    frames.clear();
+    dissectedFrames.swap(frames);  // 保留容量供下次解析复用
+}
+
+// 调用脚本解析函数 fn(bytes) -> consumed, fields[, summary]
+// consumed > 0 为一帧的字节数，0 为需要更多数据，< 0 为跳过的字节数
+int SerialHandler::callLuaDissector(int ref, const char *data, int size, DissectedFrame &frame) {
+    if (!L) {
+        return -size;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    lua_pushlstring(L, data, size);
+    inLuaDissector = true;
+    int status = lua_pcall(L, 1, 3, 0);
+    inLuaDissector = false;
+    if (status != LUA_OK) {
+        postScriptOutput(QString("解析函数错误: %1").arg(lua_tostring(L, -1)));
+        lua_pop(L, 1);
+        luaDissectorFailed = true;
+        return -size;
+    }
+
+    int consumed = int(lua_tointeger(L, -3));
+    if (consumed > 0) {
+        if (lua_istable(L, -2)) {
+            frame.fields = LuaBindings::toVariant(L, -2).toMap();
+        }
+        if (lua_type(L, -1) == LUA_TSTRING) {
+            frame.summary = QString::fromUtf8(lua_tostring(L, -1));
+        } else {
+            frame.summary = Codec::toHexString(QByteArray(data, qMin(consumed, size)));
+        }
+    }
+    lua_pop(L, 3);
+    return consumed;
+}
+
+// 调用注册表中的Lua回调函数，参数为一个整数
+void SerialHandler::callLuaCallback(int ref, qint64 arg) {
+    if (!L || ref == LUA_NOREF || ref == LUA_REFNIL) {
+        return;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    lua_pushinteger(L, arg);
+    if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+        postScriptOutput(QString("Lua回调错误: %1").arg(lua_tostring(L, -1)));
+        lua_pop(L, 1);
+    }
+}
+
+// 调用脚本 onPollChange 回调，参数为组ID和变化的值
+void SerialHandler::callPollChangeCallback(int id, const QVariantList &changes) {
+    if (!L || pollChangeRef == LUA_NOREF) {
+        return;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, pollChangeRef);
+    lua_pushinteger(L, id);
+    LuaBindings::pushVariant(L, changes);
+    if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+        postScriptOutput(QString("轮询变化回调错误: %1").arg(lua_tostring(L, -1)));
+        lua_pop(L, 1);
+    }
+}
+
+// 释放脚本注册的回调
+void SerialHandler::releaseLuaCallbacks() {
+    if (!L) {
+        return;
+    }
+    luaL_unref(L, LUA_REGISTRYINDEX, txHighWaterRef);
+    luaL_unref(L, LUA_REGISTRYINDEX, txLowWaterRef);
+    luaL_unref(L, LUA_REGISTRYINDEX, virtualDeviceRef);
+    txHighWaterRef = LUA_NOREF;
+    txLowWaterRef = LUA_NOREF;
+    virtualDeviceRef = LUA_NOREF;
+
+    for (int ref : std::as_const(triggerRefs)) {
+        luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    }
+    triggerRefs.clear();
+    triggerEngine.clear();
+    waitTriggerId = -1;
+
+    luaL_unref(L, LUA_REGISTRYINDEX, frameCallbackRef);
+    frameCallbackRef = LUA_NOREF;
+    luaL_unref(L, LUA_REGISTRYINDEX, pollChangeRef);
+    pollChangeRef = LUA_NOREF;
+    if (dissector && luaDissectorRefs.contains(dissector->name())) {
+        dissector.reset();
+    }
+    for (int ref : std::as_const(luaDissectorRefs)) {
+        luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    }
+    luaDissectorRefs.clear();
+}
+
+// 移除触发器并释放其回调
+void SerialHandler::removeScriptTrigger(int id) {
+    if (id < 0) {
+        return;
+    }
+    triggerEngine.remove(id);
+    if (triggerRefs.contains(id)) {
+        int ref = triggerRefs.take(id);
+        if (L) {
+            luaL_unref(L, LUA_REGISTRYINDEX, ref);
+        }
+    }
+}
+
+// 调用Lua虚拟设备处理函数：参数为请求字节串，返回值为应答(nil 表示不应答)
+QByteArray SerialHandler::callVirtualDeviceHandler(const QByteArray &request) {
+    QByteArray response;
+    if (!L || virtualDeviceRef == LUA_NOREF || virtualDeviceRef == LUA_REFNIL) {
+        return response;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, virtualDeviceRef);
+    lua_pushlstring(L, request.constData(), request.size());
+    if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+        postScriptOutput(QString("虚拟设备脚本错误: %1").arg(lua_tostring(L, -1)));
+    } else if (lua_type(L, -1) == LUA_TSTRING) {
+        size_t len = 0;
+        const char *data = lua_tolstring(L, -1, &len);
+        response = QByteArray(data, int(len));
+    }
+    lua_pop(L, 1);
+    return response;
+}
+
+// === LuaBindings：脚本可调用的函数 ===
+
+// 注册全部函数，并保存 SerialHandler 指针供回调取用
+void LuaBindings::install(lua_State *L, SerialHandler *handler) {
+    lua_register(L, "send", lua_send);
+    lua_register(L, "sendHex", lua_sendHex);
+    lua_register(L, "sleep", lua_sleep);
+    lua_register(L, "print", lua_print);
+    lua_register(L, "getLastData", lua_getLastData);
+    lua_register(L, "setResponseTimeout", lua_setResponseTimeout);
+    lua_register(L, "addPeriodic", lua_addPeriodic);
+    lua_register(L, "removePeriodic", lua_removePeriodic);
+    lua_register(L, "startPeriodic", lua_startPeriodic);
+    lua_register(L, "stopPeriodic", lua_stopPeriodic);
+    lua_register(L, "getPeriodicStats", lua_getPeriodicStats);
+    lua_register(L, "sendFile", lua_sendFile);
+    lua_register(L, "getTxQueueDepth", lua_getTxQueueDepth);
+    lua_register(L, "setTxQueueLimits", lua_setTxQueueLimits);
+    lua_register(L, "onTxHighWater", lua_onTxHighWater);
+    lua_register(L, "onTxLowWater", lua_onTxLowWater);
+    lua_register(L, "waitTxDrain", lua_waitTxDrain);
+    lua_register(L, "setRtuFraming", lua_setRtuFraming);
+    lua_register(L, "setRtuStrictGap", lua_setRtuStrictGap);
+    lua_register(L, "getRtuTiming", lua_getRtuTiming);
+    lua_register(L, "createVirtualSerial", lua_createVirtualSerial);
+    lua_register(L, "setVirtualDeviceHandler", lua_setVirtualDeviceHandler);
+    lua_register(L, "setVirtualSerialErrors", lua_setVirtualSerialErrors);
+    lua_register(L, "setVirtualRegister", lua_setVirtualRegister);
+    lua_register(L, "getVirtualSerialStats", lua_getVirtualSerialStats);
+    lua_register(L, "getLuaMemoryStats", lua_getLuaMemoryStats);
+    lua_register(L, "addTrigger", lua_addTrigger);
+    lua_register(L, "addRegexTrigger", lua_addRegexTrigger);
+    lua_register(L, "removeTrigger", lua_removeTrigger);
+    lua_register(L, "waitFor", lua_waitFor);
+    lua_register(L, "waitForRegex", lua_waitForRegex);
+    lua_register(L, "getTriggerStats", lua_getTriggerStats);
+    lua_register(L, "setDissector", lua_setDissector);
+    lua_register(L, "registerDissector", lua_registerDissector);
+    lua_register(L, "onFrame", lua_onFrame);
+    lua_register(L, "getDissectors", lua_getDissectors);
+    lua_register(L, "getDissectorStats", lua_getDissectorStats);
+    lua_register(L, "recordTag", lua_recordTag);
+    lua_register(L, "getTag", lua_getTag);
+    lua_register(L, "queryTag", lua_queryTag);
+    lua_register(L, "getTags", lua_getTags);
+    lua_register(L, "getTagStats", lua_getTagStats);
+    lua_register(L, "startCapture", lua_startCapture);
+    lua_register(L, "stopCapture", lua_stopCapture);
+    lua_register(L, "exportTags", lua_exportTags);
+    lua_register(L, "getExportStats", lua_getExportStats);
+    lua_register(L, "addPoll", lua_addPoll);
+    lua_register(L, "removePoll", lua_removePoll);
+    lua_register(L, "clearPolls", lua_clearPolls);
+    lua_register(L, "startPolling", lua_startPolling);
+    lua_register(L, "stopPolling", lua_stopPolling);
+    lua_register(L, "getPollStats", lua_getPollStats);
+    lua_register(L, "getPollUnits", lua_getPollUnits);
+    lua_register(L, "onPollChange", lua_onPollChange);
+    lua_register(L, "modbusWrite", lua_modbusWrite);
+    lua_register(L, "getWriteStats", lua_getWriteStats);
+    lua_register(L, "searchHistory", lua_searchHistory);
+    lua_register(L, "getHistoryStats", lua_getHistoryStats);
+
+    // log 表：log.debug/info/warn/error(fmt, ...)
+    // 每个函数是带上值的闭包(handler、级别、string.format)，级别检查不查全局表
+    lua_newtable(L);
+    for (int level = 0; level < logLevelCount - 1; level++) {
+        lua_pushlightuserdata(L, handler);
+        lua_pushinteger(L, level);
+        lua_getglobal(L, "string");
+        lua_getfield(L, -1, "format");
+        lua_remove(L, -2);
+        lua_pushcclosure(L, lua_log, 3);
+        lua_setfield(L, -2, logLevelNames[level]);
+    }
+    lua_pushcfunction(L, lua_setLogLevel);
+    lua_setfield(L, -2, "setLevel");
+    lua_pushcfunction(L, lua_getLogLevel);
+    lua_setfield(L, -2, "getLevel");
+    lua_pushcfunction(L, lua_flushLog);
+    lua_setfield(L, -2, "flush");
+    lua_setglobal(L, "log");
+
+    // 设置全局指针，方便在静态函数中访问类实例
+    lua_pushlightuserdata(L, handler);
+    lua_setglobal(L, "__SerialHandler");
+}
+
+// 将QVariant压入Lua栈（Map转为table，List转为数组table）
+void LuaBindings::pushVariant(lua_State *L, const QVariant &value) {
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        lua_pushboolean(L, value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        lua_pushinteger(L, value.toLongLong());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        lua_pushnumber(L, value.toDouble());
+        break;
+    case QMetaType::QByteArray: {
+        const QByteArray bytes = value.toByteArray();
+        lua_pushlstring(L, bytes.constData(), bytes.size());
+        break;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        lua_createtable(L, 0, map.size());
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            pushVariant(L, it.value());
+            lua_setfield(L, -2, it.key().toUtf8().constData());
+        }
+        break;
+    }
+    case QMetaType::QStringList:
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        lua_createtable(L, list.size(), 0);
+        for (int i = 0; i < list.size(); i++) {
+            pushVariant(L, list[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+        break;
+    }
+    default:
+        if (value.isNull()) {
+            lua_pushnil(L);
+        } else {
+            lua_pushstring(L, value.toString().toUtf8().constData());
+        }
+        break;
+    }
+}
+
+// 将Lua值转为QVariant：数组table转为List，其他table转为Map，字符串按 UTF-8 转为 QString
+QVariant LuaBindings::toVariant(lua_State *L, int index, int depth) {
+    index = lua_absindex(L, index);
+    switch (lua_type(L, index)) {
+    case LUA_TBOOLEAN:
+        return bool(lua_toboolean(L, index));
+    case LUA_TNUMBER:
+        if (lua_isinteger(L, index)) {
+            return qint64(lua_tointeger(L, index));
+        }
+        return double(lua_tonumber(L, index));
+    case LUA_TSTRING: {
+        size_t len = 0;
+        const char *text = lua_tolstring(L, index, &len);
+        return QString::fromUtf8(text, int(len));
+    }
+    case LUA_TTABLE: {
+        if (depth >= 16) {
+            return QVariant();  // 防止自引用的表无限递归
+        }
+        lua_Integer length = luaL_len(L, index);
+        if (length > 0) {
+            QVariantList list;
+            list.reserve(int(length));
+            for (lua_Integer i = 1; i <= length; i++) {
+                lua_rawgeti(L, index, i);
+                list.append(toVariant(L, -1, depth + 1));
+                lua_pop(L, 1);
+            }
+            return list;
+        }
+        QVariantMap map;
+        lua_pushnil(L);
+        while (lua_next(L, index)) {
+            // 复制键再转字符串，避免 lua_tostring 修改 lua_next 使用的键
+            lua_pushvalue(L, -2);
+            const char *key = lua_tostring(L, -1);
+            if (key) {
+                map.insert(QString::fromUtf8(key), toVariant(L, -2, depth + 1));
+            }
+            lua_pop(L, 2);
+        }
+        return map;
+    }
+    default:
+        return QVariant();
+    }
+}
+
+// Lua API静态函数 - 获取SerialHandler实例
+SerialHandler* LuaBindings::getSerialHandler(lua_State *L) {
+    lua_getglobal(L, "__SerialHandler");
+    SerialHandler* handler = static_cast<SerialHandler*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    return handler;
+}
+
+// Lua API - 发送ASCII文本
+int LuaBindings::lua_send(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    const char* data = luaL_checkstring(L, 1);
+    lua_pushboolean(L, handler->sendData(QString(data), false)); // ASCII模式，队列满时返回false
+    return 1;
+}
+
+// Lua API - 发送HEX数据
+int LuaBindings::lua_sendHex(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    const char* data = luaL_checkstring(L, 1);
+    lua_pushboolean(L, handler->sendData(QString(data), true)); // HEX模式，队列满时返回false
+    return 1;
+}
+
+// Lua API - 等待指定毫秒
+int LuaBindings::lua_sleep(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int ms = luaL_checkinteger(L, 1);
+
+    // 在协程模式下，使用QTimer延迟执行而不是阻塞
+    if (handler->isCoroutineRunning) {
+        handler->coroutineTimer.setSingleShot(true);
+        handler->coroutineTimer.start(ms);
+        return lua_yield(L, 0); // 挂起协程
+    } else {
+        // 非协程模式，使用传统的阻塞睡眠
+        QThread::msleep(ms);
+        return 0;
+    }
+}
+
+// Lua API - 打印输出，参数在 luaL_Buffer 中拼接，只做一次 UTF-8 转换
+int LuaBindings::lua_print(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int nargs = lua_gettop(L);
+    luaL_Buffer buffer;
+    luaL_buffinit(L, &buffer);
+    for (int i = 1; i <= nargs; i++) {
+        luaL_tolstring(L, i, nullptr);  // 与标准 print 相同的转换规则
+        luaL_addvalue(&buffer);
+        if (i < nargs) {
+            luaL_addchar(&buffer, ' ');
+        }
+    }
+    luaL_pushresult(&buffer);
+
+    size_t len = 0;
+    const char *text = lua_tolstring(L, -1, &len);
+    handler->postScriptOutput(QString::fromUtf8(text, int(len)));
+    return 0;
+}
+
+// Lua API - 分级日志 log.debug/info/warn/error(fmt, ...)
+// 级别不够时在任何字符串处理之前返回；多个参数时按 string.format 格式化
+int LuaBindings::lua_log(lua_State *L) {
+    SerialHandler *handler = static_cast<SerialHandler *>(lua_touserdata(L, lua_upvalueindex(1)));
+    int level = int(lua_tointeger(L, lua_upvalueindex(2)));
+    if (!handler || level < handler->scriptLogLevel) {
+        return 0;
+    }
+
+    int nargs = lua_gettop(L);
+    if (nargs == 0) {
+        return 0;
+    }
+    if (nargs > 1) {
+        lua_pushvalue(L, lua_upvalueindex(3));
+        lua_insert(L, 1);
+        lua_call(L, nargs, 1);
+    } else {
+        luaL_tolstring(L, 1, nullptr);
+    }
+
+    size_t len = 0;
+    const char *text = lua_tolstring(L, -1, &len);
+    QString line = QLatin1String(logLevelTags[level]);
+    line.append(QString::fromUtf8(text, int(len)));
+    handler->postScriptOutput(line);
+    return 0;
+}
+
+// Lua API - 设置日志级别 log.setLevel("debug"|"info"|"warn"|"error"|"off")
+int LuaBindings::lua_setLogLevel(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int level = logLevelFromName(luaL_checkstring(L, 1));
+    if (level < 0) {
+        return luaL_argerror(L, 1, "日志级别应为 debug/info/warn/error/off");
+    }
+    handler->scriptLogLevel = level;
+    return 0;
+}
+
+// Lua API - 获取当前日志级别名称
+int LuaBindings::lua_getLogLevel(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    lua_pushstring(L, logLevelNames[handler->scriptLogLevel]);
+    return 1;
+}
+
+// Lua API - 立即发出已缓存的输出(默认每轮事件循环发出一次)
+int LuaBindings::lua_flushLog(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->flushScriptOutput();
+    return 0;
+}
+
+// Lua API - 获取最后接收的数据（二进制数据）
+int LuaBindings::lua_getLastData(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) {
+        lua_pushlstring(L, "", 0);  // 返回空字节串
+        return 1;
+    }
+
+    // 检查是否有新数据
+    if (!handler->hasNewData) {
+        lua_pushlstring(L, "", 0);
+        return 1;
+    }
+
+    // 获取数据
+    const char* data = handler->lastReceivedData.constData();
+    int size = handler->lastReceivedData.size();
+
+    // 重置标志位
+    handler->hasNewData = false;
+
+    // 直接返回二进制数据
+    lua_pushlstring(L, data, size);
+    return 1;
+}
+
+// Lua API - 设置响应超时时间
+int LuaBindings::lua_setResponseTimeout(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int timeout = luaL_checkinteger(L, 1);
+    if (timeout > 0) {
+        handler->responseTimeout = timeout;
+    }
+
+    return 0;
+}
+
+// Lua API - 添加定时发送帧 addPeriodic(hex, periodMs[, phaseMs])，返回帧ID
+int LuaBindings::lua_addPeriodic(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    const char* data = luaL_checkstring(L, 1);
+    double periodMs = luaL_checknumber(L, 2);
+    double phaseMs = luaL_optnumber(L, 3, 0);
+    lua_pushinteger(L, handler->addPeriodicFrame(QString(data), true, periodMs, phaseMs));
+    return 1;
+}
+
+// Lua API - 移除定时发送帧
+int LuaBindings::lua_removePeriodic(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    lua_pushboolean(L, handler->removePeriodicFrame(luaL_checkinteger(L, 1)));
+    return 1;
+}
+
+// Lua API - 启动定时发送，可选参数为忙等阈值(微秒)
+int LuaBindings::lua_startPeriodic(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    if (lua_isinteger(L, 1)) {
+        handler->setPeriodicSpinUs(lua_tointeger(L, 1));
+    }
+    handler->startPeriodicSend();
+    return 0;
+}
+
+// Lua API - 停止定时发送
+int LuaBindings::lua_stopPeriodic(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->stopPeriodicSend();
+    return 0;
+}
+
+// Lua API - 获取抖动统计，返回 {{id=, samples=, minUs=, maxUs=, meanUs=, stddevUs=, overruns=}, ...}
+int LuaBindings::lua_getPeriodicStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getPeriodicStats());
+    return 1;
+}
+
+// Lua API - 发送文件 sendFile(path[, protocol])
+// 协程中会挂起直到发送结束，返回 (成功, 消息)
+int LuaBindings::lua_sendFile(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    const char* path = luaL_checkstring(L, 1);
+    const char* protocol = luaL_optstring(L, 2, "raw");
+
+    if (!handler->startFileTransfer(QString::fromUtf8(path), QString::fromUtf8(protocol))) {
+        lua_pushboolean(L, 0);
+        lua_pushstring(L, handler->fileTransferError().toUtf8().constData());
+        return 2;
+    }
+
+    // 小文件可能在 start 内就已发送完毕
+    if (!handler->fileTransfer.isActive()) {
+        QString error = handler->fileTransfer.errorString();
+        lua_pushboolean(L, error.isEmpty());
+        lua_pushstring(L, error.isEmpty() ? "文件发送完成" : error.toUtf8().constData());
+        return 2;
+    }
+
+    if (handler->isCoroutineRunning && lua_isyieldable(L)) {
+        handler->waitingForFileTransfer = true;
+        return lua_yield(L, 0);
+    }
+
+    lua_pushboolean(L, 1);
+    lua_pushstring(L, "文件发送已开始");
+    return 2;
+}
+
+// Lua API - 获取发送队列深度(字节)
+int LuaBindings::lua_getTxQueueDepth(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    lua_pushinteger(L, handler->getTxQueueDepth());
+    return 1;
+}
+
+// Lua API - 设置发送队列 setTxQueueLimits(capacity, highWater, lowWater)
+int LuaBindings::lua_setTxQueueLimits(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->setTxQueueLimits(luaL_checkinteger(L, 1), luaL_checkinteger(L, 2), luaL_checkinteger(L, 3));
+    return 0;
+}
+
+// 将参数1的函数保存到注册表，替换旧的引用
+void LuaBindings::storeLuaCallback(lua_State *L, int &ref) {
+    luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    ref = LUA_NOREF;
+    if (!lua_isnoneornil(L, 1)) {
+        luaL_checktype(L, 1, LUA_TFUNCTION);
+        lua_pushvalue(L, 1);
+        ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+}
+
+// Lua API - 注册发送队列高水位回调 onTxHighWater(function(depth) end)
+int LuaBindings::lua_onTxHighWater(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    storeLuaCallback(L, handler->txHighWaterRef);
+    return 0;
+}
+
+// Lua API - 注册发送队列低水位回调 onTxLowWater(function(depth) end)
+int LuaBindings::lua_onTxLowWater(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    storeLuaCallback(L, handler->txLowWaterRef);
+    return 0;
+}
+
+// Lua API - 等待发送队列回落到低水位，返回当前深度
+int LuaBindings::lua_waitTxDrain(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    if (!handler->txQueue.isAboveHighWater() || !handler->isCoroutineRunning || !lua_isyieldable(L)) {
+        lua_pushinteger(L, handler->txQueue.depth());
+        return 1;
+    }
+
+    handler->waitingForTxDrain = true;
+    return lua_yield(L, 0);
+}
+
+// Lua API - 启用/关闭 RTU 帧间隔分帧 setRtuFraming(true)
+int LuaBindings::lua_setRtuFraming(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->setRtuFraming(lua_toboolean(L, 1));
+    return 0;
+}
+
+// Lua API - 丢弃字符间隔超过 t1.5 的 RTU 帧 setRtuStrictGap(true)，默认只计数
+// 间隔按读取时刻推算，需开启串口低延迟模式(界面"低延迟"或 --low-latency)，否则读取延迟会误判正常帧
+int LuaBindings::lua_setRtuStrictGap(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->setRtuStrictGap(lua_toboolean(L, 1));
+    return 0;
+}
+
+// Lua API - 获取字符时间和 t1.5/t3.5 及分帧计数，返回 {charUs=, t15Us=, t35Us=, frames=, gapFrames=}
+// gapFrames 为字符间隔超过 t1.5 的帧数，setRtuStrictGap(true) 时这些帧不交给脚本
+int LuaBindings::lua_getRtuTiming(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getRtuTiming());
+    return 1;
+}
+
+// Lua API - 创建虚拟串口 createVirtualSerial([mode])，返回端口名称，失败返回 nil, 错误信息
+int LuaBindings::lua_createVirtualSerial(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QString name = handler->createVirtualSerial(QString::fromUtf8(luaL_optstring(L, 1, "echo")));
+    if (name.isEmpty()) {
+        lua_pushnil(L);
+        lua_pushstring(L, handler->virtualSerial.errorString().toUtf8().constData());
+        return 2;
+    }
+    lua_pushstring(L, name.toUtf8().constData());
+    return 1;
+}
+
+// Lua API - 设置虚拟设备处理函数 setVirtualDeviceHandler(function(request) return response end)
+// 同时把虚拟串口切换到脚本模式
+int LuaBindings::lua_setVirtualDeviceHandler(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    storeLuaCallback(L, handler->virtualDeviceRef);
+    if (handler->virtualDeviceRef != LUA_NOREF) {
+        handler->virtualSerial.setMode(VirtualSerial::Script);
+    }
+    return 0;
+}
+
+// Lua API - 错误注入 setVirtualSerialErrors(dropRate, corruptRate[, delayMs])
+int LuaBindings::lua_setVirtualSerialErrors(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->setVirtualSerialErrors(luaL_checknumber(L, 1), luaL_checknumber(L, 2), luaL_optinteger(L, 3, 0));
+    return 0;
+}
+
+// Lua API - 设置虚拟从站寄存器 setVirtualRegister(address, value)
+int LuaBindings::lua_setVirtualRegister(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->setVirtualRegister(luaL_checkinteger(L, 1), luaL_checkinteger(L, 2));
+    return 0;
+}
+
+// Lua API - 获取虚拟串口统计 {requests=, responses=, dropped=, corrupted=, ...}
+int LuaBindings::lua_getVirtualSerialStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getVirtualSerialStats());
+    return 1;
+}
+
+// Lua API - 获取Lua内存统计
+int LuaBindings::lua_getLuaMemoryStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getLuaMemoryStats());
+    return 1;
+}
+
+// 触发器添加成功时把参数2的回调存入注册表并返回ID，失败返回 nil, 错误信息
+int LuaBindings::registerTrigger(lua_State *L, SerialHandler *handler, int id) {
+    if (id < 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, handler->triggerEngine.errorString().toUtf8().constData());
+        return 2;
+    }
+    lua_pushvalue(L, 2);
+    handler->triggerRefs.insert(id, luaL_ref(L, LUA_REGISTRYINDEX));
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+// Lua API - 添加字节模式触发器 addTrigger("01 03 ?? 0?", function(id, bytes) end[, once])
+// 模式为十六进制字节，'?' 为半字节通配；返回触发器ID
+int LuaBindings::lua_addTrigger(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    const char* pattern = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    int id = handler->triggerEngine.addPattern(QString::fromUtf8(pattern), lua_toboolean(L, 3));
+    return registerTrigger(L, handler, id);
+}
+
+// Lua API - 添加正则触发器 addRegexTrigger("OK\r\n", function(id, bytes) end[, once])
+int LuaBindings::lua_addRegexTrigger(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    const char* regex = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    int id = handler->triggerEngine.addRegex(QString::fromUtf8(regex), lua_toboolean(L, 3));
+    return registerTrigger(L, handler, id);
+}
+
+// Lua API - 移除触发器
+int LuaBindings::lua_removeTrigger(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int id = int(luaL_checkinteger(L, 1));
+    bool found = handler->triggerEngine.contains(id);
+    handler->removeScriptTrigger(id);
+    lua_pushboolean(L, found);
+    return 1;
+}
+
+// 挂起协程等待触发器 id 命中(-1 为任意数据)，超时参数在参数2
+// 恢复时返回 (true, 命中的字节) 或超时返回 false
+int LuaBindings::waitForTrigger(lua_State *L, SerialHandler *handler, int id) {
+    int timeout = int(luaL_optinteger(L, 2, handler->responseTimeout));
+    if (!handler->isCoroutineRunning || !lua_isyieldable(L)) {
+        handler->removeScriptTrigger(id);
+        lua_pushboolean(L, 0);
+        lua_pushstring(L, "只能在脚本协程中等待");
+        return 2;
+    }
+
+    handler->removeScriptTrigger(handler->waitTriggerId);
+    handler->waitTriggerId = id;
+    handler->waitingForResponse = true;
+    handler->responseTimer.start(timeout);
+    return lua_yield(L, 0);
+}
+
+// Lua API - 等待收到匹配的数据 waitFor("AA 55 ??"[, timeoutMs])，模式为 nil 时等待任意数据
+int LuaBindings::lua_waitFor(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int id = -1;
+    if (!lua_isnoneornil(L, 1)) {
+        id = handler->triggerEngine.addPattern(QString::fromUtf8(luaL_checkstring(L, 1)), true);
+        if (id < 0) {
+            lua_pushstring(L, handler->triggerEngine.errorString().toUtf8().constData());
+            return luaL_argerror(L, 1, lua_tostring(L, -1));
+        }
+    }
+    return waitForTrigger(L, handler, id);
+}
+
+// Lua API - 等待收到匹配正则的数据 waitForRegex("OK\r\n"[, timeoutMs])
+int LuaBindings::lua_waitForRegex(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    int id = handler->triggerEngine.addRegex(QString::fromUtf8(luaL_checkstring(L, 1)), true);
+    if (id < 0) {
+        lua_pushstring(L, handler->triggerEngine.errorString().toUtf8().constData());
+        return luaL_argerror(L, 1, lua_tostring(L, -1));
+    }
+    return waitForTrigger(L, handler, id);
+}
+
+// Lua API - 获取触发器统计 {triggers=, states=, scannedBytes=, skippedBytes=, candidates=, matches=, ...}
+int LuaBindings::lua_getTriggerStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getTriggerStats());
+    return 1;
+}
+
+// Lua API - 选择协议解析器 setDissector(name[, options])，name 为空或 "none" 时关闭
+// 返回 true，名称不存在时返回 nil, 错误信息
+int LuaBindings::lua_setDissector(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    if (handler->inLuaDissector) {
+        return luaL_error(L, "不能在解析函数中切换解析器");
+    }
+    QString name = QString::fromUtf8(luaL_optstring(L, 1, ""));
+    QVariantMap options;
+    if (lua_istable(L, 2)) {
+        options = toVariant(L, 2).toMap();
+    }
+    if (!handler->setDissector(name, options)) {
+        lua_pushnil(L);
+        lua_pushstring(L, QString("未知的解析器: %1").arg(name).toUtf8().constData());
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// Lua API - 注册脚本解析器 registerDissector(name, function(bytes) return consumed, fields, summary end)
+// consumed > 0 为一帧的字节数，0 为需要更多数据，< 0 为跳过的字节数；注册后用 setDissector(name) 启用
+int LuaBindings::lua_registerDissector(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QString name = QString::fromUtf8(luaL_checkstring(L, 1));
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    if (handler->inLuaDissector) {
+        return luaL_error(L, "不能在解析函数中注册解析器");
+    }
+
+    // 替换同名解析器时，正在使用的旧实例引用旧函数，一并关闭
+    if (handler->luaDissectorRefs.contains(name)) {
+        if (handler->dissector && handler->dissector->name() == name) {
+            handler->dissector.reset();
+        }
+        luaL_unref(L, LUA_REGISTRYINDEX, handler->luaDissectorRefs.take(name));
+    }
+    lua_pushvalue(L, 2);
+    handler->luaDissectorRefs.insert(name, luaL_ref(L, LUA_REGISTRYINDEX));
+    return 0;
+}
+
+// Lua API - 注册解析帧回调 onFrame(function(frame) end)
+// frame = {protocol=, offset=, raw=, valid=, summary=, fields={...}}
+int LuaBindings::lua_onFrame(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    storeLuaCallback(L, handler->frameCallbackRef);
+    return 0;
+}
+
+// Lua API - 获取可用的解析器名称列表
+int LuaBindings::lua_getDissectors(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getDissectorNames());
+    return 1;
+}
+
+// Lua API - 获取解析统计 {name=, frames=, invalid=, bytes=, skipped=, buffered=}
+int LuaBindings::lua_getDissectorStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getDissectorStats());
+    return 1;
+}
+
+// Lua API - 记录标签值 recordTag(tag, value[, timeMs])，timeMs 省略时取当前时间
+int LuaBindings::lua_recordTag(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QString tag = QString::fromUtf8(luaL_checkstring(L, 1));
+    double value = lua_isboolean(L, 2) ? (lua_toboolean(L, 2) ? 1.0 : 0.0) : luaL_checknumber(L, 2);
+    qint64 time = static_cast<qint64>(luaL_optinteger(L, 3, 0));
+    handler->tagStore.record(tag, value, time);
+    return 0;
+}
+
+// Lua API - 获取标签最新值 getTag(tag)，返回 value, timeMs，没有数据时返回 nil
+int LuaBindings::lua_getTag(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QVariantMap latest = handler->tagStore.latest(QString::fromUtf8(luaL_checkstring(L, 1)));
+    if (latest.isEmpty()) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushnumber(L, latest.value("value").toDouble());
+    lua_pushinteger(L, latest.value("time").toLongLong());
+    return 2;
+}
+
+// Lua API - 按时间范围查询 queryTag(tag, fromMs, toMs[, bucketMs])
+// 不带 bucketMs 返回原始点 {{time=, value=}, ...}，带 bucketMs 返回 {{time=, min=, max=, avg=, count=}, ...}
+int LuaBindings::lua_queryTag(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QString tag = QString::fromUtf8(luaL_checkstring(L, 1));
+    qint64 from = static_cast<qint64>(luaL_checkinteger(L, 2));
+    qint64 to = static_cast<qint64>(luaL_checkinteger(L, 3));
+    qint64 bucketMs = static_cast<qint64>(luaL_optinteger(L, 4, 0));
+    if (bucketMs > 0) {
+        pushVariant(L, handler->tagStore.queryBuckets(tag, from, to, bucketMs));
+    } else {
+        pushVariant(L, handler->tagStore.query(tag, from, to));
+    }
+    return 1;
+}
+
+// Lua API - 获取标签名列表
+int LuaBindings::lua_getTags(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->tagStore.tags());
+    return 1;
+}
+
+// Lua API - 获取标签存储统计 {tags=, points=, compressedBytes=, bytesPerPoint=, buckets=, ...}
+int LuaBindings::lua_getTagStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->tagStore.getStats());
+    return 1;
+}
+
+// 导出失败时压入 nil, 错误信息
+static int pushExportError(lua_State *L, const QString &format, const QString &error) {
+    ExportWriter::Format exportFormat;
+    lua_pushnil(L);
+    if (!ExportWriter::formatFromString(format, &exportFormat)) {
+        lua_pushstring(L, QString("未知的导出格式: %1").arg(format).toUtf8().constData());
+    } else {
+        lua_pushstring(L, error.toUtf8().constData());
+    }
+    return 2;
+}
+
+// Lua API - 开始录制收发数据 startCapture(path[, format])，format 为 "csv"(默认) 或 "columnar"
+// 返回 true，失败时返回 nil, 错误信息
+int LuaBindings::lua_startCapture(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QString path = QString::fromUtf8(luaL_checkstring(L, 1));
+    QString format = QString::fromUtf8(luaL_optstring(L, 2, "csv"));
+    if (handler->isCapturing()) {
+        lua_pushnil(L);
+        lua_pushstring(L, "已在录制");
+        return 2;
+    }
+    if (!handler->startCapture(path, format)) {
+        return pushExportError(L, format, handler->exportError());
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// Lua API - 停止录制，等待后台写完后返回是否成功
+int LuaBindings::lua_stopCapture(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    lua_pushboolean(L, handler->stopCapture());
+    return 1;
+}
+
+// Lua API - 导出标签历史 exportTags(path[, format[, tags[, fromMs[, toMs]]]])，tags 为标签名数组，省略时导出全部
+// 导出在后台进行，返回 true；失败时返回 nil, 错误信息；进度见 getExportStats()
+int LuaBindings::lua_exportTags(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QString path = QString::fromUtf8(luaL_checkstring(L, 1));
+    QString format = QString::fromUtf8(luaL_optstring(L, 2, "csv"));
+    QStringList tags;
+    if (lua_istable(L, 3)) {
+        const lua_Integer count = luaL_len(L, 3);
+        for (lua_Integer i = 1; i <= count; i++) {
+            lua_geti(L, 3, i);
+            if (lua_type(L, -1) == LUA_TSTRING) {
+                tags.append(QString::fromUtf8(lua_tostring(L, -1)));
+            }
+            lua_pop(L, 1);
+        }
+    }
+    qint64 from = static_cast<qint64>(luaL_optinteger(L, 4, 0));
+    qint64 to = static_cast<qint64>(luaL_optinteger(L, 5, 0));
+    if (!handler->exportTags(path, format, tags, from, to)) {
+        return pushExportError(L, format, handler->exportError());
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// Lua API - 获取导出统计 {capturing=, captureFile=, captureRows=, captureBytes=, exporting=, exportRows=, ...}
+int LuaBindings::lua_getExportStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getExportStats());
+    return 1;
+}
+
+// Lua API - 添加轮询组 addPoll{unit=1, func=3, addr=0, count=10, period=100, priority=0, deadline=100, format="UINT16", deadband=0}
+// 返回组ID，失败时返回 nil, 错误信息
+int LuaBindings::lua_addPoll(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int id = handler->addPollGroup(toVariant(L, 1).toMap());
+    if (id < 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, handler->pollError().toUtf8().constData());
+        return 2;
+    }
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+// Lua API - 移除轮询组 removePoll(id)
+int LuaBindings::lua_removePoll(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    lua_pushboolean(L, handler->removePollGroup(int(luaL_checkinteger(L, 1))));
+    return 1;
+}
+
+// Lua API - 移除全部轮询组
+int LuaBindings::lua_clearPolls(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->clearPollGroups();
+    return 0;
+}
+
+// Lua API - 开始轮询 startPolling([{protocol="rtu"/"tcp", timeout=ms, failureThreshold=, probeInterval=ms, maxBackoff=ms, turnaround=ms, readWrite=false}])
+// 轮询在 C++ 中进行，脚本结束后继续；返回 true，协议名无效时返回 nil, 错误信息
+int LuaBindings::lua_startPolling(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QVariantMap options;
+    if (lua_istable(L, 1)) {
+        options = toVariant(L, 1).toMap();
+    }
+    if (!handler->startPolling(options)) {
+        lua_pushnil(L);
+        lua_pushstring(L, QString("未知的协议: %1").arg(options.value("protocol").toString()).toUtf8().constData());
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// Lua API - 停止轮询
+int LuaBindings::lua_stopPolling(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    handler->stopPolling();
+    return 0;
+}
+
+// Lua API - 获取轮询统计，每组 {id=, unit=, func=, polls=, responses=, timeouts=, misses=, maxLateMs=, actualPeriodMs=, backoffMs=, ...}
+int LuaBindings::lua_getPollStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getPollStats());
+    return 1;
+}
+
+// Lua API - 获取从站健康状态，每个从站 {unit=, state="closed"/"open"/"half-open", failures=, timeouts=, crcErrors=, trips=, retryMs=, ...}
+int LuaBindings::lua_getPollUnits(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getPollUnitStats());
+    return 1;
+}
+
+// Lua API - 注册轮询值变化回调 onPollChange(function(id, changes) end)
+// changes = {{tag=, addr=, value=, previous=}, ...}，只包含变化的值，传 nil 取消
+int LuaBindings::lua_onPollChange(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    storeLuaCallback(L, handler->pollChangeRef);
+    return 0;
+}
+
+// Lua API - 排队写入 modbusWrite{unit=1, addr=10, value=100} / modbusWrite{unit=1, addr=0, values={1, 0, 1}, coil=true, priority=0}
+// 相邻的写合并为一帧，与轮询按优先级交替发送；返回写ID，参数不合法时返回 nil, 错误信息
+int LuaBindings::lua_modbusWrite(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int id = handler->queueWrite(toVariant(L, 1).toMap());
+    if (id < 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, handler->pollError().toUtf8().constData());
+        return 2;
+    }
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+// Lua API - 获取写统计 {queued=, merged=, frames=, readWriteFrames=, ok=, failed=, pending=, meanLatencyMs=, maxLatencyMs=}
+int LuaBindings::lua_getWriteStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getWriteStats());
+    return 1;
+}
+
+// Lua API - 检索会话历史 searchHistory{from=, to=, direction="rx"/"tx", transport=, hex= 或 text=, limit=, oldestFirst=}
+// 返回数组 {index=, time=, direction=, transport=, size=, hex=, match=, carried=}，默认最新的在前
+// 模式可以从同方向同传输方式的前面记录开始，carried 为其中在前面记录里的字节数
+int LuaBindings::lua_searchHistory(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    QVariantMap filter;
+    if (lua_istable(L, 1)) {
+        filter = toVariant(L, 1).toMap();
+    }
+    pushVariant(L, handler->searchHistory(filter));
+    return 1;
+}
+
+// Lua API - 获取会话历史统计 {frames=, bytes=, blocks=, indexBytes=, lastScannedBlocks=, lastSearchMs=, ...}
+int LuaBindings::lua_getHistoryStats(lua_State *L) {
+    SerialHandler* handler = getSerialHandler(L);
+    if (!handler) return 0;
+
+    pushVariant(L, handler->getHistoryStats());
+    return 1;
+}
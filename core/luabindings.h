@@ -0,0 +1,90 @@
+#ifndef LUABINDINGS_H
+#define LUABINDINGS_H
+
+#include <QVariant>
+
+struct lua_State;
+class SerialHandler;
+
+// LuaBindings 脚本可调用的 C 函数，注册到 SerialHandler 的 Lua 状态中
+// 作为 SerialHandler 的友元直接访问其连接、队列和协程状态
+class LuaBindings {
+public:
+    static void install(lua_State *L, SerialHandler *handler);
+
+    // 将QVariant压入Lua栈（Map转为table，List转为数组table）
+    static void pushVariant(lua_State *L, const QVariant &value);
+    // 将Lua值转为QVariant（数组table转为List，其他table转为Map）
+    static QVariant toVariant(lua_State *L, int index, int depth = 0);
+
+private:
+    static SerialHandler *getSerialHandler(lua_State *L);
+    static void storeLuaCallback(lua_State *L, int &ref);
+    static int registerTrigger(lua_State *L, SerialHandler *handler, int id);
+    static int waitForTrigger(lua_State *L, SerialHandler *handler, int id);
+
+    static int lua_send(lua_State *L);
+    static int lua_sendHex(lua_State *L);
+    static int lua_sleep(lua_State *L);
+    static int lua_print(lua_State *L);
+    static int lua_log(lua_State *L);
+    static int lua_setLogLevel(lua_State *L);
+    static int lua_getLogLevel(lua_State *L);
+    static int lua_flushLog(lua_State *L);
+    static int lua_getLastData(lua_State *L);
+    static int lua_setResponseTimeout(lua_State *L);
+    static int lua_addPeriodic(lua_State *L);
+    static int lua_removePeriodic(lua_State *L);
+    static int lua_startPeriodic(lua_State *L);
+    static int lua_stopPeriodic(lua_State *L);
+    static int lua_getPeriodicStats(lua_State *L);
+    static int lua_sendFile(lua_State *L);
+    static int lua_getTxQueueDepth(lua_State *L);
+    static int lua_setTxQueueLimits(lua_State *L);
+    static int lua_onTxHighWater(lua_State *L);
+    static int lua_onTxLowWater(lua_State *L);
+    static int lua_waitTxDrain(lua_State *L);
+    static int lua_setRtuFraming(lua_State *L);
+    static int lua_setRtuStrictGap(lua_State *L);
+    static int lua_getRtuTiming(lua_State *L);
+    static int lua_createVirtualSerial(lua_State *L);
+    static int lua_setVirtualDeviceHandler(lua_State *L);
+    static int lua_setVirtualSerialErrors(lua_State *L);
+    static int lua_setVirtualRegister(lua_State *L);
+    static int lua_getVirtualSerialStats(lua_State *L);
+    static int lua_getLuaMemoryStats(lua_State *L);
+    static int lua_addTrigger(lua_State *L);
+    static int lua_addRegexTrigger(lua_State *L);
+    static int lua_removeTrigger(lua_State *L);
+    static int lua_waitFor(lua_State *L);
+    static int lua_waitForRegex(lua_State *L);
+    static int lua_getTriggerStats(lua_State *L);
+    static int lua_setDissector(lua_State *L);
+    static int lua_registerDissector(lua_State *L);
+    static int lua_onFrame(lua_State *L);
+    static int lua_getDissectors(lua_State *L);
+    static int lua_getDissectorStats(lua_State *L);
+    static int lua_recordTag(lua_State *L);
+    static int lua_getTag(lua_State *L);
+    static int lua_queryTag(lua_State *L);
+    static int lua_getTags(lua_State *L);
+    static int lua_getTagStats(lua_State *L);
+    static int lua_startCapture(lua_State *L);
+    static int lua_stopCapture(lua_State *L);
+    static int lua_exportTags(lua_State *L);
+    static int lua_getExportStats(lua_State *L);
+    static int lua_addPoll(lua_State *L);
+    static int lua_removePoll(lua_State *L);
+    static int lua_clearPolls(lua_State *L);
+    static int lua_startPolling(lua_State *L);
+    static int lua_stopPolling(lua_State *L);
+    static int lua_getPollStats(lua_State *L);
+    static int lua_getPollUnits(lua_State *L);
+    static int lua_onPollChange(lua_State *L);
+    static int lua_modbusWrite(lua_State *L);
+    static int lua_getWriteStats(lua_State *L);
+    static int lua_searchHistory(lua_State *L);
+    static int lua_getHistoryStats(lua_State *L);
+};
+
+#endif // LUABINDINGS_H
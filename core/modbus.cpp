@@ -0,0 +1,350 @@
+#include "modbus.h"
+#include "codec.h"
+
+#include <cstring>
+
+namespace Modbus {
+
+namespace {
+
+quint16 readBigEndian16(const uchar *p) {
+    return quint16(p[0] << 8 | p[1]);
+}
+
+void appendBigEndian16(QByteArray &out, int value) {
+    out.append(char((value >> 8) & 0xFF));
+    out.append(char(value & 0xFF));
+}
+
+// 两个寄存器按格式拼成 32 位，报文字节依次为 x1 x2 x3 x4
+quint32 combine32(quint16 high, quint16 low, DataFormat format) {
+    const quint32 x1 = high >> 8, x2 = high & 0xFF, x3 = low >> 8, x4 = low & 0xFF;
+    switch (format) {
+    case Float32Badc:
+    case Int32Badc:
+        return x2 << 24 | x1 << 16 | x4 << 8 | x3;
+    case Float32Cdab:
+    case Int32Cdab:
+        return x3 << 24 | x4 << 16 | x1 << 8 | x2;
+    case Float32Dcba:
+    case Int32Dcba:
+        return x4 << 24 | x3 << 16 | x2 << 8 | x1;
+    default:
+        return x1 << 24 | x2 << 16 | x3 << 8 | x4;
+    }
+}
+
+// PDU 各字段；写多个时附带字节数和数据
+void appendPdu(QByteArray &frame, const Request &request) {
+    frame.append(char(request.function));
+    const int count = request.values.size();
+    switch (request.function) {
+    case WriteSingleCoil:
+        appendBigEndian16(frame, request.address);
+        appendBigEndian16(frame, request.values.value(0) ? 0xFF00 : 0x0000);
+        break;
+    case WriteSingleRegister:
+        appendBigEndian16(frame, request.address);
+        appendBigEndian16(frame, request.values.value(0));
+        break;
+    case WriteMultipleCoils: {
+        appendBigEndian16(frame, request.address);
+        appendBigEndian16(frame, count);
+        QByteArray bits((count + 7) / 8, 0);
+        for (int i = 0; i < count; i++) {
+            if (request.values[i]) {
+                bits[i >> 3] = char(uchar(bits[i >> 3]) | (1 << (i & 7)));
+            }
+        }
+        frame.append(char(bits.size()));
+        frame.append(bits);
+        break;
+    }
+    case WriteMultipleRegisters:
+    case ReadWriteMultipleRegisters:
+        appendBigEndian16(frame, request.address);
+        appendBigEndian16(frame, request.function == WriteMultipleRegisters ? count : request.count);
+        if (request.function == ReadWriteMultipleRegisters) {
+            appendBigEndian16(frame, request.writeAddress);
+            appendBigEndian16(frame, count);
+        }
+        frame.append(char(count * 2));
+        for (quint16 value : request.values) {
+            appendBigEndian16(frame, value);
+        }
+        break;
+    default:
+        appendBigEndian16(frame, request.address);
+        appendBigEndian16(frame, request.count);
+        break;
+    }
+}
+
+} // namespace
+
+bool isBitFunction(int function) {
+    return function == ReadCoils || function == ReadDiscreteInputs;
+}
+
+bool isWriteFunction(int function) {
+    return function == WriteSingleCoil || function == WriteSingleRegister || function == WriteMultipleCoils
+           || function == WriteMultipleRegisters || function == ReadWriteMultipleRegisters;
+}
+
+bool isValidRead(const Request &request, QString *error) {
+    QString message;
+    if (request.unit < 0 || request.unit > 255) {
+        message = QString("站号超出范围: %1").arg(request.unit);
+    } else if (request.function < ReadCoils || request.function > ReadInputRegisters) {
+        message = QString("不支持的功能码: %1").arg(request.function);
+    } else if (request.count < 1 || request.count > (isBitFunction(request.function) ? 2000 : 125)) {
+        message = QString("数量超出范围: %1").arg(request.count);
+    } else if (request.address < 0 || request.address + request.count > 0x10000) {
+        message = QString("地址超出范围: %1").arg(request.address);
+    }
+    if (error) {
+        *error = message;
+    }
+    return message.isEmpty();
+}
+
+bool isValidWrite(const Request &request, QString *error) {
+    QString message;
+    const int count = request.values.size();
+    if (request.unit < 0 || request.unit > 255) {
+        message = QString("站号超出范围: %1").arg(request.unit);
+    } else if (!isWriteFunction(request.function)) {
+        message = QString("不支持的功能码: %1").arg(request.function);
+    } else if (count < 1
+               || ((request.function == WriteSingleCoil || request.function == WriteSingleRegister) && count != 1)
+               || (request.function == WriteMultipleCoils && count > 1968)
+               || (request.function == WriteMultipleRegisters && count > 123)
+               || (request.function == ReadWriteMultipleRegisters && count > 121)) {
+        message = QString("写入数量超出范围: %1").arg(count);
+    } else {
+        const int address = request.function == ReadWriteMultipleRegisters ? request.writeAddress : request.address;
+        if (address < 0 || address + count > 0x10000) {
+            message = QString("地址超出范围: %1").arg(address);
+        } else if (request.function == ReadWriteMultipleRegisters) {
+            Request read = request;
+            read.function = ReadHoldingRegisters;
+            isValidRead(read, &message);
+        }
+    }
+    if (error) {
+        *error = message;
+    }
+    return message.isEmpty();
+}
+
+QByteArray encodeRequest(const Request &request, Protocol protocol, quint16 transaction) {
+    QByteArray frame;
+    frame.reserve(12 + request.values.size() * 2);
+    if (protocol == Tcp) {
+        appendBigEndian16(frame, transaction);
+        appendBigEndian16(frame, 0);
+        appendBigEndian16(frame, 0);  // 长度在 PDU 写完后填入
+    }
+    frame.append(char(request.unit));
+    appendPdu(frame, request);
+    if (protocol == Tcp) {
+        const int length = frame.size() - 6;
+        frame[4] = char(length >> 8);
+        frame[5] = char(length & 0xFF);
+    }
+    if (protocol == Rtu) {
+        const quint16 crc = Codec::modbusCrc16(frame.constData(), frame.size());
+        frame.append(char(crc & 0xFF));
+        frame.append(char(crc >> 8));
+    }
+    return frame;
+}
+
+int responseLength(const char *data, int size, Protocol protocol) {
+    const uchar *d = reinterpret_cast<const uchar *>(data);
+    if (protocol == Tcp) {
+        if (size < 6) {
+            return 0;
+        }
+        const int length = readBigEndian16(d + 4);
+        if (readBigEndian16(d + 2) != 0 || length < 2 || length > 254) {
+            return -1;
+        }
+        return 6 + length;
+    }
+
+    if (size < 2) {
+        return 0;
+    }
+    const int function = d[1];
+    if (function & 0x80) {
+        return 5;
+    }
+    if ((function >= ReadCoils && function <= ReadInputRegisters) || function == ReadWriteMultipleRegisters) {
+        return size < 3 ? 0 : 5 + d[2];
+    }
+    if (function == WriteSingleCoil || function == WriteSingleRegister
+        || function == WriteMultipleCoils || function == WriteMultipleRegisters) {
+        return 8;  // 回显地址和值/数量
+    }
+    return -1;
+}
+
+Response decodeResponse(const char *data, int size, Protocol protocol, const Request &request, quint16 transaction) {
+    Response response;
+    const uchar *d = reinterpret_cast<const uchar *>(data);
+
+    // 统一为 站号 + PDU
+    if (protocol == Tcp) {
+        if (size < 8) {
+            return response;
+        }
+        if (readBigEndian16(d) != transaction) {
+            response.status = Mismatch;
+            return response;
+        }
+        d += 6;
+        size -= 6;
+    } else {
+        if (size < 5) {
+            return response;
+        }
+        const quint16 crc = Codec::modbusCrc16(data, size - 2);
+        if (d[size - 2] != (crc & 0xFF) || d[size - 1] != (crc >> 8)) {
+            response.status = CrcError;
+            return response;
+        }
+        size -= 2;
+    }
+
+    if (d[0] != request.unit) {
+        return response;
+    }
+    const int function = d[1];
+    if (function == (request.function | 0x80)) {
+        if (size >= 3) {
+            response.status = Exception;
+            response.exception = d[2];
+        }
+        return response;
+    }
+    if (function != request.function) {
+        return response;
+    }
+
+    // 写单个回显地址和值，写多个回显地址和数量
+    if (function == WriteSingleCoil || function == WriteSingleRegister
+        || function == WriteMultipleCoils || function == WriteMultipleRegisters) {
+        if (size != 6 || readBigEndian16(d + 2) != request.address) {
+            return response;
+        }
+        const int echo = readBigEndian16(d + 4);
+        int expected = request.values.size();
+        if (function == WriteSingleCoil) {
+            expected = request.values.value(0) ? 0xFF00 : 0x0000;
+        } else if (function == WriteSingleRegister) {
+            expected = request.values.value(0);
+        }
+        if (echo != expected) {
+            return response;
+        }
+        response.status = Ok;
+        return response;
+    }
+
+    if (size < 3 || d[2] != size - 3) {
+        return response;
+    }
+
+    const int byteCount = d[2];
+    const uchar *payload = d + 3;
+    if (isBitFunction(function)) {
+        if (byteCount != (request.count + 7) / 8) {
+            return response;
+        }
+        response.values.resize(request.count);
+        for (int i = 0; i < request.count; i++) {
+            response.values[i] = (payload[i >> 3] >> (i & 7)) & 1;
+        }
+    } else {
+        if (byteCount != request.count * 2) {
+            return response;
+        }
+        response.values.resize(request.count);
+        for (int i = 0; i < request.count; i++) {
+            response.values[i] = readBigEndian16(payload + i * 2);
+        }
+    }
+    response.status = Ok;
+    return response;
+}
+
+int formatWidth(DataFormat format) {
+    return format == UInt16 || format == Int16 ? 1 : 2;
+}
+
+int decodeValues(const QVector<quint16> &registers, DataFormat format, QVector<double> &values) {
+    const int width = formatWidth(format);
+    const int count = registers.size() / width;
+    values.resize(count);
+    for (int i = 0; i < count; i++) {
+        switch (format) {
+        case UInt16:
+            values[i] = registers[i];
+            break;
+        case Int16:
+            values[i] = qint16(registers[i]);
+            break;
+        case Float32Abcd:
+        case Float32Badc:
+        case Float32Cdab:
+        case Float32Dcba: {
+            const quint32 bits = combine32(registers[i * 2], registers[i * 2 + 1], format);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            values[i] = value;
+            break;
+        }
+        default:
+            values[i] = qint32(combine32(registers[i * 2], registers[i * 2 + 1], format));
+            break;
+        }
+    }
+    return count;
+}
+
+bool formatFromString(const QString &name, DataFormat *format) {
+    static const struct {
+        const char *name;
+        DataFormat format;
+    } formats[] = {
+        {"UINT16", UInt16}, {"HEX", UInt16}, {"INT16", Int16},
+        {"FLOAT_ABCD", Float32Abcd}, {"FLOAT_BADC", Float32Badc},
+        {"FLOAT_CDAB", Float32Cdab}, {"FLOAT_DCBA", Float32Dcba},
+        {"LONG_ABCD", Int32Abcd}, {"LONG_BADC", Int32Badc},
+        {"LONG_CDAB", Int32Cdab}, {"LONG_DCBA", Int32Dcba},
+    };
+    const QString upper = name.toUpper();
+    for (const auto &entry : formats) {
+        if (upper == QLatin1String(entry.name)) {
+            *format = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool protocolFromString(const QString &name, Protocol *protocol) {
+    const QString lower = name.toLower();
+    if (lower == "rtu") {
+        *protocol = Rtu;
+        return true;
+    }
+    if (lower == "tcp") {
+        *protocol = Tcp;
+        return true;
+    }
+    return false;
+}
+
+} // namespace Modbus
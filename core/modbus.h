@@ -0,0 +1,93 @@
+#ifndef MODBUS_H
+#define MODBUS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Modbus 主站报文：请求编码、应答成帧和解码，RTU 与 TCP(MBAP) 共用同一个 PDU 处理
+namespace Modbus {
+
+enum Protocol {
+    Rtu,  // 站号 + PDU + CRC16
+    Tcp   // MBAP 头(事务、协议 0、长度、单元) + PDU
+};
+
+enum Function {
+    ReadCoils = 0x01,
+    ReadDiscreteInputs = 0x02,
+    ReadHoldingRegisters = 0x03,
+    ReadInputRegisters = 0x04,
+    WriteSingleCoil = 0x05,
+    WriteSingleRegister = 0x06,
+    WriteMultipleCoils = 0x0F,
+    WriteMultipleRegisters = 0x10,
+    ReadWriteMultipleRegisters = 0x17
+};
+
+// 寄存器值的解释方式，32 位格式占两个寄存器；字母表示字节在报文中的顺序
+enum DataFormat {
+    UInt16,
+    Int16,
+    Float32Abcd,
+    Float32Badc,
+    Float32Cdab,
+    Float32Dcba,
+    Int32Abcd,
+    Int32Badc,
+    Int32Cdab,
+    Int32Dcba
+};
+
+// 读功能码和 0x17 的 address/count 为读范围；写功能码的 address 为写起始，count 为写入个数
+struct Request {
+    int unit = 1;
+    int function = ReadHoldingRegisters;
+    int address = 0;
+    int count = 1;
+    int writeAddress = 0;       // 仅 0x17
+    QVector<quint16> values;    // 写入值，线圈每点一个 0/1
+};
+
+enum Status {
+    Ok,
+    Exception,   // 从站返回异常码
+    CrcError,
+    Malformed,   // 站号、功能码或长度与请求不符
+    Mismatch,    // TCP 事务号不符(迟到的旧应答)，丢弃后继续等待
+    Timeout      // 超时未收到完整应答，由调用方判定
+};
+
+struct Response {
+    Status status = Malformed;
+    int exception = 0;
+    QVector<quint16> values;  // 寄存器值；线圈/离散输入每点一个 0/1；写功能码为空
+};
+
+bool isBitFunction(int function);
+bool isWriteFunction(int function);
+// 读功能码 01~04，数量和地址在协议范围内
+bool isValidRead(const Request &request, QString *error = nullptr);
+// 写功能码 05/06/0F/10/17，values 个数与功能码相符(0x17 的读范围同 0x03)
+bool isValidWrite(const Request &request, QString *error = nullptr);
+
+QByteArray encodeRequest(const Request &request, Protocol protocol, quint16 transaction = 0);
+
+// 应答帧的总长度：已能确定时返回长度，字节不够时返回 0，不可能是应答的起始字节时返回 -1
+int responseLength(const char *data, int size, Protocol protocol);
+
+// 解码一帧完整应答(长度由 responseLength 得出)
+Response decodeResponse(const char *data, int size, Protocol protocol, const Request &request, quint16 transaction = 0);
+
+// 按格式把寄存器转为数值，位功能码原样转换；返回值个数，32 位格式为寄存器数的一半
+int decodeValues(const QVector<quint16> &registers, DataFormat format, QVector<double> &values);
+// 每个值占用的寄存器数
+int formatWidth(DataFormat format);
+
+// "UINT16"/"INT16"/"HEX"/"FLOAT_ABCD"/"LONG_CDAB"... 与轮询脚本的 DATA_FORMATS 一致，不区分大小写
+bool formatFromString(const QString &name, DataFormat *format);
+bool protocolFromString(const QString &name, Protocol *protocol);
+
+} // namespace Modbus
+
+#endif // MODBUS_H
@@ -0,0 +1,181 @@
+#include "periodicsender.h"
+
+#include <QVariantMap>
+#include <cmath>
+#include <limits>
+
+void PeriodicSender::JitterStats::add(double us) {
+    samples++;
+    if (samples == 1) {
+        minUs = maxUs = us;
+    } else {
+        minUs = qMin(minUs, us);
+        maxUs = qMax(maxUs, us);
+    }
+    double delta = us - meanUs;
+    meanUs += delta / samples;
+    m2 += delta * (us - meanUs);
+}
+
+PeriodicSender::PeriodicSender(QObject *parent) : QObject(parent) {
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &PeriodicSender::onTimeout);
+}
+
+int PeriodicSender::addFrame(const QByteArray &data, double periodMs, double phaseMs) {
+    if (data.isEmpty() || periodMs <= 0.0) {
+        return -1;
+    }
+
+    Frame frame;
+    frame.id = nextId++;
+    frame.data = data;
+    frame.periodNs = qMax<qint64>(1, qint64(periodMs * 1000000.0));
+    frame.phaseNs = qMax<qint64>(0, qint64(phaseMs * 1000000.0));
+    frame.nextDueNs = running ? clock.nsecsElapsed() + frame.phaseNs : frame.phaseNs;
+    frames.append(frame);
+
+    if (running) {
+        scheduleNext();
+    }
+    return frame.id;
+}
+
+bool PeriodicSender::removeFrame(int id) {
+    for (int i = 0; i < frames.size(); i++) {
+        if (frames[i].id == id) {
+            frames.removeAt(i);
+            if (running) {
+                scheduleNext();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void PeriodicSender::clear() {
+    frames.clear();
+    timer.stop();
+}
+
+void PeriodicSender::start() {
+    if (running) {
+        return;
+    }
+
+    running = true;
+    clock.start();
+    for (Frame &frame : frames) {
+        frame.nextDueNs = frame.phaseNs;
+    }
+    scheduleNext();
+}
+
+void PeriodicSender::stop() {
+    running = false;
+    timer.stop();
+}
+
+void PeriodicSender::setSpinThresholdUs(int us) {
+    spinNs = qMax(0, us) * 1000LL;
+    if (running) {
+        scheduleNext();
+    }
+}
+
+QVariantList PeriodicSender::statistics() const {
+    QVariantList result;
+    for (const Frame &frame : frames) {
+        const JitterStats &s = frame.stats;
+        QVariantMap item;
+        item["id"] = frame.id;
+        item["periodMs"] = frame.periodNs / 1000000.0;
+        item["samples"] = s.samples;
+        item["overruns"] = s.overruns;
+        item["minUs"] = s.minUs;
+        item["maxUs"] = s.maxUs;
+        item["meanUs"] = s.meanUs;
+        item["stddevUs"] = s.samples > 1 ? std::sqrt(s.m2 / (s.samples - 1)) : 0.0;
+        result.append(item);
+    }
+    return result;
+}
+
+void PeriodicSender::resetStatistics() {
+    for (Frame &frame : frames) {
+        frame.stats = JitterStats();
+    }
+}
+
+void PeriodicSender::onTimeout() {
+    if (!running || frames.isEmpty()) {
+        return;
+    }
+
+    qint64 now = clock.nsecsElapsed();
+    qint64 due = earliestDue();
+
+    // 距离目标时刻不足忙等阈值时自旋等待，规避定时器的毫秒级粒度
+    if (due > now) {
+        if (due - now > spinNs) {
+            scheduleNext();
+            return;
+        }
+        while (now < due) {
+            now = clock.nsecsElapsed();
+        }
+    }
+
+    // 按下标遍历，frameDue 的槽函数可能增删帧
+    for (int i = 0; i < frames.size(); i++) {
+        if (frames[i].nextDueNs > now) {
+            continue;
+        }
+
+        qint64 sentAt = clock.nsecsElapsed();
+        frames[i].stats.add((sentAt - frames[i].nextDueNs) / 1000.0);
+        int id = frames[i].id;
+        QByteArray data = frames[i].data;
+
+        // 以上次计划时刻为基准推进，处理耗时不会累积成漂移
+        frames[i].nextDueNs += frames[i].periodNs;
+        if (frames[i].nextDueNs <= sentAt) {
+            qint64 missed = (sentAt - frames[i].nextDueNs) / frames[i].periodNs + 1;
+            frames[i].nextDueNs += missed * frames[i].periodNs;
+            frames[i].stats.overruns += missed;
+        }
+
+        emit frameDue(id, data);
+    }
+
+    scheduleNext();
+}
+
+void PeriodicSender::scheduleNext() {
+    if (!running || frames.isEmpty()) {
+        timer.stop();
+        return;
+    }
+
+    qint64 waitNs = earliestDue() - clock.nsecsElapsed();
+    int waitMs = 0;
+    if (spinNs > 0) {
+        // 提前醒来，剩下的交给忙等
+        waitNs -= spinNs;
+        waitMs = waitNs > 0 ? int(waitNs / 1000000) : 0;
+    } else {
+        // 不忙等时向上取整，避免提前醒来空转
+        waitMs = waitNs > 0 ? int((waitNs + 999999) / 1000000) : 0;
+    }
+    timer.start(waitMs);
+}
+
+qint64 PeriodicSender::earliestDue() const {
+    qint64 due = std::numeric_limits<qint64>::max();
+    for (const Frame &frame : frames) {
+        due = qMin(due, frame.nextDueNs);
+    }
+    return due;
+}
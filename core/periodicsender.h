@@ -0,0 +1,76 @@
+#ifndef PERIODICSENDER_H
+#define PERIODICSENDER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+#include <QVariantList>
+
+// PeriodicSender 定时发送引擎
+// 每帧独立周期/相位，按单调时钟的绝对时刻排程（不累计处理耗时造成的漂移），
+// 最后不足 spinThresholdUs 的等待可用忙等补足，实现亚毫秒级精度
+class PeriodicSender : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PeriodicSender(QObject *parent = nullptr);
+
+    // 添加一帧，返回帧ID；periodMs 周期，phaseMs 相对启动时刻的相位偏移
+    int addFrame(const QByteArray &data, double periodMs, double phaseMs = 0.0);
+    bool removeFrame(int id);
+    void clear();
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    // 忙等阈值（微秒），0 表示只用定时器
+    void setSpinThresholdUs(int us);
+    int spinThresholdUs() const { return spinNs / 1000; }
+
+    // 每帧的抖动统计（微秒）
+    QVariantList statistics() const;
+    void resetStatistics();
+
+signals:
+    void frameDue(int id, const QByteArray &data);
+
+private slots:
+    void onTimeout();
+
+private:
+    // 抖动统计，Welford 算法累计均值和方差
+    struct JitterStats {
+        qint64 samples = 0;
+        qint64 overruns = 0;   // 落后超过一个周期而跳过的次数
+        double minUs = 0.0;
+        double maxUs = 0.0;
+        double meanUs = 0.0;
+        double m2 = 0.0;
+
+        void add(double us);
+    };
+
+    struct Frame {
+        int id = 0;
+        QByteArray data;
+        qint64 periodNs = 0;
+        qint64 phaseNs = 0;
+        qint64 nextDueNs = 0;  // 下次发送的绝对时刻（相对 clock 起点）
+        JitterStats stats;
+    };
+
+    void scheduleNext();
+    qint64 earliestDue() const;
+
+    QList<Frame> frames;
+    QElapsedTimer clock;       // 单调时钟
+    QTimer timer;              // 粗粒度唤醒定时器
+    qint64 spinNs = 0;         // 忙等阈值(纳秒)
+    int nextId = 1;
+    bool running = false;
+};
+
+#endif // PERIODICSENDER_H
@@ -0,0 +1,761 @@
+#include "pollscheduler.h"
+#include "tagstore.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+static QString statusText(const Modbus::Response &response) {
+    switch (response.status) {
+    case Modbus::Ok:
+        return QString();
+    case Modbus::Exception:
+        return QString("异常码 0x%1").arg(response.exception, 2, 16, QChar('0'));
+    case Modbus::CrcError:
+        return QStringLiteral("CRC 错误");
+    case Modbus::Timeout:
+        return QStringLiteral("超时");
+    default:
+        return QStringLiteral("应答与请求不符");
+    }
+}
+
+PollScheduler::PollScheduler(TagStore *store, QObject *parent)
+    : QObject(parent), store(store) {
+    wakeTimer.setSingleShot(true);
+    wakeTimer.setTimerType(Qt::PreciseTimer);
+    connect(&wakeTimer, &QTimer::timeout, this, &PollScheduler::dispatch);
+
+    timeoutTimer.setSingleShot(true);
+    timeoutTimer.setTimerType(Qt::PreciseTimer);
+    connect(&timeoutTimer, &QTimer::timeout, this, [this]() {
+        Modbus::Response response;
+        response.status = Modbus::Timeout;
+        finish(response);
+    });
+    clock.start();
+}
+
+int PollScheduler::addGroup(const Group &group) {
+    if (!Modbus::isValidRead(group.request, &lastError)) {
+        return -1;
+    }
+    if (group.periodMs <= 0) {
+        lastError = QString("周期必须大于 0: %1").arg(group.periodMs);
+        return -1;
+    }
+    if (group.deadband < 0) {
+        lastError = QString("死区不能小于 0: %1").arg(group.deadband);
+        return -1;
+    }
+
+    GroupState state;
+    state.id = nextId++;
+    state.config = group;
+    state.periodNs = qint64(group.periodMs) * 1000000;
+    state.deadlineNs = qint64(group.deadlineMs > 0 ? group.deadlineMs : group.periodMs) * 1000000;
+    state.nextReleaseNs = running ? clock.nsecsElapsed() : 0;
+
+    const Modbus::Request &request = group.request;
+    const int width = Modbus::isBitFunction(request.function) ? 1 : Modbus::formatWidth(group.format);
+    for (int i = 0; i < request.count / width; i++) {
+        state.tagNames.append(QString("%1/%2/%3").arg(request.unit).arg(request.function).arg(request.address + i * width));
+    }
+    groups.append(state);
+
+    if (running && !busy) {
+        dispatch();
+    }
+    return state.id;
+}
+
+int PollScheduler::addGroup(const QVariantMap &config) {
+    Group group;
+    group.request.unit = config.value("unit", 1).toInt();
+    group.request.function = config.value("func", Modbus::ReadHoldingRegisters).toInt();
+    group.request.address = config.value("addr", 0).toInt();
+    group.request.count = config.value("count", 1).toInt();
+    group.periodMs = config.value("period", 1000).toInt();
+    group.priority = config.value("priority", 0).toInt();
+    group.deadlineMs = config.value("deadline", 0).toInt();
+    group.deadband = config.value("deadband", 0).toDouble();
+    if (config.contains("format") && !Modbus::formatFromString(config["format"].toString(), &group.format)) {
+        lastError = QString("未知的数据格式: %1").arg(config["format"].toString());
+        return -1;
+    }
+    return addGroup(group);
+}
+
+bool PollScheduler::removeGroup(int id) {
+    for (int i = 0; i < groups.size(); i++) {
+        if (groups[i].id == id) {
+            groups.removeAt(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PollScheduler::clear() {
+    groups.clear();
+    units.clear();
+}
+
+// 合并进队列中同一从站相邻或重叠的写，后写入的值覆盖重叠部分；从队尾找起，保证不越过更晚的写
+int PollScheduler::queueWrite(int unit, int address, const QVector<quint16> &values, bool coils, int priority) {
+    Modbus::Request request;
+    request.unit = unit;
+    request.address = address;
+    request.values = values;
+    request.function = coils ? (values.size() == 1 ? Modbus::WriteSingleCoil : Modbus::WriteMultipleCoils)
+                             : (values.size() == 1 ? Modbus::WriteSingleRegister : Modbus::WriteMultipleRegisters);
+    if (!Modbus::isValidWrite(request, &lastError)) {
+        return -1;
+    }
+    if (unit == 0) {
+        lastError = QStringLiteral("广播写没有应答，不支持");
+        return -1;
+    }
+
+    const int id = nextWriteId++;
+    writesQueued++;
+    const int limit = coils ? kMaxCoilWrite : kMaxRegisterWrite;
+    for (int i = writes.size() - 1; i >= 0; i--) {
+        PendingWrite &pending = writes[i];
+        const int end = address + values.size();
+        const int pendingEnd = pending.address + pending.values.size();
+        if (pending.unit != unit || pending.coils != coils || address > pendingEnd || end < pending.address) {
+            continue;
+        }
+        const int start = qMin(address, pending.address);
+        const int mergedEnd = qMax(end, pendingEnd);
+        if (mergedEnd - start > limit) {
+            break;
+        }
+        QVector<quint16> merged(mergedEnd - start);
+        std::copy(pending.values.cbegin(), pending.values.cend(), merged.begin() + (pending.address - start));
+        std::copy(values.cbegin(), values.cend(), merged.begin() + (address - start));
+        pending.address = start;
+        pending.values = merged;
+        pending.priority = qMax(pending.priority, priority);
+        pending.ids.append(id);
+        writesMerged++;
+        return id;
+    }
+
+    PendingWrite pending;
+    pending.ids.append(id);
+    pending.unit = unit;
+    pending.coils = coils;
+    pending.address = address;
+    pending.values = values;
+    pending.priority = priority;
+    pending.queuedNs = clock.nsecsElapsed();
+    writes.append(pending);
+
+    if (!busy) {
+        dispatch();
+    }
+    return id;
+}
+
+int PollScheduler::queueWrite(const QVariantMap &config) {
+    QVector<quint16> values;
+    if (config.contains("values")) {
+        const QVariantList list = config["values"].toList();
+        for (const QVariant &value : list) {
+            values.append(quint16(value.toInt()));
+        }
+    } else if (config.contains("value")) {
+        values.append(quint16(config["value"].toInt()));
+    }
+    return queueWrite(config.value("unit", 1).toInt(), config.value("addr", 0).toInt(), values,
+                      config.value("coil", false).toBool(), config.value("priority", 0).toInt());
+}
+
+int PollScheduler::pendingWrites() const {
+    int count = writing.ids.size();
+    for (const PendingWrite &pending : writes) {
+        count += pending.ids.size();
+    }
+    return count;
+}
+
+void PollScheduler::start() {
+    if (running) {
+        return;
+    }
+    running = true;
+    const qint64 now = clock.nsecsElapsed();
+    for (GroupState &group : groups) {
+        group.nextReleaseNs = now;
+        group.overdue = false;
+        // 重新开始后第一次应答上报全部值
+        group.snapshot.clear();
+        group.current.clear();
+        group.reported.clear();
+    }
+    units.clear();
+    dispatch();
+}
+
+// 放弃当前请求，写放回队首；迟到的应答在一个超时时间内不会被当作下一帧，之后排队的写继续发送
+void PollScheduler::stop() {
+    running = false;
+    wakeTimer.stop();
+    const qint64 now = clock.nsecsElapsed();
+    if (busy) {
+        busy = false;
+        inFlight = -1;
+        timeoutTimer.stop();
+        rxBuffer.clear();
+        if (!writing.ids.isEmpty()) {
+            writes.prepend(writing);
+            writing = PendingWrite();
+        }
+        busFreeNs = now + qint64(timeoutMs) * 1000000;
+    }
+    if (!writes.isEmpty()) {
+        arm(qMax(now, busFreeNs));
+    }
+}
+
+PollScheduler::GroupState *PollScheduler::findGroup(int id) {
+    for (GroupState &group : groups) {
+        if (group.id == id) {
+            return &group;
+        }
+    }
+    return nullptr;
+}
+
+void PollScheduler::arm(qint64 atNs) {
+    if (atNs == std::numeric_limits<qint64>::max()) {
+        wakeTimer.stop();
+        return;
+    }
+    // 向上取整到毫秒，避免不足 1ms 时反复空转
+    const qint64 waitNs = atNs - clock.nsecsElapsed();
+    wakeTimer.start(waitNs > 0 ? int((waitNs + 999999) / 1000000) : 0);
+}
+
+// 断开或半开的从站在探测时刻之前不发请求
+qint64 PollScheduler::unitReleaseNs(int unit) const {
+    auto it = units.constFind(unit);
+    return it != units.constEnd() && it->state != Closed ? it->openUntilNs : 0;
+}
+
+bool PollScheduler::canReadWrite(int unit) const {
+    return readWriteEnabled && units.value(unit).readWrite;
+}
+
+// 总线空闲时选出下一个请求发送：到期的轮询组和排队的写按优先级竞争，同优先级时写在前
+// 没有可发送的请求时定时到最早的释放时刻
+void PollScheduler::dispatch() {
+    if (busy || (!running && writes.isEmpty())) {
+        return;
+    }
+    const qint64 now = clock.nsecsElapsed();
+    if (now < busFreeNs) {
+        arm(busFreeNs);
+        return;
+    }
+
+    // 断开到期的从站转为半开，下一个请求即为探测
+    for (auto it = units.begin(); it != units.end(); ++it) {
+        if (it->state == Open && it->openUntilNs <= now) {
+            it->state = HalfOpen;
+        }
+    }
+
+    GroupState *best = nullptr;
+    qint64 bestRelease = 0;
+    qint64 wake = std::numeric_limits<qint64>::max();
+    for (GroupState &group : groups) {
+        if (!running) {
+            break;
+        }
+        const qint64 release = qMax(group.nextReleaseNs, unitReleaseNs(group.config.request.unit));
+        if (release > now) {
+            wake = qMin(wake, release);
+            continue;
+        }
+        if (!best || group.config.priority > best->config.priority
+            || (group.config.priority == best->config.priority
+                && release + group.deadlineNs < bestRelease + best->deadlineNs)) {
+            best = &group;
+            bestRelease = release;
+        }
+    }
+
+    // 写随时可发，同优先级先排队的在前
+    int writeIndex = -1;
+    for (int i = 0; i < writes.size(); i++) {
+        const qint64 release = unitReleaseNs(writes[i].unit);
+        if (release > now) {
+            wake = qMin(wake, release);
+            continue;
+        }
+        if (writeIndex < 0 || writes[i].priority > writes[writeIndex].priority) {
+            writeIndex = i;
+        }
+    }
+    if (writeIndex >= 0 && best && writes[writeIndex].priority < best->config.priority) {
+        writeIndex = -1;
+    }
+
+    // 寄存器写和同一从站到期的 0x03 组合并为一帧 0x17(先写后读)
+    GroupState *group = writeIndex >= 0 ? nullptr : best;
+    qint64 groupRelease = bestRelease;
+    if (writeIndex >= 0) {
+        const PendingWrite &pending = writes[writeIndex];
+        if (running && !pending.coils && pending.values.size() <= kMaxReadWriteRegisters && canReadWrite(pending.unit)) {
+            for (GroupState &candidate : groups) {
+                const Modbus::Request &request = candidate.config.request;
+                const qint64 release = qMax(candidate.nextReleaseNs, unitReleaseNs(request.unit));
+                if (request.unit == pending.unit && request.function == Modbus::ReadHoldingRegisters && release <= now
+                    && (!group || candidate.config.priority > group->config.priority)) {
+                    group = &candidate;
+                    groupRelease = release;
+                }
+            }
+        }
+    } else if (group && group->config.request.function == Modbus::ReadHoldingRegisters
+               && canReadWrite(group->config.request.unit)) {
+        for (int i = 0; i < writes.size(); i++) {
+            const PendingWrite &pending = writes[i];
+            if (pending.unit == group->config.request.unit && !pending.coils
+                && pending.values.size() <= kMaxReadWriteRegisters) {
+                writeIndex = i;
+                break;
+            }
+        }
+    }
+
+    if (!group && writeIndex < 0) {
+        arm(wake);
+        return;
+    }
+
+    Modbus::Request request;
+    if (group) {
+        request = group->config.request;
+        group->releaseNs = groupRelease;
+        group->polls++;
+        if (group->firstSentNs < 0) {
+            group->firstSentNs = now;
+        }
+        group->lastSentNs = now;
+    }
+    if (writeIndex >= 0) {
+        writing = writes.takeAt(writeIndex);
+        writeFrames++;
+        if (group) {
+            request.function = Modbus::ReadWriteMultipleRegisters;
+            request.writeAddress = writing.address;
+            readWriteFrames++;
+        } else {
+            const bool single = writing.values.size() == 1;
+            request.unit = writing.unit;
+            request.address = writing.address;
+            request.count = writing.values.size();
+            request.function = writing.coils ? (single ? Modbus::WriteSingleCoil : Modbus::WriteMultipleCoils)
+                                             : (single ? Modbus::WriteSingleRegister : Modbus::WriteMultipleRegisters);
+        }
+        request.values = writing.values;
+    }
+    auto unit = units.find(request.unit);
+    if (unit != units.end() && unit->state == HalfOpen) {
+        unit->probes++;
+    }
+
+    transaction++;
+    busy = true;
+    inFlight = group ? group->id : -1;
+    current = request;
+    sentNs = now;
+    rxBuffer.clear();
+    const QByteArray frame = Modbus::encodeRequest(current, protocol, transaction);
+    if (!write || !write(frame)) {
+        // 未连接时组记为错误并按周期推进，排队的写全部失败，不会空转
+        busy = false;
+        inFlight = -1;
+        if (group) {
+            group->errors++;
+            advance(*group, now);
+        }
+        if (!writing.ids.isEmpty()) {
+            writes.prepend(writing);
+            writing = PendingWrite();
+        }
+        const QList<PendingWrite> failed = std::move(writes);
+        writes.clear();
+        for (const PendingWrite &pending : failed) {
+            completeWrite(pending, false, QStringLiteral("未连接"), now);
+        }
+        dispatch();
+        return;
+    }
+    timeoutTimer.start(timeoutMs);
+}
+
+void PollScheduler::feed(const char *data, int size) {
+    if (!busy || size <= 0) {
+        return;
+    }
+    rxBuffer.append(data, size);
+
+    for (;;) {
+        // RTU 以站号对齐帧起点，前面的杂散字节丢弃
+        if (protocol == Modbus::Rtu) {
+            int start = 0;
+            while (start < rxBuffer.size() && quint8(rxBuffer[start]) != current.unit) {
+                start++;
+            }
+            if (start > 0) {
+                rxBuffer.remove(0, start);
+            }
+        }
+        const int length = Modbus::responseLength(rxBuffer.constData(), rxBuffer.size(), protocol);
+        if (length < 0) {
+            rxBuffer.remove(0, protocol == Modbus::Rtu ? 1 : rxBuffer.size());
+            continue;
+        }
+        if (length == 0 || rxBuffer.size() < length) {
+            return;
+        }
+
+        const Modbus::Response response = Modbus::decodeResponse(rxBuffer.constData(), length, protocol,
+                                                                 current, transaction);
+        rxBuffer.remove(0, length);
+        if (response.status == Modbus::Mismatch) {
+            continue;
+        }
+        finish(response);
+        return;
+    }
+}
+
+// 当前请求结束：更新统计和从站断路器，完成写，推进组的下次释放时刻，然后发送下一个请求
+// 信号的接收者(脚本回调)可能增删组或排队写，所以状态全部更新完后才发信号，之后不再使用组指针
+void PollScheduler::finish(const Modbus::Response &response) {
+    timeoutTimer.stop();
+    if (!busy) {
+        return;
+    }
+    busy = false;
+    GroupState *group = findGroup(inFlight);
+    inFlight = -1;
+    const PendingWrite written = std::move(writing);
+    writing = PendingWrite();
+    rxBuffer.clear();
+    const qint64 now = clock.nsecsElapsed();
+    busFreeNs = now + turnaroundNs;
+
+    // 超时、CRC 错误和网关报告目标无应答(0x0A/0x0B)算作从站失败，其他异常说明从站在线
+    const int unitId = current.unit;
+    UnitState &unit = units[unitId];
+    const bool gatewayFailure = response.status == Modbus::Exception
+                                && (response.exception == 0x0A || response.exception == 0x0B);
+    const bool failed = response.status == Modbus::Timeout || response.status == Modbus::CrcError || gatewayFailure;
+    switch (response.status) {
+    case Modbus::Timeout:
+        unit.timeouts++;
+        break;
+    case Modbus::Exception:
+        unit.exceptions++;
+        unit.lastException = response.exception;
+        break;
+    case Modbus::CrcError:
+        unit.crcErrors++;
+        break;
+    default:
+        break;
+    }
+    // 站号或功能码不符的应答不影响断路器
+    BreakerChange breaker = NoChange;
+    if (response.status != Modbus::Malformed) {
+        breaker = updateBreaker(unit, failed, now);
+    }
+
+    // 从站不支持 0x17：以后读写分开发送，写放回队首，组未推进会立即重发
+    if (current.function == Modbus::ReadWriteMultipleRegisters && response.status == Modbus::Exception
+        && response.exception == 0x01) {
+        unit.readWrite = false;
+        writes.prepend(written);
+        notifyBreaker(unitId, breaker);
+        dispatch();
+        return;
+    }
+
+    int groupId = -1;
+    qint64 overdueMs = -1;
+    QVariantList changes;
+    if (group) {
+        groupId = group->id;
+        switch (response.status) {
+        case Modbus::Ok:
+            group->responses++;
+            changes = record(*group, response);
+            break;
+        case Modbus::Timeout:
+            group->timeouts++;
+            break;
+        case Modbus::Exception:
+            group->exceptions++;
+            group->lastException = response.exception;
+            break;
+        default:
+            group->errors++;
+            break;
+        }
+        if (response.status != Modbus::Timeout) {
+            group->latencyNs += now - sentNs;
+        }
+        // 失败由断路器处理，不计入截止时间
+        if (!failed) {
+            const qint64 lateNs = now - (group->releaseNs + group->deadlineNs);
+            if (lateNs > 0) {
+                group->misses++;
+                group->maxLateNs = qMax(group->maxLateNs, lateNs);
+                if (!group->overdue) {
+                    group->overdue = true;
+                    overdueMs = lateNs / 1000000;
+                }
+            } else {
+                group->overdue = false;
+            }
+        }
+        advance(*group, now);
+        group = nullptr;
+    }
+
+    notifyBreaker(unitId, breaker);
+    if (!written.ids.isEmpty()) {
+        completeWrite(written, response.status == Modbus::Ok, statusText(response), now);
+    }
+    if (overdueMs >= 0) {
+        emit overdue(groupId, overdueMs);
+    }
+    if (!changes.isEmpty()) {
+        emit valuesChanged(groupId, changes);
+    }
+    dispatch();
+}
+
+void PollScheduler::completeWrite(const PendingWrite &pending, bool ok, const QString &error, qint64 now) {
+    const qint64 latencyNs = now - pending.queuedNs;
+    writeLatencyNs += latencyNs;
+    maxWriteLatencyNs = qMax(maxWriteLatencyNs, latencyNs);
+    writesCompleted++;
+    if (ok) {
+        writesOk += pending.ids.size();
+    } else {
+        writesFailed += pending.ids.size();
+    }
+    for (int id : pending.ids) {
+        emit writeFinished(id, ok, error);
+    }
+}
+
+PollScheduler::BreakerChange PollScheduler::updateBreaker(UnitState &unit, bool failed, qint64 now) {
+    if (!failed) {
+        unit.failures = 0;
+        if (unit.state == Closed) {
+            return NoChange;
+        }
+        unit.state = Closed;
+        unit.probeIntervalNs = 0;
+        return TurnedClosed;
+    }
+
+    unit.failures++;
+    BreakerChange change = NoChange;
+    if (unit.state == HalfOpen) {
+        // 探测失败，间隔加倍
+        unit.probeIntervalNs = qMin<qint64>(unit.probeIntervalNs * 2, qint64(qMax(maxBackoffMs, probeIntervalMs)) * 1000000);
+    } else if (unit.state == Closed && unit.failures >= failureThreshold) {
+        unit.probeIntervalNs = qint64(probeIntervalMs) * 1000000;
+        unit.trips++;
+        change = TurnedOpen;
+    } else {
+        return NoChange;
+    }
+    unit.state = Open;
+    unit.openUntilNs = now + unit.probeIntervalNs;
+    return change;
+}
+
+void PollScheduler::notifyBreaker(int unitId, BreakerChange change) {
+    if (change == TurnedOpen) {
+        emit unitOffline(unitId, probeIntervalMs);
+    } else if (change == TurnedClosed) {
+        emit unitOnline(unitId);
+    }
+}
+
+// 以计划时刻为基准推进，落后超过一个周期时跳过错过的释放
+void PollScheduler::advance(GroupState &group, qint64 now) {
+    group.nextReleaseNs += group.periodNs;
+    if (group.nextReleaseNs <= now) {
+        const qint64 missed = (now - group.nextReleaseNs) / group.periodNs + 1;
+        group.nextReleaseNs += missed * group.periodNs;
+        group.skipped += missed;
+    }
+}
+
+// 原始寄存器与上次相同时沿用上次的解码值，只记入标签存储；返回需要上报的变化
+QVariantList PollScheduler::record(GroupState &group, const Modbus::Response &response) {
+    const bool same = group.snapshot.size() == response.values.size()
+                      && std::memcmp(group.snapshot.constData(), response.values.constData(),
+                                     size_t(response.values.size()) * sizeof(quint16)) == 0;
+    QVariantList changes;
+    if (same) {
+        group.unchanged++;
+    } else {
+        group.snapshot = response.values;
+        if (Modbus::isBitFunction(group.config.request.function)) {
+            group.current.resize(response.values.size());
+            for (int i = 0; i < response.values.size(); i++) {
+                group.current[i] = response.values[i];
+            }
+        } else {
+            Modbus::decodeValues(response.values, group.config.format, group.current);
+        }
+        changes = collectChanges(group);
+    }
+
+    if (store) {
+        const qint64 time = QDateTime::currentMSecsSinceEpoch();
+        for (int i = 0; i < group.current.size() && i < group.tagNames.size(); i++) {
+            store->record(group.tagNames[i], group.current[i], time);
+        }
+    }
+    return changes;
+}
+
+// 与上次上报的值比较，死区内的模拟量变化不上报，累积超过死区后再上报
+QVariantList PollScheduler::collectChanges(GroupState &group) {
+    const Modbus::Request &request = group.config.request;
+    const bool bits = Modbus::isBitFunction(request.function);
+    const bool useDeadband = !bits && group.config.deadband > 0;
+    const int width = bits ? 1 : Modbus::formatWidth(group.config.format);
+
+    QVariantList changes;
+    const int known = group.reported.size();
+    group.reported.resize(group.current.size());
+    for (int i = 0; i < group.current.size() && i < group.tagNames.size(); i++) {
+        const double value = group.current[i];
+        if (i < known) {
+            const double previous = group.reported[i];
+            const bool changed = useDeadband ? !(qAbs(value - previous) <= group.config.deadband) : value != previous;
+            if (!changed) {
+                continue;
+            }
+        }
+        QVariantMap change;
+        change["tag"] = group.tagNames[i];
+        change["addr"] = request.address + i * width;
+        change["value"] = value;
+        if (i < known) {
+            change["previous"] = group.reported[i];
+        }
+        changes.append(change);
+        group.reported[i] = value;
+    }
+    group.changes += changes.size();
+    return changes;
+}
+
+QVariantList PollScheduler::statistics() const {
+    QVariantList list;
+    const qint64 now = clock.nsecsElapsed();
+    for (const GroupState &group : groups) {
+        const Modbus::Request &request = group.config.request;
+        QVariantMap map;
+        map["id"] = group.id;
+        map["unit"] = request.unit;
+        map["func"] = request.function;
+        map["addr"] = request.address;
+        map["count"] = request.count;
+        map["periodMs"] = group.config.periodMs;
+        map["priority"] = group.config.priority;
+        map["deadlineMs"] = group.deadlineNs / 1000000;
+        map["polls"] = group.polls;
+        map["responses"] = group.responses;
+        map["timeouts"] = group.timeouts;
+        map["exceptions"] = group.exceptions;
+        map["lastException"] = group.lastException;
+        map["errors"] = group.errors;
+        map["misses"] = group.misses;
+        map["skipped"] = group.skipped;
+        map["unchanged"] = group.unchanged;
+        map["changes"] = group.changes;
+        map["overdue"] = group.overdue;
+        map["maxLateMs"] = group.maxLateNs / 1e6;
+        map["actualPeriodMs"] = group.polls > 1 ? (group.lastSentNs - group.firstSentNs) / 1e6 / (group.polls - 1) : 0.0;
+        const qint64 answered = group.responses + group.exceptions + group.errors;
+        map["meanLatencyMs"] = answered > 0 ? group.latencyNs / 1e6 / answered : 0.0;
+        const UnitState unit = units.value(request.unit);
+        map["backoffMs"] = running && unit.state == Open && unit.openUntilNs > now ? (unit.openUntilNs - now) / 1000000 : 0;
+        list.append(map);
+    }
+    return list;
+}
+
+QVariantList PollScheduler::unitStatistics() const {
+    static const char *stateNames[] = {"closed", "open", "half-open"};
+    QVariantList list;
+    const qint64 now = clock.nsecsElapsed();
+    for (auto it = units.constBegin(); it != units.constEnd(); ++it) {
+        const UnitState &unit = it.value();
+        QVariantMap map;
+        map["unit"] = it.key();
+        map["state"] = stateNames[unit.state];
+        map["failures"] = unit.failures;
+        map["timeouts"] = unit.timeouts;
+        map["crcErrors"] = unit.crcErrors;
+        map["exceptions"] = unit.exceptions;
+        map["lastException"] = unit.lastException;
+        map["trips"] = unit.trips;
+        map["probes"] = unit.probes;
+        map["probeIntervalMs"] = unit.probeIntervalNs / 1000000;
+        map["readWrite"] = unit.readWrite;
+        map["retryMs"] = unit.state == Open && unit.openUntilNs > now ? (unit.openUntilNs - now) / 1000000 : 0;
+        list.append(map);
+    }
+    return list;
+}
+
+QVariantMap PollScheduler::writeStatistics() const {
+    QVariantMap map;
+    map["queued"] = writesQueued;
+    map["merged"] = writesMerged;
+    map["frames"] = writeFrames;
+    map["readWriteFrames"] = readWriteFrames;
+    map["ok"] = writesOk;
+    map["failed"] = writesFailed;
+    map["pending"] = pendingWrites();
+    map["meanLatencyMs"] = writesCompleted > 0 ? writeLatencyNs / 1e6 / writesCompleted : 0.0;
+    map["maxLatencyMs"] = maxWriteLatencyNs / 1e6;
+    return map;
+}
+
+void PollScheduler::resetStatistics() {
+    for (GroupState &group : groups) {
+        group.polls = group.responses = group.timeouts = group.exceptions = group.errors = 0;
+        group.misses = group.skipped = group.maxLateNs = group.latencyNs = 0;
+        group.unchanged = group.changes = 0;
+        group.firstSentNs = -1;
+        group.lastSentNs = 0;
+        group.lastException = 0;
+    }
+    for (UnitState &unit : units) {
+        unit.timeouts = unit.crcErrors = unit.exceptions = unit.trips = unit.probes = 0;
+        unit.lastException = 0;
+    }
+    writesQueued = writesMerged = writeFrames = readWriteFrames = writesOk = writesFailed = 0;
+    writesCompleted = writeLatencyNs = maxWriteLatencyNs = 0;
+}
@@ -0,0 +1,227 @@
+#ifndef POLLSCHEDULER_H
+#define POLLSCHEDULER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+#include <functional>
+
+#include "modbus.h"
+
+class TagStore;
+
+// PollScheduler Modbus 主站轮询调度
+// 总线上同时只有一个请求；空闲时在已到期的轮询组中选优先级最高的，同优先级选截止时刻最早的(EDF)
+// 每个从站一个断路器：连续 failureThreshold 次失败(超时、CRC 错误、网关异常 0x0A/0x0B)后断开(open)，
+// 断开期间它的组不占用总线；过 probeInterval 后半开(half-open)，只发一个探测请求，
+// 有应答则闭合恢复轮询，仍失败则再次断开且探测间隔加倍(上限 maxBackoff)
+// 完成时刻晚于 释放时刻 + deadline 记为错过截止时间，组转入超期时发出 overdue
+// 写请求排队，同一从站相邻或重叠的写合并为一帧 0x10/0x0F(单个为 0x06/0x05)，与轮询组按优先级竞争总线；
+// 启用 readWrite 时寄存器写和同站到期的 0x03 组合并为 0x17，从站返回非法功能码后不再合并
+// 读到的值按 "从站/功能码/地址" 记入 TagStore；只有变化的值通过 valuesChanged 上报(寄存器与上次逐字节相同时不解码)
+class PollScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    struct Group {
+        Modbus::Request request;
+        Modbus::DataFormat format = Modbus::UInt16;
+        int periodMs = 1000;
+        int priority = 0;      // 越大越优先
+        int deadlineMs = 0;    // 相对释放时刻，0 为与周期相同
+        double deadband = 0;   // 模拟量与上次上报值相差超过它才上报，位功能码忽略
+    };
+
+    using Writer = std::function<bool(const QByteArray &frame)>;
+
+    explicit PollScheduler(TagStore *store, QObject *parent = nullptr);
+
+    // 发送请求帧，返回是否写出
+    void setWriter(Writer writer) { write = std::move(writer); }
+
+    // 添加轮询组，返回组ID，参数不合法时返回 -1 并通过 errorString() 说明
+    int addGroup(const Group &group);
+    // 从 {unit=, func=, addr=, count=, period=, priority=, deadline=, format=, deadband=} 添加
+    int addGroup(const QVariantMap &config);
+    bool removeGroup(int id);
+    void clear();
+
+    // 排队写入，返回写ID，结果通过 writeFinished 通知；参数不合法时返回 -1
+    // 未启动轮询时写照样发送，同优先级时写先于轮询组
+    int queueWrite(int unit, int address, const QVector<quint16> &values, bool coils = false, int priority = 0);
+    // 从 {unit=, addr=, value= 或 values={...}, coil=false, priority=0} 排队
+    int queueWrite(const QVariantMap &config);
+    // 尚未完成的写(合并前的个数)
+    int pendingWrites() const;
+    QString errorString() const { return lastError; }
+
+    void setProtocol(Modbus::Protocol value) { protocol = value; }
+    Modbus::Protocol currentProtocol() const { return protocol; }
+    void setTimeoutMs(int ms) { timeoutMs = qMax(1, ms); }
+    // 断开后第一次探测的间隔，每次探测失败加倍，不超过 maxBackoff
+    void setProbeIntervalMs(int ms) { probeIntervalMs = qMax(1, ms); }
+    void setMaxBackoffMs(int ms) { maxBackoffMs = qMax(0, ms); }
+    // 连续失败多少次断开
+    void setFailureThreshold(int count) { failureThreshold = qMax(1, count); }
+    // 一次应答结束到下一个请求之间的最小间隔(RTU 为 t3.5)
+    void setTurnaroundUs(qint64 us) { turnaroundNs = qMax<qint64>(0, us) * 1000; }
+    // 寄存器写搭载在同站 0x03 轮询上用 0x17 发送
+    void setReadWriteEnabled(bool enable) { readWriteEnabled = enable; }
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    // 接收到的原始字节，凑齐一帧应答即完成当前请求
+    void feed(const char *data, int size);
+
+    // 每组统计：请求/应答/超时/异常/错误次数、错过截止时间次数、最大超期、平均周期和响应时间、所属从站断开时距下次探测的时间
+    QVariantList statistics() const;
+    // 每个从站的健康状态：state("closed"/"open"/"half-open")、连续失败次数、超时/CRC 错误/异常次数、断开和探测次数
+    QVariantList unitStatistics() const;
+    // 写统计：queued、merged(并入其他帧的写)、frames、readWriteFrames(0x17)、ok、failed、pending、平均/最大排队到完成时间
+    QVariantMap writeStatistics() const;
+    void resetStatistics();
+
+signals:
+    void overdue(int id, qint64 lateMs);
+    // 组内变化的值 [{tag=, addr=, value=, previous=}]，启动后的第一次应答没有 previous
+    void valuesChanged(int id, const QVariantList &changes);
+    void unitOffline(int unit, qint64 retryMs);
+    void unitOnline(int unit);
+    void writeFinished(int id, bool ok, const QString &error);
+
+private:
+    struct GroupState {
+        int id = 0;
+        Group config;
+        QStringList tagNames;       // 预先生成的标签名，每个值一个
+        QVector<quint16> snapshot;  // 上次应答的原始寄存器
+        QVector<double> current;    // snapshot 解码后的值
+        QVector<double> reported;   // 上次上报的值，死区相对它计算
+        qint64 periodNs = 0;
+        qint64 deadlineNs = 0;
+        qint64 nextReleaseNs = 0;   // 下次释放的计划时刻(相对 clock 起点)
+        qint64 releaseNs = 0;       // 当前请求的释放时刻，从站断开时为探测时刻
+        bool overdue = false;
+
+        qint64 polls = 0;
+        qint64 responses = 0;
+        qint64 timeouts = 0;
+        qint64 exceptions = 0;
+        qint64 errors = 0;
+        qint64 misses = 0;
+        qint64 skipped = 0;         // 落后超过一个周期跳过的释放
+        qint64 maxLateNs = 0;
+        qint64 latencyNs = 0;       // 累计响应时间
+        qint64 firstSentNs = -1;
+        qint64 lastSentNs = 0;
+        int lastException = 0;
+        qint64 unchanged = 0;       // 寄存器与上次相同的应答
+        qint64 changes = 0;         // 上报的值变化
+    };
+
+    enum BreakerState {
+        Closed,    // 正常轮询
+        Open,      // 离线，到 openUntilNs 前不发请求
+        HalfOpen   // 等待一次探测的结果
+    };
+
+    enum BreakerChange {
+        NoChange,
+        TurnedOpen,
+        TurnedClosed
+    };
+
+    struct UnitState {
+        BreakerState state = Closed;
+        int failures = 0;           // 连续失败次数
+        qint64 openUntilNs = 0;
+        qint64 probeIntervalNs = 0; // 当前的探测间隔
+
+        qint64 timeouts = 0;
+        qint64 crcErrors = 0;
+        qint64 exceptions = 0;
+        int lastException = 0;
+        qint64 trips = 0;           // 断开次数
+        qint64 probes = 0;
+        bool readWrite = true;      // 0x17 返回非法功能码后为 false
+    };
+
+    struct PendingWrite {
+        QVector<int> ids;           // 合并进这一帧的写ID
+        int unit = 1;
+        bool coils = false;
+        int address = 0;
+        QVector<quint16> values;
+        int priority = 0;
+        qint64 queuedNs = 0;        // 最早一个写的排队时刻
+    };
+
+    static constexpr int kMaxRegisterWrite = 123;      // 0x10 一帧最多寄存器数
+    static constexpr int kMaxCoilWrite = 1968;         // 0x0F 一帧最多线圈数
+    static constexpr int kMaxReadWriteRegisters = 121; // 0x17 一帧最多写寄存器数
+
+    void dispatch();
+    void arm(qint64 atNs);
+    void finish(const Modbus::Response &response);
+    void advance(GroupState &group, qint64 now);
+    BreakerChange updateBreaker(UnitState &unit, bool failed, qint64 now);
+    void notifyBreaker(int unitId, BreakerChange change);
+    void completeWrite(const PendingWrite &pending, bool ok, const QString &error, qint64 now);
+    qint64 unitReleaseNs(int unit) const;
+    bool canReadWrite(int unit) const;
+    QVariantList record(GroupState &group, const Modbus::Response &response);
+    QVariantList collectChanges(GroupState &group);
+    GroupState *findGroup(int id);
+
+    TagStore *store;
+    Writer write;
+    QList<GroupState> groups;
+    QHash<int, UnitState> units;
+    QList<PendingWrite> writes; // 等待发送的写，按排队顺序
+    QString lastError;
+    int nextId = 1;
+    int nextWriteId = 1;
+
+    Modbus::Protocol protocol = Modbus::Rtu;
+    int timeoutMs = 100;
+    int probeIntervalMs = 1000;
+    int maxBackoffMs = 10000;
+    int failureThreshold = 3;
+    qint64 turnaroundNs = 0;
+    bool readWriteEnabled = false;
+
+    bool running = false;
+    QElapsedTimer clock;        // 单调时钟
+    QTimer wakeTimer;           // 下一组到期或总线空闲时唤醒
+    QTimer timeoutTimer;        // 当前请求的应答超时
+    bool busy = false;          // 有请求等待应答
+    int inFlight = -1;          // 等待应答的组ID，单独的写为 -1
+    Modbus::Request current;    // 当前请求
+    PendingWrite writing;       // 当前请求携带的写，ids 为空表示没有
+    quint16 transaction = 0;
+    qint64 sentNs = 0;
+    qint64 busFreeNs = 0;       // 总线可以发送下一个请求的时刻
+    QByteArray rxBuffer;        // 当前请求已收到的应答字节
+
+    qint64 writesQueued = 0;
+    qint64 writesMerged = 0;
+    qint64 writeFrames = 0;
+    qint64 readWriteFrames = 0;
+    qint64 writesOk = 0;
+    qint64 writesFailed = 0;
+    qint64 writesCompleted = 0; // 完成的写帧数
+    qint64 writeLatencyNs = 0;
+    qint64 maxWriteLatencyNs = 0;
+};
+
+#endif // POLLSCHEDULER_H
@@ -0,0 +1,141 @@
+#include "rtuframer.h"
+
+RtuFramer::RtuFramer(QObject *parent) : QObject(parent) {
+    clock.start();
+    silenceTimer.setSingleShot(true);
+    silenceTimer.setTimerType(Qt::PreciseTimer);
+    connect(&silenceTimer, &QTimer::timeout, this, &RtuFramer::onSilence);
+    configure(9600, 8, 1, false);
+}
+
+void RtuFramer::configure(int baudRate, int dataBits, double stopBits, bool hasParity) {
+    if (baudRate <= 0) {
+        baudRate = 9600;
+    }
+
+    // 起始位 + 数据位 + 校验位 + 停止位
+    double bits = 1 + dataBits + (hasParity ? 1 : 0) + stopBits;
+    charNs = qint64(bits * 1e9 / baudRate);
+
+    // 规范规定波特率高于 19200 时使用固定值 750us / 1750us
+    if (baudRate > 19200) {
+        t15 = 750000;
+        t35 = 1750000;
+    } else {
+        t15 = charNs * 3 / 2;
+        t35 = charNs * 7 / 2;
+    }
+}
+
+void RtuFramer::setEnabled(bool enable) {
+    if (enabled == enable) {
+        return;
+    }
+    if (!enable) {
+        flush();
+    }
+    enabled = enable;
+}
+
+void RtuFramer::feed(const RxBuffer &chunk) {
+    feed(chunk, clock.nsecsElapsed());
+}
+
+void RtuFramer::feed(const RxBuffer &chunk, qint64 timestampNs) {
+    if (chunk.isEmpty()) {
+        return;
+    }
+
+    // 块到达时刻对应最后一个字节，倒推首字节开始接收的时刻
+    qint64 firstByteStart = timestampNs - chunk.size() * charNs;
+
+    if (!frame.isEmpty()) {
+        qint64 gap = firstByteStart - lastByteNs;
+        if (gap >= t35) {
+            flush();
+        } else if (gap > t15) {
+            gapViolation = true;
+        }
+    }
+
+    if (frame.isEmpty()) {
+        frameStartNs = firstByteStart;
+    }
+
+    // 单块可能含多帧的尾部，超长时按最大帧长切分
+    int offset = 0;
+    while (chunk.size() - offset > kMaxFrameSize - frame.size()) {
+        int take = kMaxFrameSize - frame.size();
+        appendToFrame(chunk.constData() + offset, take);
+        offset += take;
+        lastByteNs = firstByteStart + offset * charNs;
+        flush();
+        frameStartNs = lastByteNs;
+    }
+    appendToFrame(chunk.constData() + offset, chunk.size() - offset);
+    lastByteNs = timestampNs;
+
+    if (frame.size() >= kMaxFrameSize) {
+        flush();
+        return;
+    }
+    startSilenceTimer(t35);
+}
+
+void RtuFramer::flush() {
+    silenceTimer.stop();
+    if (frame.isEmpty()) {
+        return;
+    }
+
+    // 交出帧缓存，接收方保留句柄时缓冲不回池
+    RxBuffer out = std::move(frame);
+    bool violation = gapViolation;
+    gapViolation = false;
+    frames++;
+    if (violation) {
+        gapFrames++;
+    }
+    emit frameReady(out, frameStartNs, violation);
+}
+
+void RtuFramer::appendToFrame(const char *data, int count) {
+    if (count <= 0) {
+        return;
+    }
+    if (frame.isNull()) {
+        frame = pool->acquire(kMaxFrameSize);
+    }
+    frame.append(data, count);
+}
+
+void RtuFramer::reset() {
+    silenceTimer.stop();
+    frame = RxBuffer();
+    gapViolation = false;
+}
+
+void RtuFramer::onSilence() {
+    if (frame.isEmpty()) {
+        return;
+    }
+
+    // 设备还有未读数据，先让 readyRead 处理，由时间戳判定边界
+    if (pending && pending()) {
+        startSilenceTimer(t35);
+        return;
+    }
+
+    qint64 silent = clock.nsecsElapsed() - lastByteNs;
+    if (silent >= t35) {
+        flush();
+    } else {
+        startSilenceTimer(t35 - silent);
+    }
+}
+
+void RtuFramer::startSilenceTimer(qint64 remainingNs) {
+    // 定时器只有毫秒粒度，向上取整；边界判定以时间戳为准
+    int ms = int((remainingNs + 999999) / 1000000);
+    silenceTimer.start(qMax(1, ms));
+}
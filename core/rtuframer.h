@@ -0,0 +1,81 @@
+#ifndef RTUFRAMER_H
+#define RTUFRAMER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <functional>
+
+#include "bufferpool.h"
+
+// RtuFramer Modbus RTU 帧间隔分帧器
+// 每个接收块用单调时钟打时间戳，根据串口参数计算字符时间和 t1.5/t3.5，
+// 字节间静默超过 t3.5 即为帧边界；块内无法区分间隔，按字符时间估算块首字节时刻
+class RtuFramer : public QObject {
+    Q_OBJECT
+
+public:
+    using PendingProbe = std::function<bool()>;
+
+    explicit RtuFramer(QObject *parent = nullptr);
+
+    // 按串口参数计算字符时间；stopBits 可为 1、1.5、2
+    void configure(int baudRate, int dataBits, double stopBits, bool hasParity);
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled; }
+
+    // 帧缓存从接收缓冲池中取，不设置时使用内部的小池
+    void setBufferPool(BufferPool *bufferPool) { pool = bufferPool ? bufferPool : &ownPool; }
+
+    // 静默定时器到期时若设备仍有未读数据则继续等待
+    void setPendingProbe(PendingProbe probe) { pending = std::move(probe); }
+
+    qint64 charTimeNs() const { return charNs; }
+    qint64 t15Ns() const { return t15; }
+    qint64 t35Ns() const { return t35; }
+    qint64 nowNs() const { return clock.nsecsElapsed(); }
+    // 输出的帧数和其中字符间隔超过 t1.5 的帧数
+    qint64 frameCount() const { return frames; }
+    qint64 gapFrameCount() const { return gapFrames; }
+
+    // 输入一个接收块，timestampNs 为块到达时刻(单调时钟)
+    void feed(const RxBuffer &chunk);
+    void feed(const RxBuffer &chunk, qint64 timestampNs);
+
+    // 立即输出当前缓存的帧
+    void flush();
+    void reset();
+
+signals:
+    // interCharGap 为 true 表示帧内出现超过 t1.5 的字符间隔(规范要求丢弃此类帧)
+    void frameReady(const RxBuffer &frame, qint64 timestampNs, bool interCharGap);
+
+private slots:
+    void onSilence();
+
+private:
+    void startSilenceTimer(qint64 remainingNs);
+    void appendToFrame(const char *data, int count);
+
+    static const int kMaxFrameSize = 256;  // RTU ADU 最大长度
+
+    QElapsedTimer clock;
+    QTimer silenceTimer;
+    PendingProbe pending;
+    BufferPool ownPool{kMaxFrameSize, 2};
+    BufferPool *pool = &ownPool;
+    RxBuffer frame;                 // 当前帧缓存
+    qint64 frameStartNs = 0;        // 当前帧首字节时刻
+    qint64 lastByteNs = 0;          // 最后一个字节到达时刻
+    qint64 charNs = 0;              // 单字符时间
+    qint64 t15 = 0;
+    qint64 t35 = 0;
+    bool gapViolation = false;
+    bool enabled = false;
+    qint64 frames = 0;
+    qint64 gapFrames = 0;
+};
+
+#endif // RTUFRAMER_H
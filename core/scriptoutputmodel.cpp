@@ -0,0 +1,150 @@
+#include "scriptoutputmodel.h"
+
+#include <QStringList>
+
+ScriptOutputModel::ScriptOutputModel(QObject *parent) : QAbstractListModel(parent) {
+    ring.resize(1000);
+}
+
+int ScriptOutputModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : used;
+}
+
+QVariant ScriptOutputModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= used) {
+        return QVariant();
+    }
+    if (role == TextRole || role == Qt::DisplayRole) {
+        return line(index.row());
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> ScriptOutputModel::roleNames() const {
+    return {{TextRole, "text"}};
+}
+
+void ScriptOutputModel::setCapacity(int lines) {
+    lines = qMax(1, lines);
+    if (lines == ring.size()) {
+        return;
+    }
+
+    // 容量变化时按顺序重排，保留最近的行
+    int keep = qMin(used, lines);
+    QVector<QString> resized(lines);
+    for (int i = 0; i < keep; i++) {
+        resized[i] = line(used - keep + i);
+    }
+
+    beginResetModel();
+    overwrittenLines += used - keep;
+    ring = resized;
+    head = 0;
+    used = keep;
+    endResetModel();
+    emit capacityChanged();
+    emit countChanged();
+}
+
+void ScriptOutputModel::setSpillFile(const QString &filePath) {
+    if (filePath == spill.fileName() && (filePath.isEmpty() || spill.isOpen())) {
+        return;
+    }
+    spill.close();
+    spill.setFileName(filePath);
+    if (!filePath.isEmpty() && !spill.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        append(QString("无法写入输出文件: %1").arg(spill.errorString()));
+        spill.setFileName(QString());
+    }
+    emit spillFileChanged();
+}
+
+void ScriptOutputModel::append(const QString &text, const QString &prefix) {
+    QStringList lines = text.split('\n');
+    if (!prefix.isEmpty()) {
+        for (QString &l : lines) {
+            l.prepend(prefix);
+        }
+    }
+    appendedLines += lines.size();
+
+    if (spill.isOpen()) {
+        for (const QString &l : std::as_const(lines)) {
+            spill.write(l.toUtf8());
+            spill.write("\n", 1);
+        }
+        spill.flush();
+        spilledLines += lines.size();
+    }
+
+    const int cap = ring.size();
+    int n = lines.size();
+    if (n >= cap) {
+        // 一次超过容量，只保留最后 cap 行
+        beginResetModel();
+        overwrittenLines += used + n - cap;
+        for (int i = 0; i < cap; i++) {
+            ring[i] = lines[n - cap + i];
+        }
+        head = 0;
+        used = cap;
+        endResetModel();
+        emit countChanged();
+        return;
+    }
+
+    // 先移除会被覆盖的最早几行，再在末尾插入
+    int overflow = used + n - cap;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        for (int i = 0; i < overflow; i++) {
+            ring[(head + i) % cap].clear();
+        }
+        head = (head + overflow) % cap;
+        used -= overflow;
+        overwrittenLines += overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), used, used + n - 1);
+    for (int i = 0; i < n; i++) {
+        ring[(head + used + i) % cap] = lines[i];
+    }
+    used += n;
+    endInsertRows();
+    emit countChanged();
+}
+
+void ScriptOutputModel::clear() {
+    if (used == 0) {
+        return;
+    }
+    beginResetModel();
+    for (QString &l : ring) {
+        l.clear();
+    }
+    head = 0;
+    used = 0;
+    endResetModel();
+    emit countChanged();
+}
+
+QString ScriptOutputModel::text() const {
+    QStringList lines;
+    lines.reserve(used);
+    for (int i = 0; i < used; i++) {
+        lines.append(line(i));
+    }
+    return lines.join('\n');
+}
+
+QVariantMap ScriptOutputModel::getStats() const {
+    QVariantMap map;
+    map["lines"] = used;
+    map["capacity"] = ring.size();
+    map["appended"] = appendedLines;
+    map["overwritten"] = overwrittenLines;
+    map["spilled"] = spilledLines;
+    return map;
+}
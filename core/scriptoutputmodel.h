@@ -0,0 +1,60 @@
+#ifndef SCRIPTOUTPUTMODEL_H
+#define SCRIPTOUTPUTMODEL_H
+
+#include <QAbstractListModel>
+#include <QFile>
+#include <QVector>
+#include <QVariantMap>
+
+// ScriptOutputModel 脚本输出列表模型：固定容量的环形缓冲，满了覆盖最早的行
+// 追加只插入新行、移除溢出的旧行，不重建已有文本；可同时把全部输出写入文件
+class ScriptOutputModel : public QAbstractListModel {
+    Q_OBJECT
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(QString spillFile READ spillFile WRITE setSpillFile NOTIFY spillFileChanged)
+
+public:
+    enum Roles {
+        TextRole = Qt::UserRole + 1
+    };
+
+    explicit ScriptOutputModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int capacity() const { return ring.size(); }
+    void setCapacity(int lines);
+    int count() const { return used; }
+    // 输出文件路径，设置后每行同时追加写入该文件，空字符串关闭
+    QString spillFile() const { return spill.fileName(); }
+    void setSpillFile(const QString &filePath);
+
+    // 追加文本，按换行拆成多行，每行加前缀
+    Q_INVOKABLE void append(const QString &text, const QString &prefix = QString());
+    Q_INVOKABLE void clear();
+    // 当前保留的全部行，以换行连接
+    Q_INVOKABLE QString text() const;
+    // 统计：追加行数、覆盖行数和写入文件行数
+    Q_INVOKABLE QVariantMap getStats() const;
+
+signals:
+    void capacityChanged();
+    void countChanged();
+    void spillFileChanged();
+
+private:
+    const QString &line(int row) const { return ring[(head + row) % ring.size()]; }
+
+    QVector<QString> ring;
+    int head = 0;   // 最早一行在 ring 中的位置
+    int used = 0;   // 有效行数
+    QFile spill;
+    qint64 appendedLines = 0;
+    qint64 overwrittenLines = 0;
+    qint64 spilledLines = 0;
+};
+
+#endif // SCRIPTOUTPUTMODEL_H
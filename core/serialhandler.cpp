@@ -0,0 +1,1084 @@
+#include "serialhandler.h"
+#include "codec.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QMetaMethod>
+#include <QSerialPortInfo>
+
+#ifdef Q_OS_UNIX
+#include <sys/ioctl.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/serial.h>
+#endif
+
+SerialHandler::SerialHandler(QObject *parent) : QObject(parent) {
+    // 连接串口信号和槽
+    connect(&serial, &QSerialPort::readyRead, this, &SerialHandler::readSerialData);
+
+    // 连接TCP信号和槽
+    connect(&tcpSocket, &QTcpSocket::readyRead, this, &SerialHandler::readTcpData);
+    connect(&tcpSocket, &QTcpSocket::connected, this, &SerialHandler::onTcpConnected);
+    connect(&tcpSocket, &QTcpSocket::disconnected, this, &SerialHandler::onTcpDisconnected);
+    connect(&tcpSocket, &QTcpSocket::errorOccurred, this, &SerialHandler::onTcpError);
+
+    // 连接 TCP 服务器的信号和槽
+    connect(&tcpServer, &QTcpServer::newConnection, this, &SerialHandler::onNewClientConnected);
+
+    // 连接 UDP 信号和槽
+    connect(&udpSocket, &QUdpSocket::readyRead, this, &SerialHandler::readUdpData);
+
+    // 创建协程恢复定时器
+    connect(&coroutineTimer, &QTimer::timeout, this, &SerialHandler::resumeCoroutine);
+
+    // 创建等待响应超时定时器
+    responseTimer.setSingleShot(true);
+    connect(&responseTimer, &QTimer::timeout, this, &SerialHandler::handleResponseTimeout);
+
+    // 脚本输出合并：紧密循环中的 print 只追加到列表，回到事件循环后一次发出
+    outputTimer.setSingleShot(true);
+    outputTimer.setInterval(0);
+    connect(&outputTimer, &QTimer::timeout, this, &SerialHandler::flushScriptOutput);
+
+    // 定时发送引擎
+    connect(&periodicSender, &PeriodicSender::frameDue, this, &SerialHandler::onPeriodicFrameDue);
+
+    // 发送队列：合并写出，按设备积压节流
+    txQueue.setWriter([this](const QByteArray &chunk) { return writeBytes(chunk); });
+    txQueue.setBacklogProbe([this]() { return txBacklog(); });
+    connect(&serial, &QSerialPort::bytesWritten, &txQueue, &TxQueue::deviceDrained);
+    connect(&tcpSocket, &QTcpSocket::bytesWritten, &txQueue, &TxQueue::deviceDrained);
+    connect(&txQueue, &TxQueue::highWater, this, &SerialHandler::onTxHighWater, Qt::QueuedConnection);
+    connect(&txQueue, &TxQueue::lowWater, this, &SerialHandler::onTxLowWater, Qt::QueuedConnection);
+
+    // RTU 帧间隔分帧
+    connect(&rtuFramer, &RtuFramer::frameReady, this, &SerialHandler::onRtuFrame);
+    rtuFramer.setPendingProbe([this]() { return serialBytesPending(); });
+    rtuFramer.setBufferPool(&rxPool);
+
+    // 文件发送引擎
+    connect(&fileTransfer, &FileTransfer::progress, this, &SerialHandler::fileTransferProgress);
+    connect(&fileTransfer, &FileTransfer::finished, this, &SerialHandler::onFileTransferFinished);
+
+    // 标签导出
+    connect(&exporter, &Exporter::progress, this, &SerialHandler::exportProgress);
+    connect(&exporter, &Exporter::finished, this, &SerialHandler::exportFinished);
+
+    // 原生 Modbus 轮询：请求经当前连接写出，同样显示和记入历史
+    pollScheduler.setWriter([this](const QByteArray &frame) {
+        if (!writeBytes(frame)) {
+            return false;
+        }
+        const qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+        recordSent(frame, timestamp);
+        emit dataSent(frame, timestamp);
+        return true;
+    });
+    connect(&pollScheduler, &PollScheduler::overdue, this, [this](int id, qint64 lateMs) {
+        postScriptOutput(QString("轮询组 %1 错过截止时间 %2 ms").arg(id).arg(lateMs));
+    });
+    connect(&pollScheduler, &PollScheduler::valuesChanged, this, [this](int id, const QVariantList &changes) {
+        emit pollValuesChanged(id, changes, QDateTime::currentMSecsSinceEpoch());
+        callPollChangeCallback(id, changes);
+    });
+    connect(&pollScheduler, &PollScheduler::writeFinished, this, [this](int id, bool ok, const QString &error) {
+        if (!ok) {
+            postScriptOutput(QString("写入 %1 失败: %2").arg(id).arg(error));
+        }
+    });
+    connect(&pollScheduler, &PollScheduler::unitOffline, this, [this](int unit, qint64 retryMs) {
+        postScriptOutput(QString("从站 %1 无应答，暂停轮询，%2 ms 后探测").arg(unit).arg(retryMs));
+    });
+    connect(&pollScheduler, &PollScheduler::unitOnline, this, [this](int unit) {
+        postScriptOutput(QString("从站 %1 恢复应答").arg(unit));
+    });
+
+    // 会话历史默认写入临时文件
+    if (!history.open()) {
+        qDebug() << "Session history disabled:" << history.errorString();
+    }
+
+    // 虚拟串口脚本模式的应答由 Lua 处理函数生成
+    virtualSerial.setScriptHandler([this](const QByteArray &request) { return callVirtualDeviceHandler(request); });
+
+    // 初始化Lua
+    initLua();
+}
+
+SerialHandler::~SerialHandler() {
+    closeLua();
+}
+
+QString SerialHandler::getCurrentScript() const {
+    return currentScript;
+}
+
+void SerialHandler::setCurrentScript(const QString &script) {
+    if (currentScript != script) {
+        currentScript = script;
+        emit currentScriptChanged();
+    }
+}
+
+void SerialHandler::openPort(const QString &portName, const QString &baudRate,
+                             const QString &dataBits, const QString &stopBits,
+                             const QString &parity) {
+    // 关闭可能已经打开的TCP连接
+    if (tcpSocket.state() == QTcpSocket::ConnectedState) {
+        tcpSocket.disconnectFromHost();
+    }
+
+    // 关闭TCP服务器
+    if (tcpServer.isListening()) {
+        stopTcpServer();
+    }
+
+    // 关闭UDP连接
+    if (currentMode == ModeUdp) {
+        stopUdp();
+    }
+
+    // 虚拟串口在列表中以名称显示，打开时换成伪终端从端路径
+    bool isVirtual = virtualSerial.isOpen() && portName == virtualSerial.name();
+    serialIsVirtual = isVirtual;
+    serial.setPortName(isVirtual ? virtualSerial.devicePath() : portName);
+    serial.setBaudRate(baudRate.toInt());
+    serial.setDataBits(static_cast<QSerialPort::DataBits>(dataBits.toInt()));
+    serial.setStopBits(static_cast<QSerialPort::StopBits>(stopBits.toInt()));
+    serial.setParity(parity == "None" ? QSerialPort::NoParity :
+                         (parity == "Even" ? QSerialPort::EvenParity :
+                              QSerialPort::OddParity));
+
+    // 按串口参数计算 RTU 字符时间和 t1.5/t3.5
+    double stop = stopBits == "1.5" || stopBits == "3" ? 1.5 : stopBits.toDouble();
+    rtuFramer.reset();
+    rtuFramer.configure(baudRate.toInt(), dataBits.toInt(), stop, parity != "None");
+    if (isVirtual) {
+        virtualSerial.setBaudRate(baudRate.toInt(), 1 + dataBits.toInt() + (parity != "None" ? 1 : 0) + stop);
+    }
+
+    // 尝试打开串口
+    if (serial.open(QIODevice::ReadWrite)) {
+        qDebug() << "Port opened successfully!";
+        if (serialLowLatency) {
+            applySerialLowLatency(true);
+        }
+        isPortOpen = true;
+        currentMode = ModeSerial;
+        emit connectionStatusChanged(true, "串口已连接: " + portName);
+    } else {
+        qDebug() << "Failed to open port!";
+        emit connectionStatusChanged(false, "串口连接失败: " + serial.errorString());
+    }
+}
+
+void SerialHandler::closePort() {
+    if (serial.isOpen()) {
+        txQueue.clear();
+        rtuFramer.reset();
+        serial.close();
+        qDebug() << "Port closed!";
+        isPortOpen = false;
+        if (currentMode == ModeSerial) {
+            currentMode = ModeNone;
+            emit connectionStatusChanged(false, "串口已关闭");
+        }
+    }
+}
+
+void SerialHandler::connectToTcpServer(const QString &host, int port) {
+    // 关闭可能已经打开的串口
+    if (serial.isOpen()) {
+        serial.close();
+        isPortOpen = false;
+    }
+
+    // 关闭TCP服务器
+    if (tcpServer.isListening()) {
+        stopTcpServer();
+    }
+
+    // 关闭UDP连接
+    if (currentMode == ModeUdp) {
+        stopUdp();
+    }
+
+    // 连接到TCP服务器
+    tcpSocket.connectToHost(host, port);
+    qDebug() << "Connecting to TCP server:" << host << ":" << port;
+    emit connectionStatusChanged(false, "正在连接TCP服务器...");
+}
+
+void SerialHandler::disconnectFromTcpServer() {
+    if (tcpSocket.state() == QTcpSocket::ConnectedState) {
+        txQueue.clear();
+        tcpSocket.disconnectFromHost();
+        qDebug() << "Disconnected from TCP server";
+        if (currentMode == ModeTcp) {
+            currentMode = ModeNone;
+            emit connectionStatusChanged(false, "TCP连接已关闭");
+        }
+    }
+}
+
+bool SerialHandler::isTcpConnected() {
+    return tcpSocket.state() == QTcpSocket::ConnectedState;
+}
+
+bool SerialHandler::startTcpServer(int port) {
+    // 关闭可能已经打开的串口
+    if (serial.isOpen()) {
+        serial.close();
+        isPortOpen = false;
+    }
+
+    // 关闭TCP客户端连接
+    if (tcpSocket.state() == QTcpSocket::ConnectedState) {
+        tcpSocket.disconnectFromHost();
+    }
+
+    // 关闭UDP连接
+    if (currentMode == ModeUdp) {
+        stopUdp();
+    }
+
+    if (tcpServer.isListening()) {
+        tcpServer.close();
+    }
+
+    if (tcpServer.listen(QHostAddress::Any, port)) {
+        qDebug() << "TCP Server started on port:" << port;
+        currentMode = ModeTcpServer;
+        emit connectionStatusChanged(true, "TCP 服务器已启动: " + QString::number(port));
+        return true;
+    } else {
+        qDebug() << "Failed to start TCP Server!";
+        emit connectionStatusChanged(false, "TCP 服务器启动失败: " + tcpServer.errorString());
+        return false;
+    }
+}
+
+void SerialHandler::sendTcpServerData(const QString &data, bool isHex) {
+    QByteArray byteArray = isHex ? Codec::fromHexString(data) : data.toUtf8();
+    for (QTcpSocket *client : clients) {
+        if (client->state() == QAbstractSocket::ConnectedState) {
+            client->write(byteArray);
+        }
+    }
+    qDebug() << "Sent data to clients:" << data;
+}
+
+void SerialHandler::stopTcpServer() {
+    txQueue.clear();
+    for (QTcpSocket *client : clients) {
+        client->disconnectFromHost();
+    }
+    clients.clear();
+    tcpServer.close();
+    qDebug() << "TCP Server stopped!";
+    emit connectionStatusChanged(false, "TCP 服务器已关闭");
+}
+
+bool SerialHandler::startUdp(int localport, const QString &remoteHost, int remoteport) {
+    // 关闭可能已经打开的串口
+    if (serial.isOpen()) {
+        serial.close();
+        isPortOpen = false;
+    }
+
+    // 关闭TCP客户端连接
+    if (tcpSocket.state() == QTcpSocket::ConnectedState) {
+        tcpSocket.disconnectFromHost();
+    }
+
+    // 关闭TCP服务器
+    if (tcpServer.isListening()) {
+        stopTcpServer();
+    }
+
+    // 关闭已有的UDP连接
+    if (udpSocket.state() != QAbstractSocket::UnconnectedState) {
+        udpSocket.close();
+    }
+
+    if (udpSocket.bind(QHostAddress::Any, localport)) {
+        udpRemotePort = remoteport;
+        udpRemoteHost = remoteHost; // 记录远程 IP
+        qDebug() << "UDP listening on port:" << localport << "Remote:" << remoteHost << ":" << remoteport;
+        currentMode = ModeUdp;
+        emit connectionStatusChanged(true, "UDP 监听端口: " + QString::number(localport));
+        return true;
+    } else {
+        qDebug() << "Failed to start UDP listener!";
+        currentMode = ModeNone;
+        emit connectionStatusChanged(false, "UDP 监听失败: " + udpSocket.errorString());
+        return false;
+    }
+}
+
+void SerialHandler::stopUdp() {
+    if (currentMode == ModeUdp) {
+        udpSocket.close();
+        currentMode = ModeNone;
+        qDebug() << "UDP listener stopped!";
+        emit connectionStatusChanged(false, "UDP监听已停止");
+    }
+}
+
+void SerialHandler::sendUdpData(const QString &data, bool isHex, const QString &host, int port) {
+    QByteArray byteArray = isHex ? Codec::fromHexString(data) : data.toUtf8();
+    QHostAddress targetAddress(host);
+
+    if (targetAddress.isNull()) {
+        qDebug() << "Invalid UDP target address!";
+        return;
+    }
+
+    qint64 bytesSent = udpSocket.writeDatagram(byteArray, targetAddress, port);
+    if (bytesSent > 0) {
+        qDebug() << "Sent UDP data to" << host << ":" << port << "->" << data;
+    } else {
+        qDebug() << "Failed to send UDP data!";
+    }
+}
+
+QStringList SerialHandler::scanPorts() {
+    QStringList ports;
+    const auto serialPortInfos = QSerialPortInfo::availablePorts();
+    for (const QSerialPortInfo &serialPortInfo : serialPortInfos) {
+        ports << serialPortInfo.portName();
+    }
+    if (virtualSerial.isOpen()) {
+        ports << virtualSerial.name();
+    }
+    return ports;
+}
+
+bool SerialHandler::sendData(const QString &data, bool isHex, const QString &host, int port) {
+    if (fileTransfer.isActive()) {
+        qDebug() << "File transfer in progress, data dropped";
+        return false;
+    }
+
+    QByteArray byteArray = isHex ? Codec::fromHexString(data) : data.toUtf8();
+    bool sent = false;
+
+    if ((currentMode == ModeSerial && serial.isOpen())
+        || (currentMode == ModeTcp && tcpSocket.state() == QTcpSocket::ConnectedState)
+        || (currentMode == ModeTcpServer && hasConnectedClient())) {
+        // 流式连接经发送队列合并写出，队列满时丢弃
+        sent = txQueue.enqueue(byteArray);
+        if (!sent) {
+            qDebug() << "TX queue full, data dropped:" << byteArray.size() << "bytes";
+            return false;
+        }
+    } else if (currentMode == ModeUdp) { // UDP 模式，保持报文边界，不合并
+        QString targetHost = host.isEmpty() ? udpRemoteHost : host;
+        int targetPort = (port == 0) ? udpRemotePort : port;
+
+        if (targetHost.isEmpty() || targetPort == 0) {
+            qDebug() << "Error: UDP target host or port is invalid!";
+            return false;
+        }
+
+        sendUdpData(data, isHex, targetHost, targetPort);
+        sent = true;
+    }
+
+    if (sent) {
+        const qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+        recordSent(byteArray, timestamp);
+        emit dataSent(byteArray, timestamp);
+    }
+    return sent;
+}
+
+void SerialHandler::setRtuFraming(bool enable) {
+    rtuFramer.setEnabled(enable);
+}
+
+void SerialHandler::setRtuStrictGap(bool enable) {
+    rtuStrictGap = enable;
+}
+
+bool SerialHandler::isRtuFraming() {
+    return rtuFramer.isEnabled();
+}
+
+QVariantMap SerialHandler::getRtuTiming() {
+    QVariantMap timing;
+    timing["charUs"] = rtuFramer.charTimeNs() / 1000.0;
+    timing["t15Us"] = rtuFramer.t15Ns() / 1000.0;
+    timing["t35Us"] = rtuFramer.t35Ns() / 1000.0;
+    timing["frames"] = rtuFramer.frameCount();
+    timing["gapFrames"] = rtuFramer.gapFrameCount();
+    return timing;
+}
+
+bool SerialHandler::setSerialLowLatency(bool enable) {
+    serialLowLatency = enable;
+    return serial.isOpen() ? applySerialLowLatency(enable) : true;
+}
+
+QString SerialHandler::createVirtualSerial(const QString &mode) {
+    virtualSerial.setMode(VirtualSerial::modeFromString(mode));
+    if (!virtualSerial.open()) {
+        postScriptOutput("虚拟串口创建失败: " + virtualSerial.errorString());
+        return QString();
+    }
+    qDebug() << "Virtual serial" << virtualSerial.name() << "->" << virtualSerial.devicePath();
+    return virtualSerial.name();
+}
+
+void SerialHandler::closeVirtualSerial() {
+    if (serial.isOpen() && serialIsVirtual) {
+        closePort();
+    }
+    virtualSerial.close();
+}
+
+void SerialHandler::setVirtualSerialBaud(int baudRate) {
+    virtualSerial.setBaudRate(baudRate);
+}
+
+void SerialHandler::setVirtualSerialErrors(double dropRate, double corruptRate, int delayMs) {
+    virtualSerial.setErrorInjection(dropRate, corruptRate, delayMs);
+}
+
+void SerialHandler::setVirtualRegister(int address, int value) {
+    virtualSerial.setRegister(address, quint16(value));
+}
+
+QVariantMap SerialHandler::getVirtualSerialStats() {
+    return virtualSerial.statistics();
+}
+
+void SerialHandler::setTxQueueLimits(qint64 capacity, qint64 highWater, qint64 lowWater) {
+    txQueue.setLimits(capacity, highWater, lowWater);
+}
+
+qint64 SerialHandler::getTxQueueDepth() {
+    return txQueue.depth();
+}
+
+QVariantMap SerialHandler::getTxQueueStats() {
+    return txQueue.statistics();
+}
+
+QVariantMap SerialHandler::getRxPoolStats() {
+    QVariantMap stats = rxPool.statistics();
+    stats["chunks"] = rxChunkCount;
+    stats["bytes"] = rxByteCount;
+    return stats;
+}
+
+QVariantMap SerialHandler::getTriggerStats() {
+    return triggerEngine.statistics();
+}
+
+bool SerialHandler::setDissector(const QString &name, const QVariantMap &options) {
+    if (name.isEmpty() || name == "none") {
+        dissector.reset();
+        return true;
+    }
+
+    std::unique_ptr<Dissector> created;
+    if (luaDissectorRefs.contains(name)) {
+        int ref = luaDissectorRefs.value(name);
+        created.reset(new CallbackDissector(name, [this, ref](const char *data, int size, DissectedFrame &frame) {
+            return callLuaDissector(ref, data, size, frame);
+        }));
+    } else {
+        created = DissectorRegistry::create(name);
+    }
+    if (!created) {
+        return false;
+    }
+    created->configure(options);
+    dissector = std::move(created);
+    return true;
+}
+
+QString SerialHandler::getDissector() {
+    return dissector ? dissector->name() : QString();
+}
+
+QStringList SerialHandler::getDissectorNames() {
+    QStringList names = DissectorRegistry::names();
+    for (auto it = luaDissectorRefs.constBegin(); it != luaDissectorRefs.constEnd(); ++it) {
+        if (!names.contains(it.key())) {
+            names.append(it.key());
+        }
+    }
+    return names;
+}
+
+QVariantMap SerialHandler::getDissectorStats() {
+    return dissector ? dissector->statistics() : QVariantMap();
+}
+
+int SerialHandler::addPeriodicFrame(const QString &data, bool isHex, double periodMs, double phaseMs) {
+    QByteArray byteArray = isHex ? Codec::fromHexString(data) : data.toUtf8();
+    return periodicSender.addFrame(byteArray, periodMs, phaseMs);
+}
+
+bool SerialHandler::removePeriodicFrame(int id) {
+    return periodicSender.removeFrame(id);
+}
+
+void SerialHandler::clearPeriodicFrames() {
+    periodicSender.clear();
+}
+
+void SerialHandler::startPeriodicSend() {
+    periodicSender.start();
+}
+
+void SerialHandler::stopPeriodicSend() {
+    periodicSender.stop();
+}
+
+void SerialHandler::setPeriodicSpinUs(int us) {
+    periodicSender.setSpinThresholdUs(us);
+}
+
+QVariantList SerialHandler::getPeriodicStats() {
+    return periodicSender.statistics();
+}
+
+void SerialHandler::resetPeriodicStats() {
+    periodicSender.resetStatistics();
+}
+
+bool SerialHandler::startFileTransfer(const QString &filePath, const QString &protocol) {
+    QIODevice *device = nullptr;
+    if (currentMode == ModeSerial && serial.isOpen()) {
+        device = &serial;
+    } else if (currentMode == ModeTcp && tcpSocket.state() == QTcpSocket::ConnectedState) {
+        device = &tcpSocket;
+    }
+
+    transferError.clear();
+    if (!device) {
+        transferError = "当前连接模式不支持文件发送";
+        emit fileTransferFinished(false, transferError);
+        return false;
+    }
+
+    // 传输独占设备：发送队列暂停到 FileTransfer::finished，小文件可能在 start 内就已完成
+    txQueue.setPaused(true);
+    if (!fileTransfer.start(device, filePath, FileTransfer::protocolFromString(protocol))) {
+        txQueue.setPaused(false);
+        transferError = fileTransfer.errorString();
+        emit fileTransferFinished(false, transferError);
+        return false;
+    }
+    qDebug() << "File transfer started:" << filePath << protocol;
+    return true;
+}
+
+void SerialHandler::cancelFileTransfer() {
+    fileTransfer.cancel();
+}
+
+bool SerialHandler::isFileTransferActive() {
+    return fileTransfer.isActive();
+}
+
+bool SerialHandler::startCapture(const QString &filePath, const QString &format) {
+    ExportWriter::Format exportFormat;
+    if (!ExportWriter::formatFromString(format, &exportFormat) || isCapturing()) {
+        return false;
+    }
+    if (!exporter.startCapture(filePath, exportFormat)) {
+        return false;
+    }
+    // 只在录制期间连接，平时不影响 dataReceived 的无接收方优化
+    captureRxConnection = connect(this, &SerialHandler::dataReceived, this, [this](const QByteArray &data, qint64 timestamp) {
+        exporter.appendTraffic(QStringLiteral("rx"), data, timestamp);
+    });
+    captureTxConnection = connect(this, &SerialHandler::dataSent, this, [this](const QByteArray &data, qint64 timestamp) {
+        exporter.appendTraffic(QStringLiteral("tx"), data, timestamp);
+    });
+    qDebug() << "Capture started:" << filePath << format;
+    return true;
+}
+
+bool SerialHandler::stopCapture() {
+    disconnect(captureRxConnection);
+    disconnect(captureTxConnection);
+    return exporter.stopCapture();
+}
+
+bool SerialHandler::isCapturing() {
+    return exporter.isCapturing();
+}
+
+bool SerialHandler::exportTags(const QString &filePath, const QString &format,
+                               const QStringList &tags, qint64 from, qint64 to) {
+    ExportWriter::Format exportFormat;
+    if (!ExportWriter::formatFromString(format, &exportFormat)) {
+        return false;
+    }
+    return exporter.exportTags(&tagStore, filePath, exportFormat, tags, from, to);
+}
+
+void SerialHandler::cancelExport() {
+    exporter.cancelExport();
+}
+
+QVariantMap SerialHandler::getExportStats() {
+    return exporter.statistics();
+}
+
+int SerialHandler::addPollGroup(const QVariantMap &config) {
+    return pollScheduler.addGroup(config);
+}
+
+bool SerialHandler::removePollGroup(int id) {
+    return pollScheduler.removeGroup(id);
+}
+
+void SerialHandler::clearPollGroups() {
+    pollScheduler.clear();
+}
+
+// 轮询和写共用的总线参数，协议名无效时不做任何改动
+bool SerialHandler::configurePolling(const QVariantMap &options) {
+    // 默认按连接方式选择：串口为 RTU，网络为 Modbus TCP
+    Modbus::Protocol protocol = currentMode == ModeSerial ? Modbus::Rtu : Modbus::Tcp;
+    if (options.contains("protocol") && !Modbus::protocolFromString(options["protocol"].toString(), &protocol)) {
+        return false;
+    }
+    pollScheduler.stop();
+    pollScheduler.setProtocol(protocol);
+    pollScheduler.setTimeoutMs(options.value("timeout", responseTimeout).toInt());
+    pollScheduler.setFailureThreshold(options.value("failureThreshold", 3).toInt());
+    pollScheduler.setProbeIntervalMs(options.value("probeInterval", 1000).toInt());
+    pollScheduler.setMaxBackoffMs(options.value("maxBackoff", 10000).toInt());
+    if (options.contains("turnaround")) {
+        pollScheduler.setTurnaroundUs(qint64(options["turnaround"].toDouble() * 1000));
+    } else {
+        pollScheduler.setTurnaroundUs(protocol == Modbus::Rtu && currentMode == ModeSerial ? rtuFramer.t35Ns() / 1000 : 0);
+    }
+    pollScheduler.setReadWriteEnabled(options.value("readWrite", false).toBool());
+    return true;
+}
+
+bool SerialHandler::startPolling(const QVariantMap &options) {
+    if (!configurePolling(options)) {
+        return false;
+    }
+    pollingConfigured = true;
+    pollScheduler.start();
+    qDebug() << "Polling started:" << (pollScheduler.currentProtocol() == Modbus::Rtu ? "rtu" : "tcp");
+    return true;
+}
+
+void SerialHandler::stopPolling() {
+    pollScheduler.stop();
+}
+
+bool SerialHandler::isPolling() {
+    return pollScheduler.isRunning();
+}
+
+QVariantList SerialHandler::getPollStats() {
+    return pollScheduler.statistics();
+}
+
+QVariantList SerialHandler::getPollUnitStats() {
+    return pollScheduler.unitStatistics();
+}
+
+int SerialHandler::queueWrite(const QVariantMap &config) {
+    // 从未启动过轮询时按当前连接的默认参数发送，否则沿用上次 startPolling 的参数
+    if (!pollingConfigured && !pollScheduler.isRunning() && pollScheduler.pendingWrites() == 0) {
+        configurePolling(QVariantMap());
+    }
+    return pollScheduler.queueWrite(config);
+}
+
+QVariantMap SerialHandler::getWriteStats() {
+    return pollScheduler.writeStatistics();
+}
+
+QVariantList SerialHandler::searchHistory(const QVariantMap &filter) {
+    SessionHistory::Query query;
+    if (filter.contains("from")) {
+        query.from = filter["from"].toLongLong();
+    }
+    if (filter.contains("to") && filter["to"].toLongLong() > 0) {
+        query.to = filter["to"].toLongLong();
+    }
+    const QString direction = filter.value("direction").toString();
+    if (!direction.isEmpty() && direction != "all") {
+        const int value = SessionHistory::directionFromName(direction);
+        query.directions = value >= 0 ? 1 << value : 0;
+    }
+    const QString transport = filter.value("transport").toString();
+    if (!transport.isEmpty() && transport != "all") {
+        const int value = SessionHistory::transportFromName(transport);
+        query.transports = value >= 0 ? 1 << value : 0;
+    }
+    if (filter.contains("hex")) {
+        query.pattern = Codec::fromHexString(filter["hex"].toString());
+    } else if (filter.contains("text")) {
+        query.pattern = filter["text"].toString().toUtf8();
+    }
+    if (filter.contains("limit")) {
+        query.limit = filter["limit"].toInt();
+    }
+    query.newestFirst = !filter.value("oldestFirst").toBool();
+
+    const QVector<SessionHistory::Hit> hits = history.search(query);
+    QVariantList list;
+    list.reserve(hits.size());
+    for (const SessionHistory::Hit &hit : hits) {
+        QVariantMap map;
+        map["index"] = hit.index;
+        map["time"] = hit.time;
+        map["direction"] = SessionHistory::directionName(hit.direction);
+        map["transport"] = SessionHistory::transportName(hit.transport);
+        map["size"] = hit.data.size();
+        map["hex"] = Codec::toHexString(hit.data);
+        map["match"] = hit.matchOffset;
+        map["carried"] = hit.carried;
+        list.append(map);
+    }
+    return list;
+}
+
+QVariantMap SerialHandler::getHistoryStats() {
+    return history.statistics();
+}
+
+bool SerialHandler::setHistoryFile(const QString &filePath) {
+    if (history.open(filePath)) {
+        qDebug() << "Session history:" << history.filePath();
+        return true;
+    }
+    // 打开失败时退回临时文件，继续记录
+    qDebug() << "Failed to open session history:" << history.errorString();
+    history.open();
+    return false;
+}
+
+void SerialHandler::clearHistory() {
+    history.clear();
+}
+
+// 读取串口数据：读入池化缓冲，超过块大小时分块处理
+void SerialHandler::readSerialData() {
+    while (serial.bytesAvailable() > 0) {
+        RxBuffer chunk = rxPool.acquire();
+        qint64 n = serial.read(chunk.data(), chunk.capacity());
+        if (n <= 0) {
+            break;
+        }
+        chunk.resize(int(n));
+        countReceived(chunk);
+        scanTriggers(chunk);
+        dissect(chunk);
+        pollScheduler.feed(chunk.constData(), chunk.size());
+
+        if (fileTransfer.handleIncoming(chunk.view())) {
+            processReceivedData(chunk);
+            continue;
+        }
+
+        // RTU 分帧模式下交给分帧器，完整帧通过 onRtuFrame 处理
+        if (rtuFramer.isEnabled()) {
+            rtuFramer.feed(chunk);
+            continue;
+        }
+
+        deliverToScript(chunk);
+    }
+}
+
+// 读取TCP数据
+void SerialHandler::readTcpData() {
+    while (tcpSocket.bytesAvailable() > 0) {
+        RxBuffer chunk = rxPool.acquire();
+        qint64 n = tcpSocket.read(chunk.data(), chunk.capacity());
+        if (n <= 0) {
+            break;
+        }
+        chunk.resize(int(n));
+        countReceived(chunk);
+        scanTriggers(chunk);
+        dissect(chunk);
+        pollScheduler.feed(chunk.constData(), chunk.size());
+
+        if (fileTransfer.handleIncoming(chunk.view())) {
+            processReceivedData(chunk);
+            continue;
+        }
+        deliverToScript(chunk);
+    }
+}
+
+// 处理TCP连接成功
+void SerialHandler::onTcpConnected() {
+    qDebug() << "Connected to TCP server!";
+    currentMode = ModeTcp;
+    emit connectionStatusChanged(true, "TCP服务器已连接");
+}
+
+// 处理TCP断开连接
+void SerialHandler::onTcpDisconnected() {
+    qDebug() << "Disconnected from TCP server!";
+    if (currentMode == ModeTcp) {
+        currentMode = ModeNone;
+        emit connectionStatusChanged(false, "TCP连接已断开");
+    }
+}
+
+// 处理TCP错误
+void SerialHandler::onTcpError(QAbstractSocket::SocketError socketError) {
+    qDebug() << "TCP Socket error:" << socketError << tcpSocket.errorString();
+    emit connectionStatusChanged(false, "TCP错误: " + tcpSocket.errorString());
+}
+
+//TCP Server相关
+void SerialHandler::onNewClientConnected() {
+    QTcpSocket *clientSocket = tcpServer.nextPendingConnection();
+    if (clientSocket) {
+        clients.append(clientSocket);
+        connect(clientSocket, &QTcpSocket::readyRead, this, &SerialHandler::readTcpServerData);
+        connect(clientSocket, &QTcpSocket::disconnected, this, &SerialHandler::onClientDisconnected);
+        connect(clientSocket, &QTcpSocket::bytesWritten, &txQueue, &TxQueue::deviceDrained);
+        qDebug() << "New client connected!";
+        currentMode = ModeTcpServer;
+        emit connectionStatusChanged(true, "客户端已连接");
+    }
+}
+
+void SerialHandler::onClientDisconnected() {
+    QTcpSocket *client = qobject_cast<QTcpSocket *>(sender());
+    if (client) {
+        clients.removeAll(client);
+        client->deleteLater();
+        qDebug() << "Client disconnected!";
+        currentMode = ModeNone;
+        emit connectionStatusChanged(false, "客户端已断开连接");
+    }
+}
+
+void SerialHandler::readTcpServerData() {
+    QTcpSocket *client = qobject_cast<QTcpSocket *>(sender());
+    if (!client) {
+        return;
+    }
+    while (client->bytesAvailable() > 0) {
+        RxBuffer chunk = rxPool.acquire();
+        qint64 n = client->read(chunk.data(), chunk.capacity());
+        if (n <= 0) {
+            break;
+        }
+        chunk.resize(int(n));
+        countReceived(chunk);
+        scanTriggers(chunk);
+        dissect(chunk);
+        pollScheduler.feed(chunk.constData(), chunk.size());
+        hasNewData = true;  // 设置标志位
+        processReceivedData(chunk);
+    }
+}
+
+//UDP
+void SerialHandler::readUdpData() {
+    while (udpSocket.hasPendingDatagrams()) {
+        // 超过块大小的报文由缓冲池单独分配
+        RxBuffer datagram = rxPool.acquire(int(udpSocket.pendingDatagramSize()));
+        qint64 n = udpSocket.readDatagram(datagram.data(), datagram.capacity());
+        if (n < 0) {
+            break;
+        }
+        datagram.resize(int(n));
+        countReceived(datagram);
+        scanTriggers(datagram);
+        dissect(datagram);
+        pollScheduler.feed(datagram.constData(), datagram.size());
+        hasNewData = true;  // 设置标志位
+        processReceivedData(datagram);
+    }
+}
+
+// 定时发送帧到期
+void SerialHandler::onPeriodicFrameDue(int id, const QByteArray &data) {
+    Q_UNUSED(id);
+    if (writeBytes(data)) {
+        const qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+        recordSent(data, timestamp);
+        emit dataSent(data, timestamp);
+    }
+}
+
+// RTU 分帧器输出完整帧
+void SerialHandler::onRtuFrame(const RxBuffer &frame, qint64 timestampNs, bool interCharGap) {
+    Q_UNUSED(timestampNs);
+    // 字符间隔超过 t1.5 的帧计入 gapFrames，照常交给脚本由 CRC 判断；
+    // 严格模式按规范丢弃：照常显示，不交给脚本
+    if (interCharGap && rtuStrictGap) {
+        processReceivedData(frame);
+        return;
+    }
+    deliverToScript(frame);
+}
+
+// 发送队列越过高水位，通知Lua回调
+void SerialHandler::onTxHighWater(qint64 depth) {
+    callLuaCallback(txHighWaterRef, depth);
+}
+
+// 保存数据供Lua使用，显示后检查等待响应的协程
+void SerialHandler::deliverToScript(const RxBuffer &data) {
+    lastReceivedData = data;  // 只持有缓冲句柄，不拷贝
+    hasNewData = true;  // 设置标志位
+    processReceivedData(data);
+
+    // 如果有等待响应的协程，检查是否收到期望的数据
+    if (waitingForResponse && isCoroutineRunning) {
+        checkAndResumeCoroutine();
+    }
+}
+
+void SerialHandler::countReceived(const RxBuffer &chunk) {
+    rxChunkCount++;
+    rxByteCount += chunk.size();
+    history.append(SessionHistory::Received, historyTransport(), chunk.constData(), chunk.size(),
+                   QDateTime::currentMSecsSinceEpoch());
+}
+
+void SerialHandler::recordSent(const QByteArray &data, qint64 timestamp) {
+    history.append(SessionHistory::Sent, historyTransport(), data.constData(), data.size(), timestamp);
+}
+
+int SerialHandler::historyTransport() const {
+    switch (currentMode) {
+    case ModeTcp:
+        return SessionHistory::Tcp;
+    case ModeTcpServer:
+        return SessionHistory::TcpServer;
+    case ModeUdp:
+        return SessionHistory::Udp;
+    default:
+        return SessionHistory::Serial;
+    }
+}
+
+// 处理收到的数据（通用）
+void SerialHandler::processReceivedData(const RxBuffer &rawData) {
+    // 没有接收方时不拷贝出缓冲池；有接收方时拷贝一次：界面模型按行保存数据，
+    // 直接共享池块会让每一行占住一整块(16KB)，池随显示行数增长
+    static const QMetaMethod receivedSignal = QMetaMethod::fromSignal(&SerialHandler::dataReceived);
+    if (!isSignalConnected(receivedSignal)) {
+        return;
+    }
+
+    // 只传原始字节和时间戳，显示格式化由界面模型按需完成
+    emit dataReceived(rawData.toByteArray(), QDateTime::currentMSecsSinceEpoch());
+}
+
+// 按当前连接模式写出原始字节
+bool SerialHandler::writeBytes(const QByteArray &byteArray) {
+    // 文件传输期间插入其他字节会破坏块序列
+    if (fileTransfer.isActive()) {
+        return false;
+    }
+    if (currentMode == ModeSerial && serial.isOpen()) {
+        serial.write(byteArray);
+        return true;
+    } else if (currentMode == ModeTcp && tcpSocket.state() == QTcpSocket::ConnectedState) {
+        tcpSocket.write(byteArray);
+        return true;
+    } else if (currentMode == ModeTcpServer) {
+        // 没有已连接的客户端时算作未发送
+        bool written = false;
+        for (QTcpSocket *client : clients) {
+            if (client->state() == QAbstractSocket::ConnectedState) {
+                client->write(byteArray);
+                written = true;
+            }
+        }
+        return written;
+    } else if (currentMode == ModeUdp) {
+        QHostAddress targetAddress(udpRemoteHost);
+        if (targetAddress.isNull() || udpRemotePort == 0) {
+            return false;
+        }
+        return udpSocket.writeDatagram(byteArray, targetAddress, udpRemotePort) > 0;
+    }
+    return false;
+}
+
+// 串口是否还有未读入的数据(Qt缓冲或内核缓冲)
+bool SerialHandler::serialBytesPending() {
+    if (serial.bytesAvailable() > 0) {
+        return true;
+    }
+#ifdef Q_OS_UNIX
+    int available = 0;
+    if (serial.isOpen() && ::ioctl(serial.handle(), FIONREAD, &available) == 0) {
+        return available > 0;
+    }
+#endif
+    return false;
+}
+
+// 设置tty低延迟标志，USB转串口同时调整 latency_timer
+bool SerialHandler::applySerialLowLatency(bool enable) {
+#ifdef Q_OS_LINUX
+    bool ok = false;
+    struct serial_struct info;
+    if (::ioctl(serial.handle(), TIOCGSERIAL, &info) == 0) {
+        if (enable) {
+            info.flags |= ASYNC_LOW_LATENCY;
+        } else {
+            info.flags &= ~ASYNC_LOW_LATENCY;
+        }
+        ok = ::ioctl(serial.handle(), TIOCSSERIAL, &info) == 0;
+    }
+
+    QFile latencyTimer(QString("/sys/bus/usb-serial/devices/%1/latency_timer").arg(serial.portName()));
+    if (latencyTimer.exists() && latencyTimer.open(QIODevice::WriteOnly)) {
+        ok = latencyTimer.write(enable ? "1" : "16") > 0 || ok;
+    }
+
+    qDebug() << "Serial low latency" << enable << (ok ? "applied" : "not supported");
+    return ok;
+#else
+    Q_UNUSED(enable);
+    return false;
+#endif
+}
+
+// 设备写缓冲中尚未发出的字节数
+bool SerialHandler::hasConnectedClient() const {
+    for (QTcpSocket *client : clients) {
+        if (client->state() == QAbstractSocket::ConnectedState) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 SerialHandler::txBacklog() const {
+    if (currentMode == ModeSerial) {
+        return serial.bytesToWrite();
+    } else if (currentMode == ModeTcp) {
+        return tcpSocket.bytesToWrite();
+    } else if (currentMode == ModeTcpServer) {
+        qint64 maxBacklog = 0;
+        for (QTcpSocket *client : clients) {
+            maxBacklog = qMax(maxBacklog, client->bytesToWrite());
+        }
+        return maxBacklog;
+    }
+    return 0;
+}
+
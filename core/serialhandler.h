@@ -0,0 +1,395 @@
+#ifndef SERIALHANDLER_H
+#define SERIALHANDLER_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QTcpSocket>
+#include <QTcpServer>
+#include <QUdpSocket>
+#include <QTimer>
+#include <QVariantMap>
+#include <QHash>
+
+#include "periodicsender.h"
+#include "filetransfer.h"
+#include "txqueue.h"
+#include "rtuframer.h"
+#include "virtualserial.h"
+#include "bufferpool.h"
+#include "luaallocator.h"
+#include "triggerengine.h"
+#include "dissector.h"
+#include "tagstore.h"
+#include "exporter.h"
+#include "sessionhistory.h"
+#include "pollscheduler.h"
+
+struct lua_State;
+class LuaBindings;
+
+// SerialHandler 类用于处理串口和TCP UDP操作
+// 传输层在 serialhandler.cpp，Lua 脚本引擎和绑定在 luabindings.cpp，编解码在 codec.cpp
+class SerialHandler : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QString currentScript READ getCurrentScript WRITE setCurrentScript NOTIFY currentScriptChanged)
+    friend class LuaBindings;
+
+public:
+    explicit SerialHandler(QObject *parent = nullptr);
+    ~SerialHandler();
+
+    // 脚本访问方法
+    QString getCurrentScript() const;
+    void setCurrentScript(const QString &script);
+
+    // === 连接 ===
+
+    // 打开/关闭串口
+    Q_INVOKABLE void openPort(const QString &portName, const QString &baudRate,
+                              const QString &dataBits, const QString &stopBits,
+                              const QString &parity);
+    Q_INVOKABLE void closePort();
+
+    // 连接/断开TCP服务器
+    Q_INVOKABLE void connectToTcpServer(const QString &host, int port);
+    Q_INVOKABLE void disconnectFromTcpServer();
+    Q_INVOKABLE bool isTcpConnected();
+
+    // TCP 服务器
+    Q_INVOKABLE bool startTcpServer(int port);
+    Q_INVOKABLE void sendTcpServerData(const QString &data, bool isHex);
+    Q_INVOKABLE void stopTcpServer();
+
+    // 绑定/停止 UDP 端口
+    Q_INVOKABLE bool startUdp(int localport, const QString &remoteHost, int remoteport);
+    Q_INVOKABLE void stopUdp();
+    Q_INVOKABLE void sendUdpData(const QString &data, bool isHex, const QString &host, int port);
+
+    // 扫描可用串口(包含已创建的虚拟串口)
+    Q_INVOKABLE QStringList scanPorts();
+
+    // 发送数据 (支持HEX和ASCII，串口和TCP和UDP)，队列满或未连接时返回false
+    Q_INVOKABLE bool sendData(const QString &data, bool isHex, const QString &host = "", int port = 0);
+
+    // === 串口分帧 ===
+
+    // 启用/关闭 RTU 帧间隔分帧：按 t3.5 静默切分帧，而不是按 readAll 的返回块
+    Q_INVOKABLE void setRtuFraming(bool enable);
+    Q_INVOKABLE bool isRtuFraming();
+    // 丢弃帧内字符间隔超过 t1.5 的帧(默认关闭，只计数)；间隔由读取时刻推算，
+    // 事件循环或 USB 转串口的延迟也会被当作间隔，需配合 setSerialLowLatency(true)
+    Q_INVOKABLE void setRtuStrictGap(bool enable);
+    // 获取当前串口参数下的字符时间和 t1.5/t3.5(微秒)，以及分帧输出和字符间隔超过 t1.5 的帧数
+    Q_INVOKABLE QVariantMap getRtuTiming();
+    // 串口低延迟模式(Linux: ASYNC_LOW_LATENCY 和 USB 转串口 latency_timer)
+    Q_INVOKABLE bool setSerialLowLatency(bool enable);
+
+    // === 虚拟串口 ===
+
+    // 创建虚拟串口对，mode 为 echo/modbus/script，返回端口名称(失败返回空)
+    Q_INVOKABLE QString createVirtualSerial(const QString &mode);
+    // 关闭虚拟串口，正在使用时先关闭串口
+    Q_INVOKABLE void closeVirtualSerial();
+    // 虚拟设备按波特率限速应答，0 为不限速(打开串口时按串口参数自动设置)
+    Q_INVOKABLE void setVirtualSerialBaud(int baudRate);
+    // 错误注入：丢弃应答概率、误码概率(0~1)和应答延迟(毫秒)
+    Q_INVOKABLE void setVirtualSerialErrors(double dropRate, double corruptRate, int delayMs);
+    // 设置虚拟 Modbus 从站的保持寄存器
+    Q_INVOKABLE void setVirtualRegister(int address, int value);
+    Q_INVOKABLE QVariantMap getVirtualSerialStats();
+
+    // === 发送队列 ===
+
+    // 设置发送队列容量和高/低水位(字节)
+    // 流式连接的 dataSent 和会话历史在入队时记录，表示"已被发送队列接受"；
+    // 之后因连接断开而丢弃的字节计入 getTxQueueStats 的 droppedBytes
+    Q_INVOKABLE void setTxQueueLimits(qint64 capacity, qint64 highWater, qint64 lowWater);
+    // 当前发送队列深度(队列 + 设备写缓冲)
+    Q_INVOKABLE qint64 getTxQueueDepth();
+    Q_INVOKABLE QVariantMap getTxQueueStats();
+
+    // === 接收缓冲 ===
+
+    // 接收缓冲池统计：块数、取块次数和堆分配次数，以及累计接收块数/字节数
+    // 分配次数只统计池本身：读入、分帧、脚本交付不分配；dataReceived 有接收方(界面、CLI 输出)时
+    // 每块另拷贝一次，因为接收方会长期保存数据(行模型最多 maxRows 行)，持有池块会把池撑大
+    Q_INVOKABLE QVariantMap getRxPoolStats();
+    BufferPool::Stats rxPoolStats() const { return rxPool.stats(); }
+    qint64 receivedBytes() const { return rxByteCount; }
+
+    // === 接收触发器 ===
+
+    // 触发器统计：触发器数、自动机状态数、扫描/预过滤跳过字节数、候选和命中次数
+    Q_INVOKABLE QVariantMap getTriggerStats();
+
+    // === 协议解析 ===
+
+    // 选择接收数据的解析器(内置或脚本注册的名称)，空字符串关闭解析；options 为解析器参数
+    Q_INVOKABLE bool setDissector(const QString &name, const QVariantMap &options = QVariantMap());
+    Q_INVOKABLE QString getDissector();
+    // 可用的解析器名称
+    Q_INVOKABLE QStringList getDissectorNames();
+    // 解析统计：帧数、校验失败帧数、解析和跳过的字节数
+    Q_INVOKABLE QVariantMap getDissectorStats();
+
+    // === 标签数据 ===
+
+    // 轮询值的时间序列存储，脚本 recordTag 写入，界面和脚本按时间范围查询
+    TagStore *getTagStore() { return &tagStore; }
+
+    // === 导出 ===
+
+    // 录制收发数据到文件，format 为 "csv" 或 "columnar"(.mjcol 列式二进制)，编码和写入在后台线程进行
+    Q_INVOKABLE bool startCapture(const QString &filePath, const QString &format = "csv");
+    Q_INVOKABLE bool stopCapture();
+    Q_INVOKABLE bool isCapturing();
+    // 导出标签历史，tags 为空时导出全部标签，to 为 0 时不限结束时间；完成后发出 exportFinished
+    Q_INVOKABLE bool exportTags(const QString &filePath, const QString &format = "csv",
+                                const QStringList &tags = QStringList(), qint64 from = 0, qint64 to = 0);
+    Q_INVOKABLE void cancelExport();
+    // 导出统计：录制/导出的文件、行数和字节数
+    Q_INVOKABLE QVariantMap getExportStats();
+    QString exportError() const { return exporter.errorString(); }
+
+    // === Modbus 轮询 ===
+
+    // 添加轮询组 {unit=, func=1~4, addr=, count=, period=ms, priority=, deadline=ms, format="UINT16"/"FLOAT_ABCD"..., deadband=}
+    // 返回组ID，参数不合法时返回 -1(原因见 pollError)；读到的值按 "从站/功能码/地址" 记入标签存储
+    // 只有变化(模拟量超过 deadband)的值通过 pollValuesChanged 和脚本 onPollChange 上报
+    Q_INVOKABLE int addPollGroup(const QVariantMap &config);
+    Q_INVOKABLE bool removePollGroup(int id);
+    Q_INVOKABLE void clearPollGroups();
+    // 开始轮询 {protocol="rtu"/"tcp", timeout=ms, failureThreshold=, probeInterval=ms, maxBackoff=ms, turnaround=ms, readWrite=false}
+    // protocol 默认串口为 rtu、网络为 tcp；timeout 默认为 setResponseTimeout 的值；RTU 串口的 turnaround 默认为 t3.5
+    // 从站连续 failureThreshold 次(默认 3)失败后离线，每 probeInterval(默认 1000，失败加倍至 maxBackoff)探测一次
+    // readWrite 为 true 时寄存器写和同站到期的 0x03 轮询合并为 0x17
+    Q_INVOKABLE bool startPolling(const QVariantMap &options = QVariantMap());
+    Q_INVOKABLE void stopPolling();
+    Q_INVOKABLE bool isPolling();
+    // 每组统计：polls/responses/timeouts/exceptions/errors、misses(错过截止时间)、maxLateMs、actualPeriodMs、backoffMs
+    Q_INVOKABLE QVariantList getPollStats();
+    // 每个从站的健康状态：unit、state("closed"/"open"/"half-open")、failures、timeouts、crcErrors、exceptions、trips、probes、retryMs
+    Q_INVOKABLE QVariantList getPollUnitStats();
+    // 排队写入 {unit=, addr=, value= 或 values={...}, coil=false, priority=0}，返回写ID，参数不合法时返回 -1
+    // 相邻的写合并为一帧 0x10/0x0F，与轮询按优先级交替发送(同优先级写在前)；未启动轮询时也直接发送，沿用上次 startPolling 的协议和超时，从未启动过时按当前连接的默认值
+    Q_INVOKABLE int queueWrite(const QVariantMap &config);
+    // 写统计：queued/merged/frames/readWriteFrames/ok/failed/pending/meanLatencyMs/maxLatencyMs
+    Q_INVOKABLE QVariantMap getWriteStats();
+    QString pollError() const { return pollScheduler.errorString(); }
+
+    // === 会话历史 ===
+
+    // 收发记录写入磁盘历史文件，按块索引检索
+    // filter: from/to 毫秒时间, direction "rx"/"tx", transport "serial"/"tcp"/"tcpserver"/"udp",
+    //         hex 或 text 字节模式, limit 条数上限(默认 1000), oldestFirst 从旧到新
+    // 返回 [{index, time, direction, transport, size, hex, match, carried}]，match 为模式所在字节位置；
+    // 模式可从同方向同传输方式前面记录的最后 32 字节开始，此时 match 为 0，carried 为模式在前面记录中的字节数
+    Q_INVOKABLE QVariantList searchHistory(const QVariantMap &filter);
+    // 历史统计：记录数、文件大小、块数、索引内存，以及最近一次查询的扫描/跳过块数和耗时
+    Q_INVOKABLE QVariantMap getHistoryStats();
+    // 换用指定的历史文件(已有历史继续追加)，空路径为临时文件；打开失败时退回临时文件并返回 false
+    Q_INVOKABLE bool setHistoryFile(const QString &filePath);
+    Q_INVOKABLE void clearHistory();
+
+    // === 定时发送 ===
+
+    // 添加定时发送帧，返回帧ID（失败返回-1）
+    Q_INVOKABLE int addPeriodicFrame(const QString &data, bool isHex, double periodMs, double phaseMs = 0);
+    Q_INVOKABLE bool removePeriodicFrame(int id);
+    Q_INVOKABLE void clearPeriodicFrames();
+    Q_INVOKABLE void startPeriodicSend();
+    Q_INVOKABLE void stopPeriodicSend();
+    // 设置忙等阈值(微秒)，用于亚毫秒级发送精度，0为关闭
+    Q_INVOKABLE void setPeriodicSpinUs(int us);
+    // 获取各帧抖动统计
+    Q_INVOKABLE QVariantList getPeriodicStats();
+    Q_INVOKABLE void resetPeriodicStats();
+
+    // === 文件发送 ===
+
+    // 发送文件，protocol: "raw" / "xmodem" / "ymodem"，仅支持串口和TCP客户端；失败原因见 fileTransferError
+    // 传输期间发送队列暂停，定时发送和轮询请求不写出，避免插入块序列
+    Q_INVOKABLE bool startFileTransfer(const QString &filePath, const QString &protocol);
+    Q_INVOKABLE void cancelFileTransfer();
+    Q_INVOKABLE bool isFileTransferActive();
+    QString fileTransferError() const { return transferError; }
+
+    // === Lua脚本 ===
+
+    // 执行Lua脚本，返回执行状态
+    Q_INVOKABLE QString executeLuaScript(const QString &script);
+    // 加载并执行Lua脚本文件
+    Q_INVOKABLE QString loadLuaScriptFile(const QString &filePath);
+    // 保存Lua脚本到文件
+    Q_INVOKABLE bool saveLuaScriptToFile(const QString &script, const QString &filePath);
+    // 脚本是否仍在运行(协程挂起等待中也算运行)
+    Q_INVOKABLE bool isScriptRunning();
+    Q_INVOKABLE void stopLuaScript();
+    // 脚本 log 输出级别：debug/info/warn/error/off，低于该级别的 log 调用不做格式化
+    Q_INVOKABLE bool setScriptLogLevel(const QString &level);
+    Q_INVOKABLE QString getScriptLogLevel();
+    // Lua 垃圾回收模式："incremental"(pause, stepmul) 或 "generational"(minormul, majormul)，参数 0 为默认值
+    Q_INVOKABLE bool setLuaGcMode(const QString &mode, int param1 = 0, int param2 = 0);
+    Q_INVOKABLE void collectLuaGarbage();
+    // Lua 内存统计：占用字节、GC 模式、主线程栈深度、累计协程数和分配器统计
+    Q_INVOKABLE QVariantMap getLuaMemoryStats();
+
+signals:
+    void currentScriptChanged();
+    // 数据相关信号：原始字节和毫秒时间戳，显示格式由 TrafficModel 决定
+    void dataReceived(const QByteArray &data, qint64 timestamp);
+    // 串口/TCP 经发送队列的数据在入队时发出，不代表已写入设备(见发送队列)
+    void dataSent(const QByteArray &data, qint64 timestamp);
+    // 解析出的一帧 {protocol=, offset=, raw=, valid=, summary=, fields={...}}
+    void frameDecoded(const QVariantMap &frame, qint64 timestamp);
+    // 轮询组中变化的值 [{tag=, addr=, value=, previous=}]
+    void pollValuesChanged(int id, const QVariantList &changes, qint64 timestamp);
+    // 连接状态信号
+    void connectionStatusChanged(bool connected, const QString &message);
+    // 脚本状态信号
+    void scriptSchedulerStatusChanged(bool running, const QString &message);
+    // Lua脚本输出信号：同一轮事件循环内的输出合并为一次，多行以换行分隔
+    void luaOutput(const QString &output);
+    // 文件发送信号
+    void fileTransferProgress(qint64 sent, qint64 total);
+    void fileTransferFinished(bool success, const QString &message);
+    // 标签导出信号
+    void exportProgress(qint64 rows, qint64 bytes);
+    void exportFinished(bool success, const QString &message);
+
+private slots:
+    // 传输层
+    void readSerialData();
+    void readTcpData();
+    void onTcpConnected();
+    void onTcpDisconnected();
+    void onTcpError(QAbstractSocket::SocketError socketError);
+    void onNewClientConnected();
+    void onClientDisconnected();
+    void readTcpServerData();
+    void readUdpData();
+    void onPeriodicFrameDue(int id, const QByteArray &data);
+    void onRtuFrame(const RxBuffer &frame, qint64 timestampNs, bool interCharGap);
+    void onTxHighWater(qint64 depth);
+
+    // 脚本引擎
+    void onTxLowWater(qint64 depth);
+    void onFileTransferFinished(bool success, const QString &message);
+    void executeScheduledScript();
+    void resumeCoroutine();
+    void handleResponseTimeout();
+    void flushScriptOutput();
+
+private:
+    enum ConnectionMode {
+        ModeNone,
+        ModeSerial,    // 串口模式
+        ModeTcp,        // TCP client模式
+        ModeTcpServer, // TCP server模式
+        ModeUdp        // UDP 模式
+    };
+
+    // 传输层
+    void processReceivedData(const RxBuffer &rawData);
+    void deliverToScript(const RxBuffer &data);
+    void countReceived(const RxBuffer &chunk);
+    void recordSent(const QByteArray &data, qint64 timestamp);
+    int historyTransport() const;
+    void scanTriggers(const RxBuffer &chunk);
+    void dissect(const RxBuffer &chunk);
+    bool writeBytes(const QByteArray &byteArray);
+    bool serialBytesPending();
+    bool applySerialLowLatency(bool enable);
+    qint64 txBacklog() const;
+    bool hasConnectedClient() const;
+
+    // 脚本引擎
+    void initLua();
+    void closeLua();
+    void createLuaCoroutine(const QString &script);
+    QString resumeMainCoroutine();
+    QString handleCoroutineResult(int result);
+    void stopCoroutine();
+    void releaseCoroutine();
+    void checkAndResumeCoroutine();
+    void postScriptOutput(const QString &text);
+    void callLuaCallback(int ref, qint64 arg);
+    void callPollChangeCallback(int id, const QVariantList &changes);
+    bool configurePolling(const QVariantMap &options);
+    void releaseLuaCallbacks();
+    void removeScriptTrigger(int id);
+    int callLuaDissector(int ref, const char *data, int size, DissectedFrame &frame);
+    QByteArray callVirtualDeviceHandler(const QByteArray &request);
+
+    bool hasNewData = false;//标志变量
+    bool isPortOpen = false;  // 串口是否打开
+    ConnectionMode currentMode = ModeNone;  // 当前连接模式
+    int udpRemotePort = 0; // 存储udp端口号
+    QString udpRemoteHost; // 存储远程IP 地址
+
+    // 接收缓冲池声明在持有句柄的成员之前，最后析构
+    BufferPool rxPool;
+    qint64 rxChunkCount = 0;     // 累计接收块数
+    qint64 rxByteCount = 0;      // 累计接收字节数
+
+    // Lua相关
+    LuaAllocator luaAllocator; // Lua 内存分配器(小块分级池)，在 lua_close 之后析构
+    lua_State *L = nullptr;    // Lua状态
+    lua_State *co = nullptr;   // 当前协程
+    int coRef;                 // 当前协程的注册表引用，initLua 中初始化
+    qint64 coroutineCount = 0; // 累计创建的协程数
+    QString luaGcMode = "incremental";
+    int nres = 0;              // 用于接收协程返回值数量
+    QString currentScript;     // 当前脚本内容
+    QTimer scriptTimer;        // 脚本定时器
+    QTimer coroutineTimer;     // 协程恢复定时器
+    QTimer responseTimer;      // 响应超时定时器
+    QTimer outputTimer;        // 脚本输出合并定时器(0ms，每轮事件循环刷新一次)
+    QStringList pendingOutput; // 待发出的脚本输出
+    RxBuffer lastReceivedData;  // 最后接收的数据(池化缓冲句柄)
+    TriggerEngine triggerEngine;        // 接收流多模式触发器
+    QVector<TriggerMatch> triggerMatches; // 本次扫描的命中(复用)
+    QHash<int, int> triggerRefs;        // 触发器ID -> Lua 回调注册表引用
+    int waitTriggerId = -1;             // waitFor 等待的触发器，-1 为等待任意数据
+    std::unique_ptr<Dissector> dissector; // 当前协议解析器，为空时不解析
+    QVector<DissectedFrame> dissectedFrames; // 本次解析出的帧(复用)
+    QHash<QString, int> luaDissectorRefs;  // 脚本注册的解析器名称 -> 解析函数引用
+    int frameCallbackRef;                  // 解析帧回调(注册表引用，initLua 中初始化)
+    int pollChangeRef;                     // 轮询值变化回调
+    bool inLuaDissector = false;           // 正在执行脚本解析函数，此时不能切换解析器
+    bool luaDissectorFailed = false;       // 脚本解析函数出错，本次输入结束后关闭解析器
+    TagStore tagStore;                     // 标签时间序列
+
+    bool isCoroutineRunning = false; // 协程是否在运行
+    bool waitingForResponse = false; // 是否在等待响应
+    bool waitingForFileTransfer = false; // 是否在等待文件发送完成
+    bool waitingForTxDrain = false;  // 是否在等待发送队列回落
+    bool serialLowLatency = false;   // 串口低延迟模式
+    bool rtuStrictGap = false;       // 丢弃字符间隔超过 t1.5 的 RTU 帧
+    bool serialIsVirtual = false;    // 当前串口为虚拟串口
+    int txHighWaterRef;              // 发送队列高水位回调(注册表引用，initLua 中初始化)
+    int txLowWaterRef;               // 发送队列低水位回调
+    int virtualDeviceRef;            // 虚拟串口设备处理函数
+    int responseTimeout = 1000;      // 默认响应超时时间(毫秒)
+    int scriptLogLevel = 1;          // Lua log 级别，0=debug 1=info 2=warn 3=error 4=off
+
+    QSerialPort serial;          // 串口对象
+    QTcpSocket tcpSocket;        // TCP Socket
+    QTcpServer tcpServer;        // TCP Server
+    QList<QTcpSocket*> clients;  // 存储连接的客户端
+    QUdpSocket udpSocket;        // UDP Socket
+    PeriodicSender periodicSender; // 定时发送引擎
+    FileTransfer fileTransfer;     // 文件发送引擎
+    QString transferError;         // 最近一次 startFileTransfer 失败的原因
+    Exporter exporter;             // 录制和导出
+    QMetaObject::Connection captureRxConnection;  // 录制期间接到收发信号上的连接
+    QMetaObject::Connection captureTxConnection;
+    SessionHistory history;        // 收发历史(磁盘文件 + 块索引)
+    PollScheduler pollScheduler{&tagStore}; // Modbus 轮询调度
+    bool pollingConfigured = false;         // startPolling 设置过总线参数
+    TxQueue txQueue;               // 发送队列
+    RtuFramer rtuFramer;           // RTU 帧间隔分帧器
+    VirtualSerial virtualSerial;   // 虚拟串口(伪终端)
+};
+
+#endif // SERIALHANDLER_H
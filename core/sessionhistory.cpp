@@ -0,0 +1,443 @@
+#include "sessionhistory.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+static const char kHistoryMagic[8] = {'M', 'J', 'H', 'I', 'S', 'T', '1', '\0'};
+
+// 记录头：i64 时间、u32 长度、u8 方向、u8 传输方式、u16 保留
+static void appendRecordHeader(QByteArray &out, qint64 time, int size, int direction, int transport) {
+    char header[16] = {};
+    qToLittleEndian<qint64>(time, header);
+    qToLittleEndian<quint32>(quint32(size), header + 8);
+    header[12] = char(direction);
+    header[13] = char(transport);
+    out.append(header, sizeof(header));
+}
+
+SessionHistory::SessionHistory() = default;
+
+SessionHistory::~SessionHistory() {
+    close();
+}
+
+int SessionHistory::gramHash(const uchar *bytes) {
+    const quint32 value = (quint32(bytes[0]) << 16) | (quint32(bytes[1]) << 8) | bytes[2];
+    return int((value * 2654435761u) >> (32 - 14));
+}
+
+void SessionHistory::addGrams(Block &block, const uchar *bytes, int size) {
+    for (int i = 0; i + 3 <= size; i++) {
+        const int bit = gramHash(bytes + i);
+        block.grams[bit >> 6] |= quint64(1) << (bit & 63);
+    }
+}
+
+// 追加到流的尾部，只保留最后 limit 字节
+void SessionHistory::appendTail(QByteArray &tail, const char *data, int size, int limit) {
+    if (size >= limit) {
+        tail.resize(limit);
+        std::memcpy(tail.data(), data + size - limit, size_t(limit));
+        return;
+    }
+    tail.append(data, size);
+    if (tail.size() > limit) {
+        tail.remove(0, tail.size() - limit);
+    }
+}
+
+bool SessionHistory::open(const QString &filePath) {
+    close();
+    lastError.clear();
+
+    if (filePath.isEmpty()) {
+        auto temp = std::make_unique<QTemporaryFile>(QDir::temp().filePath("mjcom_history_XXXXXX.mjhist"));
+        if (!temp->open()) {
+            lastError = temp->errorString();
+            return false;
+        }
+        file = std::move(temp);
+    } else {
+        file = std::make_unique<QFile>(filePath);
+        if (!file->open(QIODevice::ReadWrite)) {
+            lastError = file->errorString();
+            file.reset();
+            return false;
+        }
+    }
+
+    reader.setFileName(file->fileName());
+    if (!reader.open(QIODevice::ReadOnly)) {
+        lastError = reader.errorString();
+        file.reset();
+        return false;
+    }
+
+    current = Block();
+    current.grams.fill(0, kGramBits / 64);
+    if (file->size() > 0) {
+        if (!loadExisting()) {
+            reader.close();
+            file.reset();
+            return false;
+        }
+    } else {
+        file->write(kHistoryMagic, sizeof(kHistoryMagic));
+        file->flush();
+        fileBytes = sizeof(kHistoryMagic);
+        current.offset = fileBytes;
+    }
+    return true;
+}
+
+// 扫描已有文件重建块索引，不完整的尾部记录截掉
+bool SessionHistory::loadExisting() {
+    if (file->read(sizeof(kHistoryMagic)) != QByteArray(kHistoryMagic, sizeof(kHistoryMagic))) {
+        lastError = "不是会话历史文件: " + file->fileName();
+        return false;
+    }
+    fileBytes = sizeof(kHistoryMagic);
+    current.offset = fileBytes;
+
+    QByteArray carry;
+    for (;;) {
+        const QByteArray chunk = file->read(1 << 20);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        carry.append(chunk);
+        int position = 0;
+        while (carry.size() - position >= kHeaderSize) {
+            const char *header = carry.constData() + position;
+            const qint64 time = qFromLittleEndian<qint64>(header);
+            const int size = int(qFromLittleEndian<quint32>(header + 8));
+            if (size < 0 || carry.size() - position - kHeaderSize < size) {
+                break;
+            }
+            indexRecord(current, time, uchar(header[12]), uchar(header[13]), header + kHeaderSize, size);
+            fileBytes += kHeaderSize + size;
+            frames++;
+            position += kHeaderSize + size;
+            if (current.bytes >= kBlockBytes || current.frameCount >= kBlockFrames) {
+                sealBlock();
+            }
+        }
+        carry.remove(0, position);
+    }
+    sealBlock();
+
+    if (file->size() != fileBytes) {
+        file->resize(fileBytes);
+    }
+    file->seek(fileBytes);
+    return true;
+}
+
+void SessionHistory::close() {
+    if (!file) {
+        return;
+    }
+    sealBlock();
+    reader.close();
+    file->close();
+    file.reset();  // 临时文件随之删除
+
+    blocks.clear();
+    current = Block();
+    pending.clear();
+    readBuffer.clear();
+    tails = {};
+    fileBytes = 0;
+    frames = 0;
+    droppedFrames = 0;
+    full = false;
+}
+
+QString SessionHistory::filePath() const {
+    return file ? file->fileName() : QString();
+}
+
+void SessionHistory::clear() {
+    if (!file) {
+        return;
+    }
+    blocks.clear();
+    pending.clear();
+    tails = {};
+    current = Block();
+    current.grams.fill(0, kGramBits / 64);
+    fileBytes = sizeof(kHistoryMagic);
+    current.offset = fileBytes;
+    frames = 0;
+    droppedFrames = 0;
+    full = false;
+    file->flush();
+    file->resize(fileBytes);
+    file->seek(fileBytes);
+}
+
+void SessionHistory::indexRecord(Block &block, qint64 time, int direction, int transport, const char *data, int size) {
+    block.minTime = qMin(block.minTime, time);
+    block.maxTime = qMax(block.maxTime, time);
+    block.directions |= quint8(1 << (direction & 7));
+    block.transports |= quint8(1 << (transport & 7));
+
+    // 流在块中第一次出现时记下之前的尾部并索引，跨块的匹配也能通过位图
+    const int stream = streamOf(direction, transport);
+    QByteArray &tail = tails[stream];
+    if (!(block.streams & (1 << stream))) {
+        block.streams |= quint8(1 << stream);
+        block.carry[stream] = tail;
+        addGrams(block, reinterpret_cast<const uchar *>(tail.constData()), tail.size());
+    }
+    // 与上一条记录相接处的三元组
+    if (!tail.isEmpty() && size > 0) {
+        uchar edge[4];
+        int count = 0;
+        for (int i = qMax(0, tail.size() - 2); i < tail.size(); i++) {
+            edge[count++] = uchar(tail[i]);
+        }
+        for (int i = 0; i < size && i < 2; i++) {
+            edge[count++] = uchar(data[i]);
+        }
+        addGrams(block, edge, count);
+    }
+    addGrams(block, reinterpret_cast<const uchar *>(data), size);
+    appendTail(tail, data, size, kCarryBytes);
+
+    block.bytes += kHeaderSize + size;
+    block.frameCount++;
+}
+
+void SessionHistory::append(int direction, int transport, const char *data, int size, qint64 time) {
+    if (!file || size < 0) {
+        return;
+    }
+    if (full || fileBytes + kHeaderSize + size > maxBytes) {
+        full = true;
+        droppedFrames++;
+        return;
+    }
+
+    appendRecordHeader(pending, time, size, direction, transport);
+    pending.append(data, size);
+    indexRecord(current, time, direction, transport, data, size);
+    fileBytes += kHeaderSize + size;
+    frames++;
+
+    if (current.bytes >= kBlockBytes || current.frameCount >= kBlockFrames) {
+        sealBlock();
+    }
+}
+
+// 当前块写入文件并加入索引
+void SessionHistory::sealBlock() {
+    if (current.frameCount == 0) {
+        return;
+    }
+    if (!pending.isEmpty()) {
+        if (file->write(pending) != pending.size() || !file->flush()) {
+            lastError = file->errorString();
+            full = true;
+        }
+        pending.resize(0);  // 保留容量
+    }
+
+    Block next;
+    next.offset = current.offset + current.bytes;
+    next.firstFrame = current.firstFrame + current.frameCount;
+    next.grams.fill(0, kGramBits / 64);
+    blocks.append(std::move(current));
+    current = std::move(next);
+}
+
+const char *SessionHistory::blockData(const Block &block) {
+    if (&block == &current) {
+        return pending.constData();
+    }
+    readBuffer.resize(block.bytes);
+    if (!reader.seek(block.offset) || reader.read(readBuffer.data(), block.bytes) != block.bytes) {
+        return nullptr;
+    }
+    return readBuffer.constData();
+}
+
+QVector<SessionHistory::Hit> SessionHistory::search(const Query &query) {
+    QElapsedTimer timer;
+    timer.start();
+    lastSkippedByTime = 0;
+    lastSkippedByFilter = 0;
+    lastSkippedByIndex = 0;
+    lastScannedBlocks = 0;
+    lastScannedFrames = 0;
+
+    QVector<Hit> hits;
+    if (!file || query.limit <= 0) {
+        return hits;
+    }
+
+    // 模式的全部三元组都必须出现在块的位图中
+    QVector<int> patternGrams;
+    const uchar *pattern = reinterpret_cast<const uchar *>(query.pattern.constData());
+    for (int i = 0; i + 3 <= query.pattern.size(); i++) {
+        patternGrams.append(gramHash(pattern + i));
+    }
+    std::sort(patternGrams.begin(), patternGrams.end());
+    patternGrams.erase(std::unique(patternGrams.begin(), patternGrams.end()), patternGrams.end());
+
+    QVector<Hit> blockHits;
+    std::array<QByteArray, kStreams> streamTails;
+    const int carryLimit = qMin(kCarryBytes, query.pattern.size() - 1);
+    const int total = blocks.size() + 1;  // 最后一个为当前块
+    for (int n = 0; n < total && hits.size() < query.limit; n++) {
+        const int i = query.newestFirst ? total - 1 - n : n;
+        const Block &block = i < blocks.size() ? blocks[i] : current;
+        if (block.frameCount == 0) {
+            continue;
+        }
+        if (block.maxTime < query.from || block.minTime > query.to) {
+            lastSkippedByTime++;
+            continue;
+        }
+        if (!(block.directions & query.directions) || !(block.transports & query.transports)) {
+            lastSkippedByFilter++;
+            continue;
+        }
+        const bool possible = std::all_of(patternGrams.cbegin(), patternGrams.cend(), [&block](int bit) {
+            return (block.grams[bit >> 6] >> (bit & 63)) & 1;
+        });
+        if (!possible) {
+            lastSkippedByIndex++;
+            continue;
+        }
+
+        const char *data = blockData(block);
+        if (!data) {
+            continue;
+        }
+        lastScannedBlocks++;
+
+        for (int stream = 0; stream < kStreams; stream++) {
+            streamTails[stream] = carryLimit > 0 ? block.carry[stream].right(carryLimit) : QByteArray();
+        }
+        blockHits.clear();
+        qint64 index = block.firstFrame;
+        for (int position = 0; position + kHeaderSize <= block.bytes; index++) {
+            const char *header = data + position;
+            const qint64 time = qFromLittleEndian<qint64>(header);
+            const int size = int(qFromLittleEndian<quint32>(header + 8));
+            const int direction = uchar(header[12]);
+            const int transport = uchar(header[13]);
+            const char *payload = header + kHeaderSize;
+            position += kHeaderSize + size;
+            lastScannedFrames++;
+
+            if (!(query.directions & (1 << direction)) || !(query.transports & (1 << transport))) {
+                continue;
+            }
+            // 尾部不足模式长度，拼上本条开头后命中的必然跨越边界
+            QByteArray &tail = streamTails[streamOf(direction, transport)];
+            int carried = 0;
+            int match = -1;
+            if (!tail.isEmpty()) {
+                QByteArray edge = tail;
+                edge.append(payload, qMin(size, query.pattern.size() - 1));
+                const int position = edge.indexOf(query.pattern);
+                if (position >= 0) {
+                    carried = tail.size() - position;
+                    match = 0;
+                }
+            }
+            if (carryLimit > 0) {
+                appendTail(tail, payload, size, carryLimit);
+            }
+
+            if (time < query.from || time > query.to) {
+                continue;
+            }
+            if (!query.pattern.isEmpty() && match < 0) {
+                match = QByteArray::fromRawData(payload, size).indexOf(query.pattern);
+                if (match < 0) {
+                    continue;
+                }
+            }
+            blockHits.append(Hit{index, time, direction, transport, QByteArray(payload, size), match, carried});
+            if (!query.newestFirst && hits.size() + blockHits.size() >= query.limit) {
+                break;
+            }
+        }
+
+        if (query.newestFirst) {
+            for (int k = blockHits.size() - 1; k >= 0 && hits.size() < query.limit; k--) {
+                hits.append(std::move(blockHits[k]));
+            }
+        } else {
+            hits.append(blockHits);
+        }
+    }
+
+    lastSearchNs = timer.nsecsElapsed();
+    return hits;
+}
+
+QVariantMap SessionHistory::statistics() const {
+    QVariantMap map;
+    map["file"] = filePath();
+    map["frames"] = frames;
+    map["bytes"] = fileBytes;
+    map["blocks"] = blocks.size() + (current.frameCount > 0 ? 1 : 0);
+    map["indexBytes"] = qint64(blocks.size() + 1) * qint64(sizeof(Block) + kGramBits / 8 + kStreams * kCarryBytes);
+    map["maxBytes"] = maxBytes;
+    map["dropped"] = droppedFrames;
+    map["full"] = full;
+    map["lastScannedBlocks"] = lastScannedBlocks;
+    map["lastScannedFrames"] = lastScannedFrames;
+    map["lastSkippedByTime"] = lastSkippedByTime;
+    map["lastSkippedByFilter"] = lastSkippedByFilter;
+    map["lastSkippedByIndex"] = lastSkippedByIndex;
+    map["lastSearchMs"] = lastSearchNs / 1e6;
+    return map;
+}
+
+QString SessionHistory::directionName(int direction) {
+    return direction == Sent ? QStringLiteral("tx") : QStringLiteral("rx");
+}
+
+QString SessionHistory::transportName(int transport) {
+    switch (transport) {
+    case Tcp:
+        return QStringLiteral("tcp");
+    case TcpServer:
+        return QStringLiteral("tcpserver");
+    case Udp:
+        return QStringLiteral("udp");
+    default:
+        return QStringLiteral("serial");
+    }
+}
+
+int SessionHistory::directionFromName(const QString &name) {
+    const QString lower = name.toLower();
+    if (lower == "rx") {
+        return Received;
+    }
+    if (lower == "tx") {
+        return Sent;
+    }
+    return -1;
+}
+
+int SessionHistory::transportFromName(const QString &name) {
+    const QString lower = name.toLower();
+    for (int transport = Serial; transport <= Udp; transport++) {
+        if (transportName(transport) == lower) {
+            return transport;
+        }
+    }
+    return -1;
+}
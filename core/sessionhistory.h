@@ -0,0 +1,141 @@
+#ifndef SESSIONHISTORY_H
+#define SESSIONHISTORY_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+#include <array>
+#include <limits>
+#include <memory>
+
+// SessionHistory 会话收发历史：每条收发记录追加到磁盘文件，内存中只保留按块的索引
+// 文件格式  "MJHIST1\0"，随后为记录：i64 毫秒时间、u32 长度、u8 方向、u8 传输方式、u16 保留，再接数据
+// 记录按写入顺序分块(64KB 或 4096 条)，每块索引保存时间范围、方向/传输方式位掩码和字节三元组位图
+// 查询先用块索引跳过不可能命中的块，只读取和逐条比较剩余的块
+// 一次读取可能只收到半帧，所以同方向同传输方式的相邻记录视为连续的字节流：模式可以从前面记录的
+// 最后 32 字节开始、在当前记录结束，三元组位图也包括跨记录边界的三元组和块开始前的这段尾部
+// 位图按哈希置位，只会多读块(误判)，不会跳过含有上述匹配的块；起点更靠前的跨记录匹配查不到
+class SessionHistory {
+public:
+    enum Direction {
+        Received = 0,
+        Sent = 1
+    };
+
+    enum Transport {
+        Serial = 0,
+        Tcp = 1,
+        TcpServer = 2,
+        Udp = 3
+    };
+
+    struct Query {
+        qint64 from = 0;
+        qint64 to = std::numeric_limits<qint64>::max();
+        int directions = 0x3;     // 按 1 << Direction 组合
+        int transports = 0xF;     // 按 1 << Transport 组合
+        QByteArray pattern;       // 记录中包含的字节序列，为空时不按内容过滤
+        int limit = 1000;
+        bool newestFirst = true;
+    };
+
+    struct Hit {
+        qint64 index;             // 记录序号，从 0 开始
+        qint64 time;
+        int direction;
+        int transport;
+        QByteArray data;
+        int matchOffset;          // 模式在数据中的位置，无模式时为 -1
+        int carried;              // 跨记录匹配时模式在前面记录中的字节数，matchOffset 为 0
+    };
+
+    SessionHistory();
+    ~SessionHistory();
+
+    SessionHistory(const SessionHistory &) = delete;
+    SessionHistory &operator=(const SessionHistory &) = delete;
+
+    // 打开历史文件：已有的历史文件扫描重建索引后继续追加；空路径使用临时文件，关闭时删除
+    bool open(const QString &filePath = QString());
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    QString filePath() const;
+    QString errorString() const { return lastError; }
+    // 清空历史，文件截断
+    void clear();
+
+    // 文件大小上限，达到后不再记录，统计中 full 为 true
+    void setMaxBytes(qint64 bytes) { maxBytes = bytes; }
+
+    void append(int direction, int transport, const char *data, int size, qint64 time);
+    QVector<Hit> search(const Query &query);
+
+    qint64 frameCount() const { return frames; }
+    // 统计：记录数、文件字节数、块数、索引内存、丢弃数，以及最近一次查询跳过/扫描的块数和耗时
+    QVariantMap statistics() const;
+
+    static QString directionName(int direction);
+    static QString transportName(int transport);
+    static int directionFromName(const QString &name);   // 未知名称返回 -1
+    static int transportFromName(const QString &name);
+
+private:
+    static constexpr int kHeaderSize = 16;
+    static constexpr int kBlockBytes = 64 * 1024;
+    static constexpr int kBlockFrames = 4096;
+    static constexpr int kGramBits = 1 << 14;
+    static constexpr int kStreams = 8;          // 方向 × 传输方式
+    static constexpr int kCarryBytes = 32;      // 跨记录匹配最多回看的字节数
+
+    struct Block {
+        qint64 offset = 0;        // 第一条记录在文件中的偏移
+        int bytes = 0;            // 块内记录(含记录头)的总字节数
+        qint64 firstFrame = 0;
+        int frameCount = 0;
+        qint64 minTime = std::numeric_limits<qint64>::max();
+        qint64 maxTime = std::numeric_limits<qint64>::min();
+        quint8 directions = 0;
+        quint8 transports = 0;
+        QVector<quint64> grams;   // 三元组哈希位图，kGramBits 位
+        quint8 streams = 0;       // 块中出现的流
+        std::array<QByteArray, kStreams> carry;  // 各流在块开始前的最后 kCarryBytes 字节
+    };
+
+    static int gramHash(const uchar *bytes);
+    static void addGrams(Block &block, const uchar *bytes, int size);
+    static int streamOf(int direction, int transport) { return (direction & 1) * 4 + (transport & 3); }
+    static void appendTail(QByteArray &tail, const char *data, int size, int limit);
+    void indexRecord(Block &block, qint64 time, int direction, int transport, const char *data, int size);
+    void sealBlock();
+    bool loadExisting();
+    // 块内容：当前块从内存取，已写入的块从文件读
+    const char *blockData(const Block &block);
+
+    std::unique_ptr<QFile> file;  // 追加写
+    QFile reader;                 // 查询读取，与追加写互不影响位置
+    QString lastError;
+    qint64 maxBytes = qint64(1) << 30;
+
+    QVector<Block> blocks;        // 已写入文件的块
+    Block current;                // 正在追加的块，记录在 pending 中
+    QByteArray pending;
+    QByteArray readBuffer;
+    std::array<QByteArray, kStreams> tails;  // 各流最后 kCarryBytes 字节
+    qint64 fileBytes = 0;         // 文件字节数(含 pending)
+    qint64 frames = 0;
+    qint64 droppedFrames = 0;
+    bool full = false;
+
+    // 最近一次查询
+    int lastSkippedByTime = 0;
+    int lastSkippedByFilter = 0;
+    int lastSkippedByIndex = 0;
+    int lastScannedBlocks = 0;
+    qint64 lastScannedFrames = 0;
+    qint64 lastSearchNs = 0;
+};
+
+#endif // SESSIONHISTORY_H
@@ -0,0 +1,477 @@
+#include "tagstore.h"
+
+#include <QDateTime>
+#include <QtAlgorithms>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// 把低 bits 位作为有符号数扩展到 64 位
+static qint64 signExtend(quint64 value, int bits) {
+    return qint64(value << (64 - bits)) >> (64 - bits);
+}
+
+static quint64 doubleBits(double value) {
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bitsDouble(quint64 bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// 按时间向下取整到桶起点
+static qint64 bucketStart(qint64 time, qint64 interval) {
+    qint64 start = time - time % interval;
+    return time < 0 && start != time ? start - interval : start;
+}
+
+// === 位流 ===
+
+void TagStore::BitStream::write(quint64 value, int bits) {
+    if (bits < 64) {
+        value &= (quint64(1) << bits) - 1;
+    }
+    const int offset = int(bitCount % 64);
+    if (offset == 0) {
+        words.append(0);
+    }
+    const int free = 64 - offset;
+    if (bits <= free) {
+        words.last() |= value << (free - bits);
+    } else {
+        const int spill = bits - free;
+        words.last() |= value >> spill;
+        words.append(value << (64 - spill));
+    }
+    bitCount += bits;
+}
+
+quint64 TagStore::BitStream::read(qint64 &position, int bits) const {
+    // 解压是查询的热点：position 非负，用移位和掩码取字和位偏移，直接按指针读
+    const quint64 *word = words.constData() + (position >> 6);
+    const int offset = int(position & 63);
+    const int available = 64 - offset;
+    quint64 result;
+    if (bits <= available) {
+        result = (word[0] << offset) >> (64 - bits);
+    } else {
+        const int spill = bits - available;
+        const quint64 high = (word[0] << offset) >> offset;
+        result = (high << spill) | (word[1] >> (64 - spill));
+    }
+    position += bits;
+    return result;
+}
+
+// === 降采样 ===
+
+void TagStore::Tier::add(qint64 time, double value) {
+    const qint64 start = bucketStart(time, intervalMs);
+    if (used > 0) {
+        TagBucket &last = ring[(head + used - 1) % ring.size()];
+        if (start == last.start) {
+            last.min = qMin(last.min, value);
+            last.max = qMax(last.max, value);
+            last.sum += value;
+            last.count++;
+            return;
+        }
+    }
+
+    const TagBucket bucket = {start, value, value, value, 1};
+    if (ring.size() < capacity) {
+        ring.append(bucket);  // 增长阶段 head 始终为 0
+        used++;
+    } else {
+        ring[head] = bucket;
+        head = (head + 1) % ring.size();
+    }
+}
+
+// === TagStore ===
+
+TagStore::TagStore(QObject *parent) : QObject(parent) {
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(100);
+    connect(&updateTimer, &QTimer::timeout, this, &TagStore::updated);
+}
+
+void TagStore::record(const QString &tag, double value, qint64 time) {
+    if (time <= 0) {
+        time = QDateTime::currentMSecsSinceEpoch();
+    }
+
+    auto it = series.find(tag);
+    const bool created = it == series.end();
+    if (created) {
+        it = series.insert(tag, Series());
+        for (int level = 0; level < 2; level++) {
+            it->tiers[level].intervalMs = tierInterval[level];
+            it->tiers[level].capacity = tierCapacity[level];
+        }
+    }
+    Series &s = it.value();
+
+    // 时间只能向前，乱序的点按最新时间记录
+    if (s.pointCount > 0 && time < s.last.time) {
+        time = s.last.time;
+    }
+
+    if (s.blocks.isEmpty() || s.blocks.last().count >= kBlockPoints) {
+        if (!s.blocks.isEmpty()) {
+            // 封块后不再追加，释放预留空间
+            s.blocks.last().times.words.squeeze();
+            s.blocks.last().values.words.squeeze();
+        }
+        s.blocks.append(Block());
+    }
+    append(s.blocks.last(), time, value);
+    s.pointCount++;
+
+    // 整块丢弃最早的点
+    while (s.blocks.size() > 1 && s.pointCount - s.blocks.first().count >= rawLimit) {
+        s.pointCount -= s.blocks.first().count;
+        s.blocks.removeFirst();
+    }
+
+    // NaN/无穷值只保留在原始点中，不参与降采样的 min/max/avg
+    if (std::isfinite(value)) {
+        for (Tier &tier : s.tiers) {
+            tier.add(time, value);
+        }
+    }
+    s.last = {time, value};
+
+    if (created) {
+        emit tagsChanged();
+    }
+    scheduleUpdate();
+}
+
+// 时间戳：二阶差分按 0/7/9/12/64 位变长编码；值：与上一个值异或，复用上一个有效位窗口或写出新窗口
+void TagStore::append(Block &block, qint64 time, double value) {
+    const quint64 bits = doubleBits(value);
+    if (block.count == 0) {
+        block.times.write(quint64(time), 64);
+        block.values.write(bits, 64);
+        block.firstTime = time;
+        block.lastTime = time;
+        block.lastDelta = 0;
+        block.lastValueBits = bits;
+        block.count = 1;
+        return;
+    }
+
+    const qint64 delta = time - block.lastTime;
+    const qint64 dod = delta - block.lastDelta;
+    if (dod == 0) {
+        block.times.write(0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        block.times.write(0x2, 2);
+        block.times.write(quint64(dod), 7);
+    } else if (dod >= -256 && dod <= 255) {
+        block.times.write(0x6, 3);
+        block.times.write(quint64(dod), 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        block.times.write(0xE, 4);
+        block.times.write(quint64(dod), 12);
+    } else {
+        block.times.write(0xF, 4);
+        block.times.write(quint64(dod), 64);
+    }
+
+    const quint64 x = bits ^ block.lastValueBits;
+    if (x == 0) {
+        block.values.write(0, 1);
+    } else {
+        const int leading = qMin(int(qCountLeadingZeroBits(x)), 31);
+        const int trailing = int(qCountTrailingZeroBits(x));
+        if (block.lastLeading >= 0 && leading >= block.lastLeading && trailing >= block.lastTrailing) {
+            const int meaningful = 64 - block.lastLeading - block.lastTrailing;
+            block.values.write(0x2, 2);
+            block.values.write(x >> block.lastTrailing, meaningful);
+        } else {
+            const int meaningful = 64 - leading - trailing;
+            block.values.write(0x3, 2);
+            block.values.write(quint64(leading), 5);
+            block.values.write(quint64(meaningful - 1), 6);
+            block.values.write(x >> trailing, meaningful);
+            block.lastLeading = leading;
+            block.lastTrailing = trailing;
+        }
+    }
+
+    block.lastTime = time;
+    block.lastDelta = delta;
+    block.lastValueBits = bits;
+    block.count++;
+}
+
+template <typename Visitor>
+void TagStore::decode(const Block &block, Visitor &&visitor) const {
+    if (block.count == 0) {
+        return;
+    }
+    qint64 timePos = 0;
+    qint64 valuePos = 0;
+    qint64 time = qint64(block.times.read(timePos, 64));
+    quint64 bits = block.values.read(valuePos, 64);
+    visitor(time, bitsDouble(bits));
+
+    qint64 delta = 0;
+    int leading = 0;
+    int trailing = 0;
+    for (int i = 1; i < block.count; i++) {
+        qint64 dod;
+        if (block.times.read(timePos, 1) == 0) {
+            dod = 0;
+        } else if (block.times.read(timePos, 1) == 0) {
+            dod = signExtend(block.times.read(timePos, 7), 7);
+        } else if (block.times.read(timePos, 1) == 0) {
+            dod = signExtend(block.times.read(timePos, 9), 9);
+        } else if (block.times.read(timePos, 1) == 0) {
+            dod = signExtend(block.times.read(timePos, 12), 12);
+        } else {
+            dod = qint64(block.times.read(timePos, 64));
+        }
+        delta += dod;
+        time += delta;
+
+        if (block.values.read(valuePos, 1) != 0) {
+            if (block.values.read(valuePos, 1) != 0) {
+                leading = int(block.values.read(valuePos, 5));
+                const int meaningful = int(block.values.read(valuePos, 6)) + 1;
+                trailing = 64 - leading - meaningful;
+            }
+            const int meaningful = 64 - leading - trailing;
+            bits ^= block.values.read(valuePos, meaningful) << trailing;
+        }
+        visitor(time, bitsDouble(bits));
+    }
+}
+
+void TagStore::scheduleUpdate() {
+    if (!updateTimer.isActive()) {
+        updateTimer.start();
+    }
+}
+
+QStringList TagStore::tags() const {
+    QStringList list = series.keys();
+    list.sort();
+    return list;
+}
+
+void TagStore::remove(const QString &tag) {
+    if (series.remove(tag)) {
+        emit tagsChanged();
+    }
+}
+
+void TagStore::clear() {
+    if (series.isEmpty()) {
+        return;
+    }
+    series.clear();
+    emit tagsChanged();
+}
+
+QVariantMap TagStore::range(const QString &tag) const {
+    QVariantMap map;
+    auto it = series.constFind(tag);
+    if (it == series.constEnd() || it->pointCount == 0) {
+        return map;
+    }
+    map["first"] = it->blocks.first().firstTime;
+    map["last"] = it->last.time;
+    map["count"] = it->pointCount;
+    return map;
+}
+
+QVariantMap TagStore::latest(const QString &tag) const {
+    QVariantMap map;
+    auto it = series.constFind(tag);
+    if (it == series.constEnd() || it->pointCount == 0) {
+        return map;
+    }
+    map["time"] = it->last.time;
+    map["value"] = it->last.value;
+    return map;
+}
+
+bool TagStore::rawRange(const QString &tag, qint64 *first, qint64 *last) const {
+    auto it = series.constFind(tag);
+    if (it == series.constEnd() || it->pointCount == 0) {
+        return false;
+    }
+    *first = it->blocks.first().firstTime;
+    *last = it->last.time;
+    return true;
+}
+
+void TagStore::visit(const QString &tag, qint64 from, qint64 to,
+                     const std::function<void(qint64, double)> &visitor) const {
+    auto it = series.constFind(tag);
+    if (it == series.constEnd()) {
+        return;
+    }
+    for (const Block &block : it->blocks) {
+        if (block.firstTime > to) {
+            break;
+        }
+        if (block.count == 0 || block.lastTime < from) {
+            continue;
+        }
+        // 整块都在范围内时不逐点判断
+        if (block.firstTime >= from && block.lastTime <= to) {
+            decode(block, visitor);
+        } else {
+            decode(block, [&](qint64 time, double value) {
+                if (time >= from && time <= to) {
+                    visitor(time, value);
+                }
+            });
+        }
+    }
+}
+
+QVariantList TagStore::query(const QString &tag, qint64 from, qint64 to, int maxPoints) const {
+    QVariantList list;
+    visit(tag, from, to, [&](qint64 time, double value) {
+        if (list.size() < maxPoints) {
+            QVariantMap point;
+            point["time"] = time;
+            point["value"] = value;
+            list.append(point);
+        }
+    });
+    return list;
+}
+
+// 原始点覆盖 from 时用原始点；否则用桶宽不超过 bucketMs、能覆盖 from 的最细一级，都不能覆盖时用保留最久的一级
+// 没有桶宽不超过 bucketMs 的级别时退而使用有数据的最细一级，结果比请求的粗但不丢失较早的数据
+QVector<TagBucket> TagStore::buckets(const QString &tag, qint64 from, qint64 to, qint64 bucketMs) const {
+    QVector<TagBucket> result;
+    auto it = series.constFind(tag);
+    if (it == series.constEnd() || it->pointCount == 0 || from > to) {
+        return result;
+    }
+    bucketMs = qMax<qint64>(1, bucketMs);
+    const Series &s = it.value();
+
+    int source = -1;  // -1 为原始点
+    if (s.blocks.first().firstTime > from) {
+        for (int level = 0; level < 2; level++) {
+            const Tier &tier = s.tiers[level];
+            if (tier.used == 0) {
+                continue;
+            }
+            if (tier.intervalMs > bucketMs && source >= 0) {
+                break;
+            }
+            source = level;
+            if (tier.at(0).start <= from || tier.intervalMs > bucketMs) {
+                break;
+            }
+        }
+    }
+
+    auto merge = [&](qint64 time, double min, double max, double sum, int count) {
+        const qint64 start = bucketStart(time, bucketMs);
+        if (result.isEmpty() || result.last().start != start) {
+            result.append(TagBucket{start, min, max, sum, count});
+            return;
+        }
+        TagBucket &last = result.last();
+        last.min = qMin(last.min, min);
+        last.max = qMax(last.max, max);
+        last.sum += sum;
+        last.count += count;
+    };
+
+    if (source < 0) {
+        visit(tag, from, to, [&](qint64 time, double value) {
+            merge(time, value, value, value, 1);
+        });
+    } else {
+        const Tier &tier = s.tiers[source];
+        for (int i = 0; i < tier.used; i++) {
+            const TagBucket &bucket = tier.at(i);
+            if (bucket.start + tier.intervalMs <= from || bucket.start > to) {
+                continue;
+            }
+            merge(bucket.start, bucket.min, bucket.max, bucket.sum, bucket.count);
+        }
+    }
+    return result;
+}
+
+QVariantList TagStore::queryBuckets(const QString &tag, qint64 from, qint64 to, qint64 bucketMs) const {
+    QVariantList list;
+    const QVector<TagBucket> result = buckets(tag, from, to, bucketMs);
+    list.reserve(result.size());
+    for (const TagBucket &bucket : result) {
+        QVariantMap map;
+        map["time"] = bucket.start;
+        map["min"] = bucket.min;
+        map["max"] = bucket.max;
+        map["avg"] = bucket.sum / bucket.count;
+        map["count"] = bucket.count;
+        list.append(map);
+    }
+    return list;
+}
+
+void TagStore::setRawLimit(int points) {
+    rawLimit = qMax(kBlockPoints, points);
+    for (Series &s : series) {
+        while (s.blocks.size() > 1 && s.pointCount - s.blocks.first().count >= rawLimit) {
+            s.pointCount -= s.blocks.first().count;
+            s.blocks.removeFirst();
+        }
+    }
+}
+
+void TagStore::setTier(int level, qint64 intervalMs, int capacity) {
+    if (level < 0 || level > 1 || intervalMs <= 0 || capacity <= 0) {
+        return;
+    }
+    tierInterval[level] = intervalMs;
+    tierCapacity[level] = capacity;
+    for (Series &s : series) {
+        Tier &tier = s.tiers[level];
+        tier.clear();
+        tier.intervalMs = intervalMs;
+        tier.capacity = capacity;
+    }
+}
+
+QVariantMap TagStore::getStats() const {
+    qint64 points = 0;
+    qint64 bytes = 0;
+    qint64 bucketCount = 0;
+    for (const Series &s : series) {
+        points += s.pointCount;
+        for (const Block &block : s.blocks) {
+            bytes += block.times.bytes() + block.values.bytes();
+        }
+        for (const Tier &tier : s.tiers) {
+            bucketCount += tier.used;
+        }
+    }
+
+    QVariantMap map;
+    map["tags"] = series.size();
+    map["points"] = points;
+    map["compressedBytes"] = bytes;
+    map["bytesPerPoint"] = points > 0 ? double(bytes) / points : 0.0;
+    map["buckets"] = bucketCount;
+    map["bucketBytes"] = bucketCount * qint64(sizeof(TagBucket));
+    map["rawLimit"] = rawLimit;
+    return map;
+}
@@ -0,0 +1,133 @@
+#ifndef TAGSTORE_H
+#define TAGSTORE_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+#include <functional>
+
+// 一个采样点：毫秒时间戳和值
+struct TagPoint {
+    qint64 time;
+    double value;
+};
+
+// 降采样桶：桶起始时间和桶内的最小/最大/总和/点数
+struct TagBucket {
+    qint64 start;
+    double min;
+    double max;
+    double sum;
+    int count;
+};
+
+// TagStore 按标签(如 "1/3/100" 表示 从站/功能码/地址)保存轮询值的时间序列
+// 原始点按块压缩：时间戳和值分两列存储，时间戳用二阶差分、值用异或(Gorilla)编码，每个标签保留最近 rawLimit 个点
+// 另有两级降采样(默认 1 分钟保留 1 天、1 小时保留 30 天)记录 min/max/avg，按需增长的环形缓冲，内存有上界
+class TagStore : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(int tagCount READ tagCount NOTIFY tagsChanged)
+
+public:
+    explicit TagStore(QObject *parent = nullptr);
+
+    // 追加一个点，time 为 0 时取当前时间；早于该标签最新点的时间按最新点处理
+    void record(const QString &tag, double value, qint64 time = 0);
+
+    int tagCount() const { return series.size(); }
+    Q_INVOKABLE QStringList tags() const;
+    Q_INVOKABLE bool contains(const QString &tag) const { return series.contains(tag); }
+    Q_INVOKABLE void remove(const QString &tag);
+    Q_INVOKABLE void clear();
+
+    // 原始点的时间范围 {first=, last=, count=}，没有数据时为空
+    Q_INVOKABLE QVariantMap range(const QString &tag) const;
+    // 最新值 {time=, value=}
+    Q_INVOKABLE QVariantMap latest(const QString &tag) const;
+    // 原始点 [{time=, value=}, ...]，超过 maxPoints 时只返回最早的 maxPoints 个
+    Q_INVOKABLE QVariantList query(const QString &tag, qint64 from, qint64 to, int maxPoints = 10000) const;
+    // 按 bucketMs 聚合 [{time=, min=, max=, avg=, count=}, ...]，自动选择能覆盖时间范围的最细一级数据
+    Q_INVOKABLE QVariantList queryBuckets(const QString &tag, qint64 from, qint64 to, qint64 bucketMs) const;
+
+    // 每个标签保留的原始点数，超过后丢弃最早的压缩块
+    Q_INVOKABLE void setRawLimit(int points);
+    // 降采样级别：level 为 0 或 1，intervalMs 为桶宽，capacity 为保留的桶数；修改后清除该级数据
+    Q_INVOKABLE void setTier(int level, qint64 intervalMs, int capacity);
+
+    // 统计：标签数、点数、压缩字节数、每点平均字节数、降采样桶数
+    Q_INVOKABLE QVariantMap getStats() const;
+
+    // C++ 侧按时间顺序遍历原始点，不构造 QVariant
+    // rawRange 给出原始点的首尾时间，没有数据时返回 false
+    bool rawRange(const QString &tag, qint64 *first, qint64 *last) const;
+    void visit(const QString &tag, qint64 from, qint64 to, const std::function<void(qint64, double)> &visitor) const;
+    QVector<TagBucket> buckets(const QString &tag, qint64 from, qint64 to, qint64 bucketMs) const;
+
+signals:
+    void tagsChanged();
+    // 有新数据，最多每 100ms 发出一次
+    void updated();
+
+private:
+    // 按位追加/读取的位流
+    struct BitStream {
+        QVector<quint64> words;
+        qint64 bitCount = 0;
+
+        void write(quint64 value, int bits);
+        quint64 read(qint64 &position, int bits) const;
+        qint64 bytes() const { return words.size() * qint64(sizeof(quint64)); }
+    };
+
+    // 一个压缩块：时间戳列和值列，以及继续追加所需的编码状态
+    struct Block {
+        BitStream times;
+        BitStream values;
+        qint64 firstTime = 0;
+        qint64 lastTime = 0;
+        int count = 0;
+        qint64 lastDelta = 0;
+        quint64 lastValueBits = 0;
+        int lastLeading = -1;     // 上一个异或值的前导零和尾随零，-1 表示还没有窗口
+        int lastTrailing = 0;
+    };
+
+    struct Tier {
+        qint64 intervalMs = 0;
+        int capacity = 0;
+        QVector<TagBucket> ring;  // 按需增长到 capacity，之后循环覆盖
+        int head = 0;             // 最早的桶
+        int used = 0;
+
+        void add(qint64 time, double value);
+        const TagBucket &at(int i) const { return ring[(head + i) % ring.size()]; }
+        void clear() { ring.clear(); head = 0; used = 0; }
+    };
+
+    struct Series {
+        QList<Block> blocks;      // 最后一块为正在追加的块
+        qint64 pointCount = 0;    // blocks 中的点数
+        TagPoint last = {0, 0.0};
+        Tier tiers[2];
+    };
+
+    static constexpr int kBlockPoints = 512;
+
+    void append(Block &block, qint64 time, double value);
+    // 模板避免每个点再经过一层 std::function，只在 tagstore.cpp 中实例化
+    template <typename Visitor>
+    void decode(const Block &block, Visitor &&visitor) const;
+    void scheduleUpdate();
+
+    QHash<QString, Series> series;
+    int rawLimit = 16384;
+    qint64 tierInterval[2] = {60 * 1000, 60 * 60 * 1000};
+    int tierCapacity[2] = {24 * 60, 30 * 24};
+    QTimer updateTimer;
+};
+
+#endif // TAGSTORE_H
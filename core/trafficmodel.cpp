@@ -0,0 +1,232 @@
+#include "trafficmodel.h"
+#include "codec.h"
+
+#include <QDateTime>
+
+TrafficModel::TrafficModel(QObject *parent) : QAbstractListModel(parent) {
+    // 默认约一帧(60Hz)刷新一次
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(16);
+    connect(&flushTimer, &QTimer::timeout, this, &TrafficModel::flush);
+}
+
+int TrafficModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant TrafficModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= rows.size()) {
+        return QVariant();
+    }
+
+    const Row &row = rows.at(index.row());
+    switch (role) {
+    case DirectionRole:
+        return row.direction;
+    case TimeRole:
+        if (row.time.isEmpty()) {
+            row.time = QDateTime::fromMSecsSinceEpoch(row.timestamp).toString("yyyy-MM-dd hh:mm:ss.zzz");
+        }
+        return row.time;
+    case Qt::DisplayRole:
+    case TextRole:
+        return formatted(row);
+    case SizeRole:
+        return row.data.size();
+    case FieldsRole:
+        return row.fields;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> TrafficModel::roleNames() const {
+    return {
+        {DirectionRole, "direction"},
+        {TimeRole, "time"},
+        {TextRole, "text"},
+        {SizeRole, "size"},
+        {FieldsRole, "fields"}
+    };
+}
+
+// 只在视图请求时格式化，结果按行和模式缓存
+const QString &TrafficModel::formatted(const Row &row) const {
+    QString &text = row.text[mode];
+    if (!text.isNull()) {
+        cacheHits++;
+        return text;
+    }
+
+    formatCount++;
+    switch (mode) {
+    case Hex:
+        text = Codec::toHexString(row.data);
+        break;
+    case Ascii:
+        text = QString::fromUtf8(row.data);
+        break;
+    case Mixed:
+        text = Codec::toMixedString(row.data);
+        break;
+    }
+    if (text.isNull()) {
+        text = QLatin1String("");
+    }
+    return text;
+}
+
+void TrafficModel::setDisplayMode(int displayMode) {
+    if (displayMode < Hex || displayMode > Mixed || displayMode == mode) {
+        return;
+    }
+    mode = DisplayMode(displayMode);
+    // 只通知文本变化，视图只会重新取可见行
+    if (!rows.isEmpty()) {
+        emit dataChanged(index(0), index(rows.size() - 1), {TextRole, Qt::DisplayRole});
+    }
+    emit displayModeChanged();
+}
+
+void TrafficModel::setMaxRows(int maxRowCount) {
+    maxRowCount = qMax(1, maxRowCount);
+    if (maxRowCount == rowLimit) {
+        return;
+    }
+    rowLimit = maxRowCount;
+    if (pending.size() > rowLimit) {
+        droppedCount += pending.size() - rowLimit;
+        pending.remove(0, pending.size() - rowLimit);
+    }
+    if (trim()) {
+        emit countChanged();
+    }
+    emit maxRowsChanged();
+}
+
+void TrafficModel::setUpdateInterval(int ms) {
+    ms = qMax(0, ms);
+    if (ms == flushTimer.interval()) {
+        return;
+    }
+    flushTimer.setInterval(ms);
+    if (ms == 0) {
+        flush();
+    }
+    emit updateIntervalChanged();
+}
+
+void TrafficModel::setMergeAdjacent(bool enable) {
+    if (enable == merging) {
+        return;
+    }
+    merging = enable;
+    emit mergeAdjacentChanged();
+}
+
+void TrafficModel::clear() {
+    pending.clear();
+    flushTimer.stop();
+    if (rows.isEmpty()) {
+        return;
+    }
+    beginResetModel();
+    rows.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+QVariantMap TrafficModel::getStats() const {
+    QVariantMap map;
+    map["rows"] = rows.size();
+    map["formatted"] = formatCount;
+    map["cacheHits"] = cacheHits;
+    map["pending"] = pending.size();
+    map["events"] = eventCount;
+    map["batches"] = batchCount;
+    map["merged"] = mergedCount;
+    map["dropped"] = droppedCount;
+    return map;
+}
+
+void TrafficModel::appendReceived(const QByteArray &data, qint64 timestamp) {
+    append(Received, data, timestamp);
+}
+
+void TrafficModel::appendSent(const QByteArray &data, qint64 timestamp) {
+    append(Sent, data, timestamp);
+}
+
+void TrafficModel::appendDecoded(const QVariantMap &frame, qint64 timestamp) {
+    eventCount++;
+    const QString summary = frame.value("summary").toString();
+    enqueue(Row{frame.value("raw").toByteArray(), timestamp, Decoded, QString(),
+                {summary, summary, summary}, frame.value("fields").toMap()});
+}
+
+void TrafficModel::append(Direction direction, const QByteArray &data, qint64 timestamp) {
+    if (data.isEmpty()) {
+        return;
+    }
+    eventCount++;
+
+    // 同一周期内相邻的同方向数据接到上一行末尾，时间戳取首个事件
+    if (merging && !pending.isEmpty() && pending.last().direction == direction) {
+        pending.last().data.append(data);
+        mergedCount++;
+        return;
+    }
+    enqueue(Row{data, timestamp, direction, QString(), {}, QVariantMap()});
+}
+
+void TrafficModel::enqueue(Row &&row) {
+    pending.append(std::move(row));
+    // 一个周期内超过最大行数的部分插入后也会被裁掉，直接丢弃最早的
+    if (pending.size() > rowLimit) {
+        pending.removeFirst();
+        droppedCount++;
+    }
+
+    if (flushTimer.interval() == 0) {
+        flush();
+    } else if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+// 把待插入记录一次性插入模型：先裁掉旧行，再做一次 beginInsertRows
+void TrafficModel::flush() {
+    flushTimer.stop();
+    if (pending.isEmpty()) {
+        return;
+    }
+    batchCount++;
+
+    int excess = rows.size() + pending.size() - rowLimit;
+    if (excess > 0) {
+        excess = qMin(excess, int(rows.size()));
+        if (excess > 0) {
+            beginRemoveRows(QModelIndex(), 0, excess - 1);
+            rows.remove(0, excess);
+            endRemoveRows();
+        }
+    }
+
+    int first = rows.size();
+    beginInsertRows(QModelIndex(), first, first + pending.size() - 1);
+    rows.append(std::move(pending));
+    pending.clear();
+    endInsertRows();
+    emit countChanged();
+}
+
+// 超过最大行数时丢弃最早的记录
+bool TrafficModel::trim() {
+    int excess = rows.size() - rowLimit;
+    if (excess <= 0) {
+        return false;
+    }
+    beginRemoveRows(QModelIndex(), 0, excess - 1);
+    rows.remove(0, excess);
+    endRemoveRows();
+    return true;
+}
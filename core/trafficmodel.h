@@ -0,0 +1,110 @@
+#ifndef TRAFFICMODEL_H
+#define TRAFFICMODEL_H
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QList>
+#include <QTimer>
+#include <QVariantMap>
+
+// TrafficModel 收发记录列表模型：只保存原始字节和时间戳
+// 显示文本在视图取数据时才格式化并按行缓存，切换显示模式不重新处理历史记录
+// 收发事件先进入待插入队列，每个刷新周期合并为一次插入，界面开销与数据速率无关
+class TrafficModel : public QAbstractListModel {
+    Q_OBJECT
+    Q_PROPERTY(int displayMode READ displayMode WRITE setDisplayMode NOTIFY displayModeChanged)
+    Q_PROPERTY(int maxRows READ maxRows WRITE setMaxRows NOTIFY maxRowsChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval NOTIFY updateIntervalChanged)
+    Q_PROPERTY(bool mergeAdjacent READ mergeAdjacent WRITE setMergeAdjacent NOTIFY mergeAdjacentChanged)
+
+public:
+    enum DisplayMode {
+        Hex,    // 十六进制
+        Ascii,  // 按 UTF-8 解码
+        Mixed   // 可打印字符原样，其余转义
+    };
+    Q_ENUM(DisplayMode)
+
+    enum Direction {
+        Received,
+        Sent,
+        Decoded   // 协议解析器输出的帧，文本为解析摘要
+    };
+    Q_ENUM(Direction)
+
+    enum Roles {
+        DirectionRole = Qt::UserRole + 1,
+        TimeRole,   // 时间文本 "yyyy-MM-dd hh:mm:ss.zzz"
+        TextRole,   // 按当前显示模式格式化的数据
+        SizeRole,
+        FieldsRole  // 解析帧的结构化字段，其他行为空
+    };
+
+    explicit TrafficModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int displayMode() const { return mode; }
+    void setDisplayMode(int displayMode);
+    int maxRows() const { return rowLimit; }
+    void setMaxRows(int rows);
+    int count() const { return rows.size(); }
+    // 刷新周期(毫秒)，0 为每个事件立即插入
+    int updateInterval() const { return flushTimer.interval(); }
+    void setUpdateInterval(int ms);
+    // 同一周期内相邻的同方向数据合并为一行
+    bool mergeAdjacent() const { return merging; }
+    void setMergeAdjacent(bool enable);
+
+    Q_INVOKABLE void clear();
+    // 统计：行数、格式化次数、缓存命中次数，以及事件数、插入批次、合并和丢弃的事件数
+    Q_INVOKABLE QVariantMap getStats() const;
+
+public slots:
+    void appendReceived(const QByteArray &data, qint64 timestamp);
+    void appendSent(const QByteArray &data, qint64 timestamp);
+    // 解析帧 {raw=, summary=, fields=, ...}，摘要直接作为各显示模式的文本
+    void appendDecoded(const QVariantMap &frame, qint64 timestamp);
+    // 立即插入待插入队列中的记录
+    void flush();
+
+signals:
+    void displayModeChanged();
+    void maxRowsChanged();
+    void countChanged();
+    void updateIntervalChanged();
+    void mergeAdjacentChanged();
+
+private:
+    struct Row {
+        QByteArray data;
+        qint64 timestamp;         // 毫秒时间戳
+        Direction direction;
+        mutable QString time;     // 以下为延迟格式化的缓存
+        mutable QString text[3];  // 按 DisplayMode 索引
+        QVariantMap fields;       // 解析帧的字段
+    };
+
+    void append(Direction direction, const QByteArray &data, qint64 timestamp);
+    void enqueue(Row &&row);
+    bool trim();
+    const QString &formatted(const Row &row) const;
+
+    QList<Row> rows;
+    QList<Row> pending;       // 等待下一次刷新插入的记录
+    QTimer flushTimer;
+    DisplayMode mode = Hex;
+    int rowLimit = 1000;
+    bool merging = false;
+    mutable qint64 formatCount = 0;
+    mutable qint64 cacheHits = 0;
+    qint64 eventCount = 0;    // 收到的收发事件数
+    qint64 batchCount = 0;    // 实际插入模型的次数
+    qint64 mergedCount = 0;   // 合并到相邻行的事件数
+    qint64 droppedCount = 0;  // 超过最大行数、未显示就丢弃的行数
+};
+
+#endif // TRAFFICMODEL_H
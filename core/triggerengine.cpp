@@ -0,0 +1,396 @@
+#include "triggerengine.h"
+
+#include <cstring>
+
+static int hexNibble(QChar c) {
+    ushort u = c.unicode();
+    if (u >= '0' && u <= '9') {
+        return u - '0';
+    } else if (u >= 'a' && u <= 'f') {
+        return u - 'a' + 10;
+    } else if (u >= 'A' && u <= 'F') {
+        return u - 'A' + 10;
+    }
+    return -1;
+}
+
+// 解析 "01 03 ?? 0?" 形式的模式：每个字节两位十六进制，'?' 为半字节通配，空白忽略
+bool TriggerEngine::parsePattern(const QString &pattern, QByteArray &bytes, QByteArray &mask) {
+    QString digits;
+    for (QChar c : pattern) {
+        if (!c.isSpace()) {
+            digits.append(c);
+        }
+    }
+    if (digits.isEmpty() || digits.size() % 2 != 0) {
+        return false;
+    }
+
+    bytes.resize(digits.size() / 2);
+    mask.resize(digits.size() / 2);
+    for (int i = 0; i < bytes.size(); i++) {
+        int value = 0;
+        int bits = 0;
+        for (int k = 0; k < 2; k++) {
+            QChar c = digits[i * 2 + k];
+            value <<= 4;
+            bits <<= 4;
+            if (c != QLatin1Char('?')) {
+                int nibble = hexNibble(c);
+                if (nibble < 0) {
+                    return false;
+                }
+                value |= nibble;
+                bits |= 0x0F;
+            }
+        }
+        bytes[i] = char(value);
+        mask[i] = char(bits);
+    }
+    return true;
+}
+
+int TriggerEngine::addPattern(const QString &pattern, bool once) {
+    Trigger trigger;
+    trigger.once = once;
+    trigger.isRegex = false;
+    if (!parsePattern(pattern, trigger.bytes, trigger.mask)) {
+        lastError = QString("模式格式错误: %1").arg(pattern);
+        return -1;
+    }
+
+    // 最长的全固定字节段作为自动机锚点
+    int runStart = 0;
+    for (int i = 0; i <= trigger.mask.size(); i++) {
+        if (i == trigger.mask.size() || quint8(trigger.mask[i]) != 0xFF) {
+            if (i - runStart > trigger.anchorLength) {
+                trigger.anchorStart = runStart;
+                trigger.anchorLength = i - runStart;
+            }
+            runStart = i + 1;
+        }
+    }
+    if (trigger.anchorLength == 0) {
+        lastError = QString("模式至少需要一个固定字节: %1").arg(pattern);
+        return -1;
+    }
+
+    trigger.id = nextId++;
+    triggers.append(trigger);
+    dirty = true;
+    return trigger.id;
+}
+
+int TriggerEngine::addRegex(const QString &regex, bool once) {
+    Trigger trigger;
+    trigger.once = once;
+    trigger.isRegex = true;
+    trigger.regex.setPattern(regex);
+    if (!trigger.regex.isValid()) {
+        lastError = QString("正则表达式错误: %1").arg(trigger.regex.errorString());
+        return -1;
+    }
+    trigger.regex.optimize();
+    trigger.lastRegexEnd = streamPos;  // 只匹配之后收到的数据
+
+    trigger.id = nextId++;
+    triggers.append(trigger);
+    dirty = true;
+    return trigger.id;
+}
+
+bool TriggerEngine::remove(int id) {
+    for (int i = 0; i < triggers.size(); i++) {
+        if (triggers[i].id == id) {
+            triggers.remove(i);
+            dirty = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TriggerEngine::contains(int id) const {
+    for (const Trigger &trigger : triggers) {
+        if (trigger.id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TriggerEngine::clear() {
+    triggers.clear();
+    dirty = true;
+}
+
+// 按锚点重建 Aho-Corasick 自动机，失败转移折叠进转移表，扫描时每字节一次查表
+void TriggerEngine::rebuild() {
+    dirty = false;
+    transitions.clear();
+    outputs.clear();
+    pending.clear();
+    state = 0;
+    maxPatternLength = 0;
+    hasRegex = false;
+
+    std::array<int, 256> empty;
+    empty.fill(-1);
+    transitions.append(empty);
+    outputs.append(QVector<int>());
+
+    for (int index = 0; index < triggers.size(); index++) {
+        const Trigger &trigger = triggers[index];
+        if (trigger.isRegex) {
+            hasRegex = true;
+            continue;
+        }
+        maxPatternLength = qMax(maxPatternLength, int(trigger.bytes.size()));
+
+        int s = 0;
+        for (int i = 0; i < trigger.anchorLength; i++) {
+            quint8 byte = quint8(trigger.bytes[trigger.anchorStart + i]);
+            if (transitions[s][byte] < 0) {
+                transitions[s][byte] = transitions.size();
+                transitions.append(empty);
+                outputs.append(QVector<int>());
+            }
+            s = transitions[s][byte];
+        }
+        outputs[s].append(index);
+    }
+
+    // 广度优先计算失败转移
+    QVector<int> fail(transitions.size(), 0);
+    QVector<int> queue;
+    queue.reserve(transitions.size());
+    for (int byte = 0; byte < 256; byte++) {
+        int child = transitions[0][byte];
+        if (child < 0) {
+            transitions[0][byte] = 0;
+        } else {
+            fail[child] = 0;
+            queue.append(child);
+        }
+    }
+    for (int head = 0; head < queue.size(); head++) {
+        int u = queue[head];
+        for (int byte = 0; byte < 256; byte++) {
+            int v = transitions[u][byte];
+            if (v < 0) {
+                transitions[u][byte] = transitions[fail[u]][byte];
+            } else {
+                fail[v] = transitions[fail[u]][byte];
+                outputs[v] += outputs[fail[v]];
+                queue.append(v);
+            }
+        }
+    }
+
+    // 根状态下能进入自动机的首字节，用于预过滤
+    startByteCount = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        startByte[byte] = transitions[0][byte] != 0;
+        if (startByte[byte]) {
+            startByteCount++;
+            singleStartByte = quint8(byte);
+        }
+    }
+
+    // 用保留的尾部字节重放，恢复跨块的自动机状态和尚未到齐的候选，已过去的匹配不再报告
+    qint64 replayFrom = qMax(historyStart, streamPos - maxPatternLength);
+    for (qint64 offset = replayFrom; offset < streamPos; offset++) {
+        state = transitions[state][quint8(historyAt(offset))];
+        for (int index : std::as_const(outputs[state])) {
+            const Trigger &trigger = triggers[index];
+            qint64 start = offset + 1 - trigger.anchorLength - trigger.anchorStart;
+            if (start >= 0 && start + trigger.bytes.size() > streamPos) {
+                pending.append(Candidate{index, start});
+            }
+        }
+    }
+}
+
+bool TriggerEngine::verify(const Trigger &trigger, qint64 start) const {
+    if (start < historyStart) {
+        return false;
+    }
+    for (int k = 0; k < trigger.bytes.size(); k++) {
+        if ((historyAt(start + k) ^ trigger.bytes[k]) & trigger.mask[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TriggerEngine::appendHistory(const char *data, int size) {
+    history.append(data, size);
+}
+
+void TriggerEngine::emitMatch(int index, qint64 start, int length, QVector<TriggerMatch> &matches) {
+    Trigger &trigger = triggers[index];
+    if (trigger.done) {
+        return;
+    }
+    matches.append(TriggerMatch{trigger.id, start, history.mid(int(start - historyStart), length)});
+    matchCount++;
+    if (trigger.once) {
+        trigger.done = true;
+    }
+}
+
+void TriggerEngine::feed(const char *data, int size, QVector<TriggerMatch> &matches) {
+    if (dirty) {
+        rebuild();
+    }
+    if (size <= 0) {
+        return;
+    }
+    if (triggers.isEmpty()) {
+        streamPos += size;
+        history.clear();
+        historyStart = streamPos;
+        return;
+    }
+
+    const qint64 base = streamPos;
+    appendHistory(data, size);
+    streamPos += size;
+    scannedBytes += size;
+
+    // 上次跨块的候选，字节到齐后校验
+    for (int i = 0; i < pending.size();) {
+        const Candidate &candidate = pending[i];
+        const Trigger &trigger = triggers[candidate.trigger];
+        if (candidate.start + trigger.bytes.size() <= streamPos) {
+            if (verify(trigger, candidate.start)) {
+                emitMatch(candidate.trigger, candidate.start, trigger.bytes.size(), matches);
+            }
+            pending.remove(i);
+        } else {
+            i++;
+        }
+    }
+
+    // 一次扫描所有锚点
+    if (transitions.size() > 1) {
+        const uchar *bytes = reinterpret_cast<const uchar *>(data);
+        int s = state;
+        int i = 0;
+        while (i < size) {
+            if (s == 0) {
+                // 根状态：跳到下一个可能开始匹配的字节
+                if (startByteCount == 1) {
+                    const void *hit = memchr(bytes + i, singleStartByte, size_t(size - i));
+                    int next = hit ? int(static_cast<const uchar *>(hit) - bytes) : size;
+                    skippedBytes += next - i;
+                    i = next;
+                } else if (startByteCount < 256) {
+                    int next = i;
+                    while (next < size && !startByte[bytes[next]]) {
+                        next++;
+                    }
+                    skippedBytes += next - i;
+                    i = next;
+                }
+                if (i >= size) {
+                    break;
+                }
+            }
+
+            s = transitions[s][bytes[i]];
+            const QVector<int> &hits = outputs[s];
+            for (int index : hits) {
+                const Trigger &trigger = triggers[index];
+                qint64 start = base + i + 1 - trigger.anchorLength - trigger.anchorStart;
+                candidateCount++;
+                if (start < 0) {
+                    continue;
+                }
+                if (start + trigger.bytes.size() <= streamPos) {
+                    if (verify(trigger, start)) {
+                        emitMatch(index, start, trigger.bytes.size(), matches);
+                    }
+                } else {
+                    pending.append(Candidate{index, start});
+                }
+            }
+            i++;
+        }
+        state = s;
+    }
+
+    if (hasRegex) {
+        scanRegex(matches);
+    }
+
+    // 只保留校验和正则需要的尾部字节
+    qint64 keepFrom = streamPos - qMax(maxPatternLength, hasRegex ? regexWindow : 0);
+    for (const Candidate &candidate : std::as_const(pending)) {
+        keepFrom = qMin(keepFrom, candidate.start);
+    }
+    if (keepFrom > historyStart) {
+        history.remove(0, int(keepFrom - historyStart));
+        historyStart = keepFrom;
+    }
+
+    removeFired();
+}
+
+// 在回看窗口加上本次新数据上匹配正则，已报告过的区间不再报告
+void TriggerEngine::scanRegex(QVector<TriggerMatch> &matches) {
+    // history 在上次扫描后只保留了 regexWindow 字节，因此窗口即为整个 history
+    const qint64 windowStart = historyStart;
+    const QString text = QString::fromLatin1(history.constData() + (windowStart - historyStart),
+                                             int(streamPos - windowStart));
+
+    for (int index = 0; index < triggers.size(); index++) {
+        Trigger &trigger = triggers[index];
+        if (!trigger.isRegex || trigger.done) {
+            continue;
+        }
+        QRegularExpressionMatchIterator it = trigger.regex.globalMatch(text);
+        while (it.hasNext()) {
+            QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0) {
+                continue;
+            }
+            qint64 start = windowStart + match.capturedStart();
+            qint64 end = windowStart + match.capturedEnd();
+            if (start < trigger.lastRegexEnd) {
+                continue;
+            }
+            trigger.lastRegexEnd = end;
+            emitMatch(index, start, int(end - start), matches);
+            if (trigger.done) {
+                break;
+            }
+        }
+    }
+}
+
+void TriggerEngine::removeFired() {
+    bool removed = false;
+    for (int i = triggers.size() - 1; i >= 0; i--) {
+        if (triggers[i].done) {
+            triggers.remove(i);
+            removed = true;
+        }
+    }
+    if (removed) {
+        dirty = true;
+    }
+}
+
+QVariantMap TriggerEngine::statistics() const {
+    QVariantMap map;
+    map["triggers"] = triggers.size();
+    map["states"] = transitions.size();
+    map["startBytes"] = startByteCount;
+    map["scannedBytes"] = scannedBytes;
+    map["skippedBytes"] = skippedBytes;
+    map["candidates"] = candidateCount;
+    map["matches"] = matchCount;
+    map["pending"] = pending.size();
+    return map;
+}
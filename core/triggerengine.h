@@ -0,0 +1,101 @@
+#ifndef TRIGGERENGINE_H
+#define TRIGGERENGINE_H
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+#include <array>
+
+// 一次触发：触发器ID、匹配在接收流中的起始偏移和匹配到的字节
+struct TriggerMatch {
+    int id;
+    qint64 offset;
+    QByteArray bytes;
+};
+
+// TriggerEngine 接收流多模式匹配
+// 字节模式支持半字节通配("01 03 ?? 0?")，取每个模式最长的固定字节段建 Aho-Corasick 自动机，
+// 一次扫描找出全部候选，再按掩码校验完整模式；跨块的匹配通过保留的尾部字节和待校验列表处理。
+// 自动机在根状态时用 memchr/首字节表跳过不可能开始匹配的字节。正则模式在最近 regexWindow 字节上匹配。
+class TriggerEngine {
+public:
+    TriggerEngine() = default;
+
+    // 添加字节模式，返回触发器ID，模式非法或没有固定字节时返回 -1 并设置 errorString
+    int addPattern(const QString &pattern, bool once = false);
+    // 添加正则模式(按 Latin-1 匹配字节)，返回触发器ID，失败返回 -1
+    int addRegex(const QString &regex, bool once = false);
+    bool remove(int id);
+    bool contains(int id) const;
+    void clear();
+    bool isEmpty() const { return triggers.isEmpty(); }
+    QString errorString() const { return lastError; }
+
+    // 扫描新收到的数据，匹配结果追加到 matches；once 触发器命中后自动移除
+    void feed(const char *data, int size, QVector<TriggerMatch> &matches);
+
+    // 正则匹配的回看窗口(字节)
+    void setRegexWindow(int bytes) { regexWindow = qMax(16, bytes); }
+
+    QVariantMap statistics() const;
+
+private:
+    struct Trigger {
+        int id;
+        bool once;
+        bool isRegex;
+        bool done = false;         // once 触发器已命中，扫描结束后移除
+        QByteArray bytes;          // 字节模式：模式值
+        QByteArray mask;           // 字节模式：掩码，0xFF 为固定字节，0x00 为通配
+        int anchorStart = 0;       // 固定字节段在模式中的位置
+        int anchorLength = 0;
+        QRegularExpression regex;
+        qint64 lastRegexEnd = -1;  // 已报告的正则匹配结束位置，避免窗口重叠时重复报告
+    };
+
+    struct Candidate {
+        int trigger;               // triggers 下标
+        qint64 start;              // 模式在流中的起始偏移
+    };
+
+    static bool parsePattern(const QString &pattern, QByteArray &bytes, QByteArray &mask);
+    void rebuild();
+    bool verify(const Trigger &trigger, qint64 start) const;
+    char historyAt(qint64 offset) const { return history[int(offset - historyStart)]; }
+    void appendHistory(const char *data, int size);
+    void scanRegex(QVector<TriggerMatch> &matches);
+    void emitMatch(int index, qint64 start, int length, QVector<TriggerMatch> &matches);
+    void removeFired();
+
+    QVector<Trigger> triggers;
+    int nextId = 1;
+    QString lastError;
+
+    // Aho-Corasick 自动机(稠密转移表)，outputs[state] 为在该状态结束的锚点所属触发器下标
+    bool dirty = false;
+    QVector<std::array<int, 256>> transitions;
+    QVector<QVector<int>> outputs;
+    std::array<bool, 256> startByte = {};
+    int startByteCount = 0;
+    unsigned char singleStartByte = 0;
+    int state = 0;
+    int maxPatternLength = 0;
+    bool hasRegex = false;
+
+    // 流状态
+    qint64 streamPos = 0;          // 已扫描的总字节数
+    QByteArray history;            // 最近的字节，用于校验锚点前后的通配部分和正则匹配
+    qint64 historyStart = 0;       // history[0] 在流中的偏移
+    QVector<Candidate> pending;    // 锚点已命中、等待后续字节的候选
+    int regexWindow = 1024;
+
+    qint64 scannedBytes = 0;
+    qint64 skippedBytes = 0;       // 被首字节预过滤跳过的字节
+    qint64 candidateCount = 0;
+    qint64 matchCount = 0;
+};
+
+#endif // TRIGGERENGINE_H
@@ -0,0 +1,127 @@
+#include "txqueue.h"
+
+TxQueue::TxQueue(QObject *parent) : QObject(parent) {
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(0);
+    connect(&flushTimer, &QTimer::timeout, this, &TxQueue::flush);
+}
+
+void TxQueue::setLimits(qint64 capacity, qint64 highWater, qint64 lowWater) {
+    maxBytes = qMax<qint64>(1, capacity);
+    highMark = qBound<qint64>(1, highWater, maxBytes);
+    lowMark = qBound<qint64>(0, lowWater, highMark);
+    updateWaterMarks();
+}
+
+bool TxQueue::enqueue(const QByteArray &data) {
+    if (data.isEmpty()) {
+        return true;
+    }
+
+    if (depth() + data.size() > maxBytes) {
+        droppedBytes += data.size();
+        droppedCount++;
+        updateWaterMarks();
+        return false;
+    }
+
+    pending.append(data);
+    enqueueCount++;
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+    updateWaterMarks();
+    return true;
+}
+
+void TxQueue::clear() {
+    pending.clear();
+    flushTimer.stop();
+    updateWaterMarks();
+}
+
+void TxQueue::setPaused(bool pause) {
+    paused = pause;
+    if (!paused && !pending.isEmpty() && !flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+qint64 TxQueue::depth() const {
+    return pending.size() + (backlog ? backlog() : 0);
+}
+
+QVariantMap TxQueue::statistics() const {
+    QVariantMap stats;
+    stats["depth"] = depth();
+    stats["queued"] = qint64(pending.size());
+    stats["capacity"] = maxBytes;
+    stats["highWater"] = highMark;
+    stats["lowWater"] = lowMark;
+    stats["aboveHighWater"] = aboveHighWater;
+    stats["enqueued"] = enqueueCount;
+    stats["writes"] = writeCount;
+    stats["droppedBytes"] = droppedBytes;
+    stats["dropped"] = droppedCount;
+    return stats;
+}
+
+void TxQueue::deviceDrained() {
+    if (!pending.isEmpty()) {
+        if (!flushTimer.isActive()) {
+            flushTimer.start();
+        }
+    } else {
+        updateWaterMarks();
+    }
+}
+
+void TxQueue::flush() {
+    if (pending.isEmpty() || !write || paused) {
+        updateWaterMarks();
+        return;
+    }
+
+    // 设备积压已达上限，等待 bytesWritten 后再下发
+    qint64 deviceBacklog = backlog ? backlog() : 0;
+    if (deviceBacklog >= deviceLimit) {
+        updateWaterMarks();
+        return;
+    }
+
+    qint64 size = qMin<qint64>(pending.size(), deviceLimit - deviceBacklog);
+    bool ok;
+    if (size == pending.size()) {
+        QByteArray chunk;
+        chunk.swap(pending);
+        ok = write(chunk);
+    } else {
+        ok = write(pending.left(size));
+        pending.remove(0, size);
+    }
+    writeCount++;
+
+    // 连接已断开，写失败的这块和剩余数据一起丢弃
+    if (!ok) {
+        droppedBytes += size + pending.size();
+        droppedCount++;
+        pending.clear();
+    }
+
+    // 设备仍有余量(或无法探测积压)时下个周期继续，否则等 bytesWritten
+    if (!pending.isEmpty() && (backlog ? backlog() : 0) < deviceLimit) {
+        flushTimer.start();
+    }
+    updateWaterMarks();
+}
+
+void TxQueue::updateWaterMarks() {
+    qint64 current = depth();
+    if (!aboveHighWater && current >= highMark) {
+        aboveHighWater = true;
+        emit highWater(current);
+    } else if (aboveHighWater && current <= lowMark) {
+        aboveHighWater = false;
+        emit lowWater(current);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef TXQUEUE_H
+#define TXQUEUE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+
+// TxQueue 有界发送队列
+// 同一事件循环周期内的多次小写入合并为一次 write；设备写缓冲积压超过 deviceLimit 时
+// 暂停下发，等 bytesWritten 再继续。深度(队列+设备积压)越过高/低水位时发出信号，
+// 供生产者(Lua脚本)节流
+class TxQueue : public QObject {
+    Q_OBJECT
+
+public:
+    using Writer = std::function<bool(const QByteArray &)>;
+    using BacklogProbe = std::function<qint64()>;
+
+    explicit TxQueue(QObject *parent = nullptr);
+
+    // writer 负责实际写出；probe 返回设备写缓冲中尚未发出的字节数
+    void setWriter(Writer writer) { write = std::move(writer); }
+    void setBacklogProbe(BacklogProbe probe) { backlog = std::move(probe); }
+
+    void setLimits(qint64 capacity, qint64 highWater, qint64 lowWater);
+    qint64 capacity() const { return maxBytes; }
+    qint64 highWaterMark() const { return highMark; }
+    qint64 lowWaterMark() const { return lowMark; }
+
+    // 入队，超出容量时丢弃并返回 false
+    bool enqueue(const QByteArray &data);
+    void clear();
+
+    // 暂停期间只入队不写出(文件发送独占设备时)，恢复后继续下发
+    void setPaused(bool pause);
+    bool isPaused() const { return paused; }
+
+    // 当前深度 = 队列中字节 + 设备积压字节
+    qint64 depth() const;
+    bool isAboveHighWater() const { return aboveHighWater; }
+
+    QVariantMap statistics() const;
+
+public slots:
+    // 设备 bytesWritten 时调用，继续下发积压数据
+    void deviceDrained();
+
+signals:
+    void highWater(qint64 depth);
+    void lowWater(qint64 depth);
+
+private slots:
+    void flush();
+
+private:
+    void updateWaterMarks();
+
+    Writer write;
+    BacklogProbe backlog;
+    QByteArray pending;             // 待发送的合并缓冲
+    QTimer flushTimer;              // 0ms 定时器，每个事件循环周期最多 flush 一次
+    qint64 maxBytes = 1024 * 1024;  // 队列容量
+    qint64 highMark = 512 * 1024;   // 高水位
+    qint64 lowMark = 128 * 1024;    // 低水位
+    qint64 deviceLimit = 64 * 1024; // 设备写缓冲积压上限
+    bool aboveHighWater = false;
+    bool paused = false;
+
+    // 统计
+    quint64 enqueueCount = 0;
+    quint64 writeCount = 0;
+    quint64 droppedBytes = 0;
+    quint64 droppedCount = 0;
+};
+
+#endif // TXQUEUE_H
@@ -0,0 +1,512 @@
+#include "virtualserial.h"
+#include "codec.h"
+
+#include <QRandomGenerator>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef Q_OS_MACOS
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+#endif
+
+static void appendCrc(QByteArray &frame) {
+    quint16 crc = Codec::modbusCrc16(frame.constData(), frame.size());
+    frame.append(char(crc & 0xFF));
+    frame.append(char(crc >> 8));
+}
+
+static quint16 readU16(const QByteArray &data, int offset) {
+    return quint16(quint8(data[offset]) << 8 | quint8(data[offset + 1]));
+}
+
+static void appendU16(QByteArray &data, quint16 value) {
+    data.append(char(value >> 8));
+    data.append(char(value & 0xFF));
+}
+
+VirtualSerial::VirtualSerial(QObject *parent)
+    : QObject(parent), registers(kRegisterCount), coils(kRegisterCount, false) {
+    for (int i = 0; i < kRegisterCount; i++) {
+        registers[i] = quint16(i);
+    }
+
+    silenceTimer.setSingleShot(true);
+    silenceTimer.setTimerType(Qt::PreciseTimer);
+    connect(&silenceTimer, &QTimer::timeout, this, &VirtualSerial::onSilence);
+
+    // 限速按 1ms 节拍补发积欠的字节，长期速率与波特率一致
+    paceTimer.setInterval(1);
+    paceTimer.setTimerType(Qt::PreciseTimer);
+    connect(&paceTimer, &QTimer::timeout, this, &VirtualSerial::onPaceTick);
+}
+
+VirtualSerial::~VirtualSerial() {
+    close();
+}
+
+bool VirtualSerial::isSupported() {
+#ifdef Q_OS_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
+
+VirtualSerial::Mode VirtualSerial::modeFromString(const QString &name) {
+    QString lower = name.toLower();
+    if (lower == "modbus") {
+        return ModbusSlave;
+    } else if (lower == "script" || lower == "lua") {
+        return Script;
+    }
+    return Echo;
+}
+
+bool VirtualSerial::open() {
+    if (isOpen()) {
+        return true;
+    }
+
+#ifdef Q_OS_UNIX
+    char name[256] = {0};
+    if (::openpty(&masterFd, &slaveFd, name, nullptr, nullptr) != 0) {
+        lastError = QString("openpty 失败: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        masterFd = -1;
+        slaveFd = -1;
+        return false;
+    }
+
+    // 原始模式，避免行规程回显和换行转换
+    struct termios tio;
+    if (::tcgetattr(slaveFd, &tio) == 0) {
+        ::cfmakeraw(&tio);
+        ::tcsetattr(slaveFd, TCSANOW, &tio);
+    }
+    ::fcntl(masterFd, F_SETFL, ::fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+    slavePath = QString::fromLocal8Bit(name);
+    readNotifier = new QSocketNotifier(masterFd, QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &VirtualSerial::onReadable);
+    lastError.clear();
+    return true;
+#else
+    lastError = "当前平台不支持虚拟串口";
+    return false;
+#endif
+}
+
+void VirtualSerial::close() {
+    silenceTimer.stop();
+    paceTimer.stop();
+    request.clear();
+    txPending.clear();
+
+    delete readNotifier;
+    readNotifier = nullptr;
+
+#ifdef Q_OS_UNIX
+    if (masterFd >= 0) {
+        ::close(masterFd);
+    }
+    if (slaveFd >= 0) {
+        ::close(slaveFd);
+    }
+#endif
+    masterFd = -1;
+    slaveFd = -1;
+    slavePath.clear();
+}
+
+void VirtualSerial::setMode(Mode mode) {
+    currentMode = mode;
+    request.clear();
+    silenceTimer.stop();
+}
+
+void VirtualSerial::setBaudRate(int baudRate, double bitsPerChar) {
+    charNs = baudRate > 0 ? qint64(bitsPerChar * 1e9 / baudRate) : 0;
+}
+
+void VirtualSerial::setRegister(int address, quint16 value) {
+    if (address >= 0 && address < kRegisterCount) {
+        registers[address] = value;
+    }
+}
+
+quint16 VirtualSerial::registerValue(int address) const {
+    return address >= 0 && address < kRegisterCount ? registers[address] : 0;
+}
+
+void VirtualSerial::setErrorInjection(double drop, double corrupt, int delay) {
+    dropRate = qBound(0.0, drop, 1.0);
+    corruptRate = qBound(0.0, corrupt, 1.0);
+    delayMs = qMax(0, delay);
+}
+
+QVariantMap VirtualSerial::statistics() const {
+    QVariantMap stats;
+    stats["open"] = isOpen();
+    stats["name"] = name();
+    stats["path"] = slavePath;
+    stats["mode"] = currentMode == ModbusSlave ? "modbus" : (currentMode == Script ? "script" : "echo");
+    stats["requests"] = requestCount;
+    stats["responses"] = responseCount;
+    stats["dropped"] = droppedCount;
+    stats["corrupted"] = corruptedCount;
+    stats["exceptions"] = exceptionCount;
+    stats["bytesIn"] = bytesIn;
+    stats["bytesOut"] = bytesOut;
+    return stats;
+}
+
+void VirtualSerial::resetStatistics() {
+    requestCount = 0;
+    responseCount = 0;
+    droppedCount = 0;
+    corruptedCount = 0;
+    exceptionCount = 0;
+    bytesIn = 0;
+    bytesOut = 0;
+}
+
+void VirtualSerial::onReadable() {
+#ifdef Q_OS_UNIX
+    QByteArray data;
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = ::read(masterFd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+        data.append(buffer, n);
+    }
+    if (data.isEmpty()) {
+        return;
+    }
+    bytesIn += data.size();
+
+    // 回环模式不分帧，收到即回
+    if (currentMode == Echo) {
+        processRequest(data);
+        return;
+    }
+
+    request.append(data);
+
+    // Modbus 请求长度可由功能码算出，凑齐即处理，不必等帧间隔
+    if (currentMode == ModbusSlave) {
+        int expected;
+        while ((expected = expectedModbusLength()) > 0 && request.size() >= expected) {
+            QByteArray frame = request.left(expected);
+            request.remove(0, expected);
+            processRequest(frame);
+        }
+    }
+
+    if (!request.isEmpty()) {
+        // t3.5 静默视为请求结束，高于 19200 波特率时为 1.75ms
+        qint64 silenceNs = qMax<qint64>(charNs * 7 / 2, 1750000);
+        silenceTimer.start(int((silenceNs + 999999) / 1000000));
+    }
+#endif
+}
+
+void VirtualSerial::onSilence() {
+    if (request.isEmpty()) {
+        return;
+    }
+    QByteArray frame;
+    frame.swap(request);
+    processRequest(frame);
+}
+
+void VirtualSerial::onPaceTick() {
+#ifdef Q_OS_UNIX
+    if (masterFd < 0 || txPending.isEmpty()) {
+        paceTimer.stop();
+        return;
+    }
+
+    qint64 allowed = txPending.size();
+    if (charNs > 0) {
+        allowed = qMin(allowed, paceClock.nsecsElapsed() / charNs - pacedBytes);
+    }
+    if (allowed > 0) {
+        ssize_t n = ::write(masterFd, txPending.constData(), allowed);
+        if (n > 0) {
+            txPending.remove(0, n);
+            pacedBytes += n;
+            bytesOut += n;
+        }
+    }
+
+    // 未发完(限速或伪终端缓冲已满)则等下个节拍
+    if (txPending.isEmpty()) {
+        paceTimer.stop();
+    } else if (!paceTimer.isActive()) {
+        paceTimer.start();
+    }
+#endif
+}
+
+void VirtualSerial::processRequest(const QByteArray &frame) {
+    requestCount++;
+    emit requestReceived(frame);
+
+    QByteArray response;
+    switch (currentMode) {
+    case Echo:
+        response = frame;
+        break;
+    case ModbusSlave:
+        response = handleModbus(frame);
+        break;
+    case Script:
+        if (scriptHandler) {
+            response = scriptHandler(frame);
+        }
+        break;
+    }
+
+    if (!response.isEmpty()) {
+        sendResponse(response);
+    }
+}
+
+int VirtualSerial::expectedModbusLength() const {
+    if (request.size() < 2) {
+        return -1;
+    }
+    switch (quint8(request[1])) {
+    case 0x01:
+    case 0x02:
+    case 0x03:
+    case 0x04:
+    case 0x05:
+    case 0x06:
+        return 8;
+    case 0x0F:
+    case 0x10:
+        return request.size() >= 7 ? 9 + quint8(request[6]) : -1;
+    case 0x17:
+        return request.size() >= 11 ? 13 + quint8(request[10]) : -1;
+    default:
+        return -1;
+    }
+}
+
+QByteArray VirtualSerial::handleModbus(const QByteArray &frame) {
+    // 长度或 CRC 错误的请求按规范直接忽略
+    if (frame.size() < 4) {
+        return QByteArray();
+    }
+    quint16 crc = Codec::modbusCrc16(frame.constData(), frame.size() - 2);
+    if (quint8(frame[frame.size() - 2]) != (crc & 0xFF) || quint8(frame[frame.size() - 1]) != (crc >> 8)) {
+        return QByteArray();
+    }
+
+    int unit = quint8(frame[0]);
+    if (unit != slaveId && unit != 0) {
+        return QByteArray();
+    }
+
+    quint8 func = quint8(frame[1]);
+    QByteArray response;
+    response.append(char(unit));
+    response.append(char(func));
+
+    // 广播请求不应答，异常也不应答
+    auto exception = [&](quint8 code) {
+        exceptionCount++;
+        if (unit == 0) {
+            return QByteArray();
+        }
+        QByteArray error;
+        error.append(char(unit));
+        error.append(char(func | 0x80));
+        error.append(char(code));
+        appendCrc(error);
+        return error;
+    };
+
+    // 先判断功能码，不支持的功能码无论长度都回 0x01
+    if (frame.size() < 8) {
+        switch (func) {
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x0F:
+        case 0x10:
+        case 0x17:
+            return exception(0x03);
+        default:
+            return exception(0x01);
+        }
+    }
+    int start = readU16(frame, 2);
+    int count = readU16(frame, 4);
+
+    switch (func) {
+    case 0x01:
+    case 0x02: {
+        if (count < 1 || count > 2000) {
+            return exception(0x03);
+        }
+        if (start + count > kRegisterCount) {
+            return exception(0x02);
+        }
+        QByteArray bits((count + 7) / 8, 0);
+        for (int i = 0; i < count; i++) {
+            if (coils[start + i]) {
+                bits[i / 8] = char(quint8(bits[i / 8]) | (1 << (i % 8)));
+            }
+        }
+        response.append(char(bits.size()));
+        response.append(bits);
+        break;
+    }
+    case 0x03:
+    case 0x04:
+        if (count < 1 || count > 125) {
+            return exception(0x03);
+        }
+        if (start + count > kRegisterCount) {
+            return exception(0x02);
+        }
+        response.append(char(count * 2));
+        for (int i = 0; i < count; i++) {
+            appendU16(response, registers[start + i]);
+        }
+        break;
+    case 0x05:
+        if (count != 0xFF00 && count != 0x0000) {
+            return exception(0x03);
+        }
+        if (start >= kRegisterCount) {
+            return exception(0x02);
+        }
+        coils[start] = count == 0xFF00;
+        response = frame.left(6);
+        break;
+    case 0x06:
+        if (start >= kRegisterCount) {
+            return exception(0x02);
+        }
+        registers[start] = quint16(count);
+        response = frame.left(6);
+        break;
+    case 0x0F: {
+        int byteCount = quint8(frame[6]);
+        if (count < 1 || count > 1968 || byteCount != (count + 7) / 8 || frame.size() < 9 + byteCount) {
+            return exception(0x03);
+        }
+        if (start + count > kRegisterCount) {
+            return exception(0x02);
+        }
+        for (int i = 0; i < count; i++) {
+            coils[start + i] = quint8(frame[7 + i / 8]) & (1 << (i % 8));
+        }
+        response = frame.left(6);
+        break;
+    }
+    case 0x10: {
+        int byteCount = quint8(frame[6]);
+        if (count < 1 || count > 123 || byteCount != count * 2 || frame.size() < 9 + byteCount) {
+            return exception(0x03);
+        }
+        if (start + count > kRegisterCount) {
+            return exception(0x02);
+        }
+        for (int i = 0; i < count; i++) {
+            registers[start + i] = readU16(frame, 7 + i * 2);
+        }
+        response = frame.left(6);
+        break;
+    }
+    case 0x17: {
+        // 先写后读，读地址/数量在前，写地址/数量在后
+        if (frame.size() < 13) {
+            return exception(0x03);
+        }
+        int writeStart = readU16(frame, 6);
+        int writeCount = readU16(frame, 8);
+        int byteCount = quint8(frame[10]);
+        if (count < 1 || count > 125 || writeCount < 1 || writeCount > 121
+            || byteCount != writeCount * 2 || frame.size() < 13 + byteCount) {
+            return exception(0x03);
+        }
+        if (start + count > kRegisterCount || writeStart + writeCount > kRegisterCount) {
+            return exception(0x02);
+        }
+        for (int i = 0; i < writeCount; i++) {
+            registers[writeStart + i] = readU16(frame, 11 + i * 2);
+        }
+        response.append(char(count * 2));
+        for (int i = 0; i < count; i++) {
+            appendU16(response, registers[start + i]);
+        }
+        break;
+    }
+    default:
+        return exception(0x01);
+    }
+
+    // 广播请求不应答
+    if (unit == 0) {
+        return QByteArray();
+    }
+    appendCrc(response);
+    return response;
+}
+
+void VirtualSerial::sendResponse(QByteArray response) {
+    QRandomGenerator *random = QRandomGenerator::global();
+    if (dropRate > 0 && random->generateDouble() < dropRate) {
+        droppedCount++;
+        return;
+    }
+    if (corruptRate > 0 && random->generateDouble() < corruptRate) {
+        int index = random->bounded(response.size());
+        response[index] = char(quint8(response[index]) ^ (1 << random->bounded(8)));
+        corruptedCount++;
+    }
+    responseCount++;
+
+    if (delayMs > 0) {
+        QTimer::singleShot(delayMs, this, [this, response]() {
+            txPending.append(response);
+            writePending();
+        });
+        return;
+    }
+    txPending.append(response);
+    writePending();
+}
+
+void VirtualSerial::writePending() {
+    if (!isOpen() || txPending.isEmpty()) {
+        return;
+    }
+
+    // 空闲后重新计时，字节按字符时间依次发出
+    if (charNs > 0) {
+        if (!paceTimer.isActive()) {
+            paceClock.start();
+            pacedBytes = 0;
+            paceTimer.start();
+        }
+        return;
+    }
+    onPaceTick();
+}
@@ -0,0 +1,118 @@
+#ifndef VIRTUALSERIAL_H
+#define VIRTUALSERIAL_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <functional>
+
+class QSocketNotifier;
+
+// VirtualSerial 基于伪终端(openpty)的虚拟串口对
+// SerialHandler 打开从端，本类在主端模拟设备：回环、内置 Modbus RTU 从站或 Lua 脚本处理；
+// 应答按设定波特率逐字节限速发出，并可注入丢帧、误码和延迟。仅 Unix 平台可用
+class VirtualSerial : public QObject {
+    Q_OBJECT
+
+public:
+    enum Mode {
+        Echo,         // 原样回环
+        ModbusSlave,  // 内置 Modbus RTU 从站
+        Script        // 交给脚本处理
+    };
+
+    // 输入一个完整请求，返回应答(为空则不应答)
+    using ScriptHandler = std::function<QByteArray(const QByteArray &)>;
+
+    explicit VirtualSerial(QObject *parent = nullptr);
+    ~VirtualSerial();
+
+    static bool isSupported();
+    static Mode modeFromString(const QString &name);
+
+    bool open();
+    void close();
+    bool isOpen() const { return masterFd >= 0; }
+    QString errorString() const { return lastError; }
+
+    // 在端口列表中显示的名称和实际设备路径
+    QString name() const { return QStringLiteral("vpty0"); }
+    QString devicePath() const { return slavePath; }
+
+    void setMode(Mode mode);
+    Mode mode() const { return currentMode; }
+    void setScriptHandler(ScriptHandler handler) { scriptHandler = std::move(handler); }
+
+    // 按波特率限速，bitsPerChar 为每字符总位数；baudRate 为 0 时不限速
+    void setBaudRate(int baudRate, double bitsPerChar = 10);
+
+    // Modbus 从站地址和寄存器(线圈与寄存器各 kRegisterCount 个，寄存器初值为地址)
+    void setSlaveId(int id) { slaveId = id; }
+    void setRegister(int address, quint16 value);
+    quint16 registerValue(int address) const;
+
+    // 错误注入：按概率丢弃应答、翻转应答中的一位，以及固定的应答延迟
+    void setErrorInjection(double dropRate, double corruptRate, int delayMs);
+
+    QVariantMap statistics() const;
+    void resetStatistics();
+
+signals:
+    void requestReceived(const QByteArray &request);
+
+private slots:
+    void onReadable();
+    void onSilence();
+    void onPaceTick();
+
+private:
+    void processRequest(const QByteArray &request);
+    QByteArray handleModbus(const QByteArray &request);
+    void sendResponse(QByteArray response);
+    void writePending();
+    int expectedModbusLength() const;
+
+    static const int kRegisterCount = 10000;
+
+    int masterFd = -1;
+    int slaveFd = -1;                // 保持从端打开，避免串口关闭时主端读到 EIO
+    QString slavePath;
+    QString lastError;
+    QSocketNotifier *readNotifier = nullptr;
+
+    Mode currentMode = Echo;
+    ScriptHandler scriptHandler;
+    QByteArray request;              // 正在接收的请求
+    QTimer silenceTimer;             // 请求帧间隔
+
+    // 限速发送
+    QByteArray txPending;
+    QTimer paceTimer;
+    QElapsedTimer paceClock;
+    qint64 pacedBytes = 0;
+    qint64 charNs = 0;
+
+    // Modbus 从站数据
+    int slaveId = 1;
+    QVector<quint16> registers;
+    QVector<bool> coils;
+
+    // 错误注入
+    double dropRate = 0;
+    double corruptRate = 0;
+    int delayMs = 0;
+
+    // 统计
+    qint64 requestCount = 0;
+    qint64 responseCount = 0;
+    qint64 droppedCount = 0;
+    qint64 corruptedCount = 0;
+    qint64 exceptionCount = 0;
+    qint64 bytesIn = 0;
+    qint64 bytesOut = 0;
+};
+
+#endif // VIRTUALSERIAL_H
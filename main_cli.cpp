@@ -0,0 +1,207 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+
+#include "serialhandler.h"
+#include "codec.h"
+
+// 无界面命令行版本：按参数建立连接，运行 Lua 脚本，输出写到标准输出或文件
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("mjcom_cli");
+    QCoreApplication::setApplicationVersion("0.1");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MJCom 无界面模式");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption serialOption("serial", "串口名称", "port");
+    QCommandLineOption baudOption("baud", "波特率", "rate", "115200");
+    QCommandLineOption dataBitsOption("data-bits", "数据位", "bits", "8");
+    QCommandLineOption stopBitsOption("stop-bits", "停止位", "bits", "1");
+    QCommandLineOption parityOption("parity", "校验位 None/Even/Odd", "parity", "None");
+    QCommandLineOption rtuOption("rtu-framing", "按 t3.5 帧间隔分帧");
+    QCommandLineOption lowLatencyOption("low-latency", "串口低延迟模式");
+    QCommandLineOption tcpOption("tcp", "连接TCP服务器", "host:port");
+    QCommandLineOption tcpServerOption("tcp-server", "启动TCP服务器", "port");
+    QCommandLineOption udpOption("udp", "UDP本地端口", "port");
+    QCommandLineOption remoteOption("remote", "UDP目标地址", "host:port");
+    QCommandLineOption scriptOption(QStringList() << "s" << "script", "Lua脚本文件", "file");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "输出文件(默认标准输出)", "file");
+    QCommandLineOption asciiOption("ascii", "以ASCII显示收发数据(默认HEX)");
+    QCommandLineOption quietOption("quiet", "不输出收发数据，只输出脚本输出");
+    QCommandLineOption exitOption("exit", "脚本结束后退出");
+    QCommandLineOption logLevelOption("log-level", "脚本 log 级别 debug/info/warn/error/off", "level", "info");
+    QCommandLineOption luaGcOption("lua-gc", "Lua 垃圾回收模式 incremental/generational", "mode");
+    QCommandLineOption dissectorOption("dissector", "接收数据协议解析器 modbus-rtu/modbus-tcp/slip/cobs/nmea/length-prefixed", "name");
+    QCommandLineOption captureOption("capture", "录制收发数据到文件(.mjcol 为列式格式，其余为 CSV)", "file");
+    QCommandLineOption historyOption("history", "会话历史文件(已有历史继续追加，默认临时文件)", "file");
+
+    parser.addOptions({serialOption, baudOption, dataBitsOption, stopBitsOption, parityOption,
+                       rtuOption, lowLatencyOption, tcpOption, tcpServerOption, udpOption,
+                       remoteOption, scriptOption, outputOption, asciiOption, quietOption, exitOption,
+                       logLevelOption, luaGcOption, dissectorOption, captureOption, historyOption});
+    parser.process(app);
+
+    // 输出目标
+    QFile outputFile;
+    if (parser.isSet(outputOption)) {
+        outputFile.setFileName(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            QTextStream(stderr) << "无法打开输出文件: " << outputFile.fileName() << Qt::endl;
+            return 1;
+        }
+    } else {
+        outputFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&outputFile);
+
+    auto writeLine = [&out](const QString &tag, const QString &text) {
+        out << '[' << tag << "] "
+            << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz") << ' '
+            << text << Qt::endl;
+    };
+
+    QString script;
+    if (parser.isSet(scriptOption)) {
+        QFile scriptFile(parser.value(scriptOption));
+        if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream(stderr) << "无法打开脚本文件: " << scriptFile.fileName() << Qt::endl;
+            return 1;
+        }
+        script = QString::fromUtf8(scriptFile.readAll());
+    }
+
+    SerialHandler serialHandler;
+    if (!serialHandler.setScriptLogLevel(parser.value(logLevelOption))) {
+        QTextStream(stderr) << "无效的日志级别: " << parser.value(logLevelOption) << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(luaGcOption) && !serialHandler.setLuaGcMode(parser.value(luaGcOption))) {
+        QTextStream(stderr) << "无效的垃圾回收模式: " << parser.value(luaGcOption) << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(dissectorOption) && !serialHandler.setDissector(parser.value(dissectorOption))) {
+        QTextStream(stderr) << "未知的解析器: " << parser.value(dissectorOption) << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(captureOption)) {
+        const QString capturePath = parser.value(captureOption);
+        const QString format = capturePath.endsWith(".mjcol", Qt::CaseInsensitive) ? "columnar" : "csv";
+        if (!serialHandler.startCapture(capturePath, format)) {
+            QTextStream(stderr) << "无法录制到文件: " << capturePath << " " << serialHandler.exportError() << Qt::endl;
+            return 1;
+        }
+    }
+    if (parser.isSet(historyOption) && !serialHandler.setHistoryFile(parser.value(historyOption))) {
+        QTextStream(stderr) << "无法打开会话历史文件: " << parser.value(historyOption) << Qt::endl;
+        return 1;
+    }
+    bool showAscii = parser.isSet(asciiOption);
+    bool exitOnFinish = parser.isSet(exitOption);
+
+    if (!parser.isSet(quietOption)) {
+        QObject::connect(&serialHandler, &SerialHandler::dataReceived,
+                         [&](const QByteArray &data, qint64) {
+                             writeLine("接收", showAscii ? QString::fromUtf8(data) : Codec::toHexString(data));
+                         });
+        QObject::connect(&serialHandler, &SerialHandler::dataSent,
+                         [&](const QByteArray &data, qint64) {
+                             writeLine("发送", showAscii ? QString::fromUtf8(data) : Codec::toHexString(data));
+                         });
+        QObject::connect(&serialHandler, &SerialHandler::frameDecoded,
+                         [&](const QVariantMap &frame, qint64) {
+                             writeLine("解析", frame.value("summary").toString());
+                         });
+    }
+    QObject::connect(&serialHandler, &SerialHandler::luaOutput,
+                     [&](const QString &output) {
+                         // 同一轮事件循环内的多条输出合并在一次信号中
+                         for (const QString &line : output.split('\n')) {
+                             writeLine("输出", line);
+                         }
+                     });
+
+    // 脚本在连接建立后执行一次(排队到事件循环中，保证 exit 生效)
+    bool scriptStarted = false;
+    auto runScript = [&]() {
+        if (scriptStarted || script.isEmpty()) {
+            return;
+        }
+        scriptStarted = true;
+        writeLine("执行", serialHandler.executeLuaScript(script));
+        if (exitOnFinish && !serialHandler.isScriptRunning()) {
+            QCoreApplication::exit(0);
+        }
+    };
+
+    // 首次连接失败时脚本不会执行，报错退出，避免无人值守时一直挂起
+    bool everConnected = false;
+    bool awaitingTcp = false;
+    QString lastStatus;
+    QObject::connect(&serialHandler, &SerialHandler::connectionStatusChanged,
+                     [&](bool connected, const QString &message) {
+                         writeLine("状态", message);
+                         lastStatus = message;
+                         if (connected) {
+                             everConnected = true;
+                             QMetaObject::invokeMethod(&app, runScript, Qt::QueuedConnection);
+                         } else if (awaitingTcp && !everConnected) {
+                             awaitingTcp = false;
+                             QTextStream(stderr) << message << Qt::endl;
+                             QCoreApplication::exit(1);
+                         }
+                     });
+    QObject::connect(&serialHandler, &SerialHandler::scriptSchedulerStatusChanged,
+                     [&](bool running, const QString &message) {
+                         if (!running && exitOnFinish) {
+                             writeLine("结束", message);
+                             QCoreApplication::exit(0);
+                         }
+                     });
+
+    // 建立连接
+    if (parser.isSet(serialOption)) {
+        serialHandler.setRtuFraming(parser.isSet(rtuOption));
+        serialHandler.setSerialLowLatency(parser.isSet(lowLatencyOption));
+        serialHandler.openPort(parser.value(serialOption), parser.value(baudOption),
+                               parser.value(dataBitsOption), parser.value(stopBitsOption),
+                               parser.value(parityOption));
+        if (!everConnected) {
+            QTextStream(stderr) << lastStatus << Qt::endl;
+            return 1;
+        }
+    } else if (parser.isSet(tcpOption)) {
+        QString target = parser.value(tcpOption);
+        int colon = target.lastIndexOf(':');
+        if (colon <= 0) {
+            QTextStream(stderr) << "TCP地址格式应为 host:port" << Qt::endl;
+            return 1;
+        }
+        // 连接结果异步到达，"正在连接"之后的断开状态即为连接失败
+        serialHandler.connectToTcpServer(target.left(colon), target.mid(colon + 1).toInt());
+        awaitingTcp = true;
+    } else if (parser.isSet(tcpServerOption)) {
+        if (!serialHandler.startTcpServer(parser.value(tcpServerOption).toInt())) {
+            QTextStream(stderr) << lastStatus << Qt::endl;
+            return 1;
+        }
+    } else if (parser.isSet(udpOption)) {
+        QString remote = parser.value(remoteOption);
+        int colon = remote.lastIndexOf(':');
+        QString remoteHost = colon > 0 ? remote.left(colon) : QString();
+        int remotePort = colon > 0 ? remote.mid(colon + 1).toInt() : 0;
+        if (!serialHandler.startUdp(parser.value(udpOption).toInt(), remoteHost, remotePort)) {
+            QTextStream(stderr) << lastStatus << Qt::endl;
+            return 1;
+        }
+    } else {
+        // 没有连接参数时直接执行脚本
+        QMetaObject::invokeMethod(&app, runScript, Qt::QueuedConnection);
+    }
+
+    return app.exec();
+}